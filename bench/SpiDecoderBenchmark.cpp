@@ -0,0 +1,677 @@
+// Decoder throughput benchmark.
+//
+// Drives SpiDecoder with synthetic channels that compute their edges on the fly, so captures of 10^8 edges don't need gigabytes of
+// transition lists. Each configuration prints one machine readable row (CSV by default, JSON lines with --json).
+//
+// The synthetic capture is a train of identical transactions. Every bit slot is 8 samples long: the leading clock edge is 2 samples
+// in, the trailing edge 6 samples in, and words are separated by one idle slot. Data changes at the start of the slot for CPHA = 0,
+// and just after the leading edge for CPHA = 1.
+//
+// Result storage is estimated from what the plugin hands to the SDK for each event, using the sizes below. They model the SDK's
+// bookkeeping; they are not measured from it. Each row also reports the marker storage its bit marker mode saves per million words,
+// compared to marking every bit.
+//
+// With --input bitmap, each channel is first rendered to a packed bitmap, one bit per sample, and decoded through SpiBitmapStream.
+// Rendering isn't timed, and takes up to 100 MB per channel for 10^8 edges. The checksum matches the synthetic run's.
+//
+// With --kernel generic, the decoder reads every word with its generic kernel (SpiDecoderSettings::mGenericKernel) instead of the one
+// specialized for the configuration, which shows what the specialization is worth. The checksum matches the specialized run's.
+
+#include "SpiBitmapStream.h"
+#include "SpiDecoder.h"
+#include "SpiTransitionStream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const uint64_t kSlotSamples = 8;
+    const uint64_t kLeadingEdgeOffset = 2;
+    const uint64_t kTrailingEdgeOffset = 6;
+    const uint64_t kIdleBeforeTransaction = 16;
+    const uint64_t kEnableToFirstSlot = 8;
+    const uint64_t kIdleAfterTransaction = 24;
+
+    // Frame: two S64 samples, two U64 data values, type and flags, padded.
+    const uint64_t kFrameBytes = 40;
+    // Marker: sample, channel and marker type.
+    const uint64_t kMarkerBytes = 16;
+    // FrameV2: type and sample range, plus a key and payload per field.
+    const uint64_t kFrameV2Bytes = 24;
+    const uint64_t kFrameV2FieldBytes = 8;
+
+    uint64_t SplitMix64( uint64_t x )
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+        x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBull;
+        return x ^ ( x >> 31 );
+    }
+
+    struct BenchmarkConfig
+    {
+        uint32_t mBitsPerTransfer;
+        bool mLsbFirst;
+        bool mCpol;
+        bool mCpha;
+        bool mUseEnable;
+        SpiBitMarkers mBitMarkers;
+        uint32_t mWordsPerTransaction;
+        uint64_t mTargetEdges;
+        bool mBitmapInput;
+        bool mGenericKernel;
+    };
+
+    // The timeline shared by all channels of one synthetic capture.
+    class SyntheticCapture
+    {
+      public:
+        explicit SyntheticCapture( const BenchmarkConfig& config )
+            : mBits( config.mBitsPerTransfer ), mWords( config.mWordsPerTransaction ), mCpha( config.mCpha )
+        {
+            mWordSamples = kSlotSamples * ( mBits + 1 );
+            mTransactionSamples = kIdleBeforeTransaction + kEnableToFirstSlot + mWords * mWordSamples + kIdleAfterTransaction;
+            mClockEdgesPerTransaction = 2ull * mBits * mWords;
+            mTransactions = ( config.mTargetEdges + mClockEdgesPerTransaction - 1 ) / mClockEdgesPerTransaction;
+            if( mTransactions == 0 )
+                mTransactions = 1;
+        }
+
+        uint64_t TransactionStart( uint64_t transaction ) const
+        {
+            return transaction * mTransactionSamples + kIdleBeforeTransaction;
+        }
+
+        uint64_t TransactionEnd( uint64_t transaction ) const
+        {
+            return TransactionStart( transaction ) + kEnableToFirstSlot + mWords * mWordSamples;
+        }
+
+        uint64_t ClockEdgeCount() const
+        {
+            return mTransactions * mClockEdgesPerTransaction;
+        }
+
+        uint64_t ClockEdgeSample( uint64_t edge ) const
+        {
+            uint64_t transaction = edge / mClockEdgesPerTransaction;
+            uint64_t remainder = edge % mClockEdgesPerTransaction;
+            uint64_t word = remainder / ( 2 * mBits );
+            uint64_t bit = ( remainder % ( 2 * mBits ) ) / 2;
+            uint64_t offset = ( remainder & 1 ) ? kTrailingEdgeOffset : kLeadingEdgeOffset;
+            return TransactionStart( transaction ) + kEnableToFirstSlot + word * mWordSamples + bit * kSlotSamples + offset;
+        }
+
+        uint64_t EnableEdgeCount() const
+        {
+            return mTransactions * 2;
+        }
+
+        uint64_t EnableEdgeSample( uint64_t edge ) const
+        {
+            return ( edge & 1 ) ? TransactionEnd( edge / 2 ) : TransactionStart( edge / 2 );
+        }
+
+        bool DataStateAt( uint64_t sample, uint64_t seed ) const
+        {
+            if( sample < kIdleBeforeTransaction )
+                return false;
+
+            uint64_t transaction = ( sample - kIdleBeforeTransaction ) / mTransactionSamples;
+            uint64_t data_start = TransactionStart( transaction ) + kEnableToFirstSlot + ( mCpha ? kLeadingEdgeOffset + 1 : 0 );
+            if( sample < data_start || transaction >= mTransactions )
+                return false;
+
+            uint64_t word = ( sample - data_start ) / mWordSamples;
+            uint64_t bit = ( ( sample - data_start ) % mWordSamples ) / kSlotSamples;
+            if( word >= mWords || bit >= mBits )
+                return false;
+
+            return ( ( SplitMix64( seed ^ ( transaction * mWords + word ) ) >> bit ) & 1 ) != 0;
+        }
+
+        // samples where a data line may change, after the given sample.
+        uint64_t NextDataBoundary( uint64_t sample ) const
+        {
+            return ( sample / kSlotSamples + 1 ) * kSlotSamples + ( mCpha ? kLeadingEdgeOffset + 1 : 0 );
+        }
+
+        uint64_t LastSample() const
+        {
+            return mTransactions * mTransactionSamples + kIdleBeforeTransaction;
+        }
+
+      private:
+        uint64_t mBits;
+        uint64_t mWords;
+        bool mCpha;
+        uint64_t mWordSamples;
+        uint64_t mTransactionSamples;
+        uint64_t mClockEdgesPerTransaction;
+        uint64_t mTransactions;
+    };
+
+    // Clock and enable: lines whose edges are indexed, with the sample of each edge computed from the timeline.
+    class IndexedEdgeStream : public SpiEdgeStream
+    {
+      public:
+        IndexedEdgeStream( const SyntheticCapture& capture, bool is_clock, bool initial_state )
+            : mCapture( capture ),
+              mIsClock( is_clock ),
+              mInitialState( initial_state ),
+              mEdgeCount( is_clock ? capture.ClockEdgeCount() : capture.EnableEdgeCount() ),
+              mNextEdge( 0 ),
+              mSample( 0 )
+        {
+        }
+
+        virtual uint64_t GetSampleNumber()
+        {
+            return mSample;
+        }
+
+        virtual bool GetBitState()
+        {
+            return mInitialState != ( ( mNextEdge & 1 ) != 0 );
+        }
+
+        virtual void AdvanceToNextEdge()
+        {
+            mSample = GetSampleOfNextEdge();
+            mNextEdge++;
+        }
+
+        virtual void AdvanceToAbsPosition( uint64_t sample_number )
+        {
+            if( sample_number > mCapture.LastSample() )
+                throw SpiEndOfStream();
+
+            // the first edge after sample_number
+            uint64_t low = mNextEdge;
+            uint64_t high = mEdgeCount;
+            while( low < high )
+            {
+                uint64_t mid = low + ( high - low ) / 2;
+                if( EdgeSample( mid ) <= sample_number )
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            mNextEdge = low;
+            mSample = sample_number;
+        }
+
+        virtual uint64_t GetSampleOfNextEdge()
+        {
+            if( mNextEdge == mEdgeCount )
+                throw SpiEndOfStream();
+            return EdgeSample( mNextEdge );
+        }
+
+        virtual bool WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number )
+        {
+            if( mNextEdge < mEdgeCount )
+                return EdgeSample( mNextEdge ) <= sample_number;
+            if( sample_number > mCapture.LastSample() )
+                throw SpiEndOfStream();
+            return false;
+        }
+
+        virtual bool DoMoreTransitionsExistInCurrentData()
+        {
+            return mNextEdge < mEdgeCount;
+        }
+
+      private:
+        uint64_t EdgeSample( uint64_t edge ) const
+        {
+            return mIsClock ? mCapture.ClockEdgeSample( edge ) : mCapture.EnableEdgeSample( edge );
+        }
+
+        const SyntheticCapture& mCapture;
+        bool mIsClock;
+        bool mInitialState;
+        uint64_t mEdgeCount;
+        uint64_t mNextEdge;
+        uint64_t mSample;
+    };
+
+    // MOSI and MISO: the state at any sample is computed directly, which is all the decoder asks of a data line.
+    class DataStream : public SpiEdgeStream
+    {
+      public:
+        DataStream( const SyntheticCapture& capture, uint64_t seed ) : mCapture( capture ), mSeed( seed ), mSample( 0 )
+        {
+        }
+
+        virtual uint64_t GetSampleNumber()
+        {
+            return mSample;
+        }
+
+        virtual bool GetBitState()
+        {
+            return mCapture.DataStateAt( mSample, mSeed );
+        }
+
+        virtual void AdvanceToNextEdge()
+        {
+            mSample = GetSampleOfNextEdge();
+        }
+
+        virtual void AdvanceToAbsPosition( uint64_t sample_number )
+        {
+            if( sample_number > mCapture.LastSample() )
+                throw SpiEndOfStream();
+            mSample = sample_number;
+        }
+
+        virtual uint64_t GetSampleOfNextEdge()
+        {
+            bool state = GetBitState();
+            for( uint64_t sample = mCapture.NextDataBoundary( mSample ); sample <= mCapture.LastSample();
+                 sample = mCapture.NextDataBoundary( sample ) )
+            {
+                if( mCapture.DataStateAt( sample, mSeed ) != state )
+                    return sample;
+            }
+            throw SpiEndOfStream();
+        }
+
+        virtual bool WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number )
+        {
+            bool state = GetBitState();
+            for( uint64_t sample = mCapture.NextDataBoundary( mSample ); sample <= sample_number;
+                 sample = mCapture.NextDataBoundary( sample ) )
+            {
+                if( mCapture.DataStateAt( sample, mSeed ) != state )
+                    return true;
+            }
+            return false;
+        }
+
+        virtual bool DoMoreTransitionsExistInCurrentData()
+        {
+            return mSample < mCapture.LastSample();
+        }
+
+      private:
+        const SyntheticCapture& mCapture;
+        uint64_t mSeed;
+        uint64_t mSample;
+    };
+
+    // Counts what the plugin would store for each event.
+    class CountingSink : public SpiDecoderSink
+    {
+      public:
+        explicit CountingSink( uint32_t bits_per_transfer )
+            : mBytesPerWord( ( bits_per_transfer + 7 ) / 8 ), mWords( 0 ), mArrows( 0 ), mStorageBytes( 0 ), mChecksum( 0 )
+        {
+        }
+
+        virtual void OnPacketBoundary()
+        {
+        }
+
+        virtual void OnEnable( uint64_t /*sample*/, uint32_t /*slave*/ )
+        {
+            mStorageBytes += kFrameV2Bytes;
+        }
+
+        virtual void OnDisable( uint64_t /*sample*/, uint32_t /*slave*/ )
+        {
+            mStorageBytes += kFrameV2Bytes;
+        }
+
+        virtual void OnClockPolarityError( uint64_t /*sample*/ )
+        {
+            mStorageBytes += kMarkerBytes;
+        }
+
+        virtual void OnErrorFrame( uint64_t /*starting_sample*/, uint64_t /*ending_sample*/, uint32_t /*slave*/ )
+        {
+            mStorageBytes += kFrameBytes + kFrameV2Bytes;
+        }
+
+        virtual void OnWord( const SpiWord& word )
+        {
+            mWords++;
+            mArrows += word.mArrowCount;
+            mChecksum += word.mMosi ^ ( word.mMiso << 1 );
+            mStorageBytes += word.mArrowCount * kMarkerBytes + kFrameBytes + kFrameV2Bytes + 2 * ( kFrameV2FieldBytes + mBytesPerWord );
+        }
+
+        virtual void OnChipSelectOverlap( uint64_t /*sample*/, uint32_t /*slave*/ )
+        {
+            mStorageBytes += kMarkerBytes;
+        }
+
+        virtual void OnProgress( uint64_t /*sample*/ )
+        {
+        }
+
+        virtual void PollForExit()
+        {
+        }
+
+        uint64_t mBytesPerWord;
+        uint64_t mWords;
+        uint64_t mArrows;
+        uint64_t mStorageBytes;
+        uint64_t mChecksum;
+    };
+
+    // samples [from, to) set
+    void SetBits( std::vector<uint64_t>& words, uint64_t from, uint64_t to )
+    {
+        while( from < to )
+        {
+            uint64_t count = std::min( 64 - ( from & 63 ), to - from );
+            words[ from >> 6 ] |= ( count == 64 ? ~0ull : ( 1ull << count ) - 1 ) << ( from & 63 );
+            from += count;
+        }
+    }
+
+    // plays a stream from sample 0 into a bitmap of sample_count samples.
+    void RenderBitmap( SpiEdgeStream& stream, uint64_t sample_count, std::vector<uint64_t>& words )
+    {
+        words.assign( ( sample_count + 63 ) / 64, 0 );
+        uint64_t from = 0;
+        for( ;; )
+        {
+            const bool state = stream.GetBitState();
+            uint64_t to = sample_count;
+            try
+            {
+                to = std::min( stream.GetSampleOfNextEdge(), sample_count );
+            }
+            catch( SpiEndOfStream& )
+            {
+            }
+
+            if( state )
+                SetBits( words, from, to );
+            if( to == sample_count )
+                break;
+            stream.AdvanceToNextEdge();
+            from = to;
+        }
+    }
+
+    struct BenchmarkResult
+    {
+        uint64_t mWords;
+        uint64_t mEdges;
+        double mSeconds;
+        uint64_t mArrows;
+        uint64_t mStorageBytes;
+        uint64_t mChecksum;
+    };
+
+    BenchmarkResult RunBenchmark( const BenchmarkConfig& config )
+    {
+        SyntheticCapture capture( config );
+        IndexedEdgeStream clock( capture, true, config.mCpol );
+        IndexedEdgeStream enable( capture, false, true );
+        DataStream mosi( capture, 0x4D4F5349 );
+        DataStream miso( capture, 0x4D49534F );
+
+        SpiDecoderSettings settings;
+        settings.mLsbFirst = config.mLsbFirst;
+        settings.mBitsPerTransfer = config.mBitsPerTransfer;
+        settings.mClockInactiveState = config.mCpol;
+        settings.mDataValidOnLeadingEdge = config.mCpha == false;
+        settings.mEnableActiveState = false;
+        settings.mBitMarkers = config.mBitMarkers;
+        settings.mGenericKernel = config.mGenericKernel;
+
+        SpiEdgeStream* streams[] = { &clock, &mosi, &miso, &enable };
+        std::vector<uint64_t> bitmaps[ 4 ];
+        SpiBitmapStream bitmap_streams[ 4 ];
+        if( config.mBitmapInput )
+        {
+            IndexedEdgeStream render_clock( capture, true, config.mCpol );
+            IndexedEdgeStream render_enable( capture, false, true );
+            DataStream render_mosi( capture, 0x4D4F5349 );
+            DataStream render_miso( capture, 0x4D49534F );
+            SpiEdgeStream* render_streams[] = { &render_clock, &render_mosi, &render_miso, &render_enable };
+
+            const uint64_t sample_count = capture.LastSample() + 1;
+            for( size_t i = 0; i < 4; i++ )
+            {
+                RenderBitmap( *render_streams[ i ], sample_count, bitmaps[ i ] );
+                bitmap_streams[ i ].Setup( bitmaps[ i ].data(), sample_count );
+                streams[ i ] = &bitmap_streams[ i ];
+            }
+        }
+
+        CountingSink sink( config.mBitsPerTransfer );
+        SpiDecoder decoder;
+        decoder.Setup( settings, streams[ 0 ], streams[ 1 ], streams[ 2 ], config.mUseEnable ? streams[ 3 ] : NULL, &sink );
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        try
+        {
+            decoder.Run();
+        }
+        catch( SpiEndOfStream& )
+        {
+        }
+
+        BenchmarkResult result;
+        result.mSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        result.mWords = sink.mWords;
+        result.mEdges = capture.ClockEdgeCount() + ( config.mUseEnable ? capture.EnableEdgeCount() : 0 );
+        result.mArrows = sink.mArrows;
+        result.mStorageBytes = sink.mStorageBytes;
+        result.mChecksum = sink.mChecksum;
+        return result;
+    }
+
+    // "1-64", "8,16,32" or a mix of both
+    bool ParseList( const char* text, std::vector<uint64_t>& values )
+    {
+        values.clear();
+        const char* p = text;
+        while( *p != '\0' )
+        {
+            char* end;
+            uint64_t first = uint64_t( strtod( p, &end ) );
+            if( end == p )
+                return false;
+            uint64_t last = first;
+            p = end;
+            if( *p == '-' )
+            {
+                last = uint64_t( strtod( p + 1, &end ) );
+                if( end == p + 1 )
+                    return false;
+                p = end;
+            }
+            for( uint64_t value = first; value <= last; value++ )
+                values.push_back( value );
+            if( *p == ',' )
+                p++;
+        }
+        return values.empty() == false;
+    }
+
+    const char* const kBitMarkerNames[] = { "off", "first-last", "all" };
+    const char* const kInputNames[] = { "synthetic", "bitmap" };
+    const char* const kKernelNames[] = { "specialized", "generic" };
+
+    // "off,all" etc.
+    bool ParseBitMarkers( const char* text, std::vector<SpiBitMarkers>& values )
+    {
+        values.clear();
+        std::string list( text );
+        size_t start = 0;
+        while( start <= list.size() )
+        {
+            size_t end = list.find( ',', start );
+            if( end == std::string::npos )
+                end = list.size();
+            std::string name = list.substr( start, end - start );
+
+            size_t i = 0;
+            while( i < 3 && name != kBitMarkerNames[ i ] )
+                i++;
+            if( i == 3 )
+                return false;
+            values.push_back( SpiBitMarkers( i ) );
+            start = end + 1;
+        }
+        return values.empty() == false;
+    }
+
+    // "synthetic,bitmap" etc., as indexes into names
+    bool ParseNames( const char* text, const char* const* names, uint32_t name_count, std::vector<uint32_t>& values )
+    {
+        values.clear();
+        std::string list( text );
+        size_t start = 0;
+        while( start <= list.size() )
+        {
+            size_t end = list.find( ',', start );
+            if( end == std::string::npos )
+                end = list.size();
+            std::string name = list.substr( start, end - start );
+
+            uint32_t i = 0;
+            while( i < name_count && name != names[ i ] )
+                i++;
+            if( i == name_count )
+                return false;
+            values.push_back( i );
+            start = end + 1;
+        }
+        return values.empty() == false;
+    }
+
+    void PrintUsage()
+    {
+        fprintf( stderr,
+                 "usage: spi_benchmark [options]\n"
+                 "\n"
+                 "  --bits LIST            bits per transfer to test, e.g. 1-64 or 8,16 (default 1,8,16,32,64)\n"
+                 "  --edges LIST           clock edges per capture, e.g. 1e6,1e8 (default 1e6)\n"
+                 "  --words N              words per enable window (default 16)\n"
+                 "  --markers LIST         bit marker modes: off, first-last, all (default all three)\n"
+                 "  --input LIST           channel sources: synthetic, bitmap (default synthetic)\n"
+                 "  --kernel LIST          decoder kernels: specialized, generic (default both)\n"
+                 "  --json                 print JSON lines instead of CSV\n" );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    std::vector<uint64_t> bits_list;
+    std::vector<uint64_t> edges_list;
+    ParseList( "1,8,16,32,64", bits_list );
+    ParseList( "1e6", edges_list );
+    std::vector<SpiBitMarkers> markers_list;
+    ParseBitMarkers( "off,first-last,all", markers_list );
+    std::vector<uint32_t> inputs;
+    ParseNames( "synthetic", kInputNames, 2, inputs );
+    std::vector<uint32_t> kernels;
+    ParseNames( "specialized,generic", kKernelNames, 2, kernels );
+    uint32_t words_per_transaction = 16;
+    bool json = false;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : NULL;
+        if( strcmp( argv[ i ], "--bits" ) == 0 && value != NULL && ParseList( value, bits_list ) )
+            i++;
+        else if( strcmp( argv[ i ], "--edges" ) == 0 && value != NULL && ParseList( value, edges_list ) )
+            i++;
+        else if( strcmp( argv[ i ], "--words" ) == 0 && value != NULL && atoi( value ) > 0 )
+            words_per_transaction = uint32_t( atoi( argv[ ++i ] ) );
+        else if( strcmp( argv[ i ], "--markers" ) == 0 && value != NULL && ParseBitMarkers( value, markers_list ) )
+            i++;
+        else if( strcmp( argv[ i ], "--input" ) == 0 && value != NULL && ParseNames( value, kInputNames, 2, inputs ) )
+            i++;
+        else if( strcmp( argv[ i ], "--kernel" ) == 0 && value != NULL && ParseNames( value, kKernelNames, 2, kernels ) )
+            i++;
+        else if( strcmp( argv[ i ], "--json" ) == 0 )
+            json = true;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    for( size_t i = 0; i < bits_list.size(); i++ )
+    {
+        if( bits_list[ i ] < 1 || bits_list[ i ] > 64 )
+        {
+            fprintf( stderr, "spi_benchmark: bits per transfer must be between 1 and 64\n" );
+            return 1;
+        }
+    }
+
+    if( json == false )
+        printf( "bits,shift_order,cpol,cpha,enable,markers,input,kernel,edges,words,seconds,words_per_s,edges_per_s,storage_bytes_per_word,"
+                "marker_bytes_saved_per_million_words,checksum\n" );
+
+    for( size_t e = 0; e < edges_list.size(); e++ )
+    {
+        for( size_t b = 0; b < bits_list.size(); b++ )
+        {
+            for( size_t m = 0; m < markers_list.size(); m++ )
+            {
+                const uint32_t runs = uint32_t( inputs.size() * kernels.size() );
+                for( uint32_t variant = 0; variant < 16 * runs; variant++ )
+                {
+                    // the inputs and kernels of a configuration run back to back, so their rows are adjacent.
+                    const uint32_t input = inputs[ ( variant % runs ) % inputs.size() ];
+                    const uint32_t kernel = kernels[ ( variant % runs ) / inputs.size() ];
+                    const uint32_t mode = variant / runs;
+
+                    BenchmarkConfig config;
+                    config.mBitsPerTransfer = uint32_t( bits_list[ b ] );
+                    config.mLsbFirst = ( mode & 1 ) != 0;
+                    config.mCpol = ( mode & 2 ) != 0;
+                    config.mCpha = ( mode & 4 ) != 0;
+                    config.mUseEnable = ( mode & 8 ) != 0;
+                    config.mBitMarkers = markers_list[ m ];
+                    config.mWordsPerTransaction = words_per_transaction;
+                    config.mTargetEdges = edges_list[ e ];
+                    config.mBitmapInput = input == 1;
+                    config.mGenericKernel = kernel == 1;
+
+                    BenchmarkResult result = RunBenchmark( config );
+                    double seconds = result.mSeconds > 0 ? result.mSeconds : 1e-9;
+                    double storage_per_word = result.mWords > 0 ? double( result.mStorageBytes ) / result.mWords : 0.0;
+                    double saved_per_million_words =
+                        result.mWords > 0
+                            ? double( result.mWords * config.mBitsPerTransfer - result.mArrows ) * kMarkerBytes * 1e6 / result.mWords
+                            : 0.0;
+
+                    const char* format = json ? "{\"bits\":%u,\"shift_order\":\"%s\",\"cpol\":%d,\"cpha\":%d,\"enable\":%d,"
+                                                "\"markers\":\"%s\",\"input\":\"%s\",\"kernel\":\"%s\",\"edges\":%llu,\"words\":%llu,"
+                                                "\"seconds\":%.6f,\"words_per_s\":%.0f,\"edges_per_s\":%.0f,"
+                                                "\"storage_bytes_per_word\":%.1f,\"marker_bytes_saved_per_million_words\":%.0f,"
+                                                "\"checksum\":\"%016llx\"}\n"
+                                              : "%u,%s,%d,%d,%d,%s,%s,%s,%llu,%llu,%.6f,%.0f,%.0f,%.1f,%.0f,%016llx\n";
+                    printf( format, config.mBitsPerTransfer, config.mLsbFirst ? "lsb" : "msb", int( config.mCpol ), int( config.mCpha ),
+                            int( config.mUseEnable ), kBitMarkerNames[ config.mBitMarkers ], kInputNames[ input ], kKernelNames[ kernel ],
+                            ( unsigned long long )result.mEdges, ( unsigned long long )result.mWords, result.mSeconds,
+                            result.mWords / seconds, result.mEdges / seconds, storage_per_word, saved_per_million_words,
+                            ( unsigned long long )result.mChecksum );
+                    fflush( stdout );
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,281 @@
+// Number formatting benchmark.
+//
+// Times AnalyzerHelpers::GetNumberString() against SpiNumberFormatter for each display base and word size, over the same random
+// words, and checks that every string matches. Each configuration prints one machine readable row (CSV by default, JSON lines with
+// --json). Links the Analyzer SDK, so it is only built with the plugin.
+//
+// With --scroll, it instead replays a user panning across dense traffic: every step asks for the bubbles of a viewport of frames on
+// both channels, then moves the viewport a fraction of its width. It reports the bubble cache's hit rate and the time per bubble with
+// and without the cache, keyed and sized as in SpiAnalyzerResults.
+
+#include "SpiExportFormat.h"
+#include "SpiLruCache.h"
+
+#include <AnalyzerHelpers.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const DisplayBase kDisplayBases[] = { Binary, Decimal, Hexadecimal, ASCII, AsciiHex };
+    const char* const kDisplayBaseNames[] = { "binary", "decimal", "hex", "ascii", "ascii-hex" };
+
+    // as SpiAnalyzerResults
+    const size_t kBubbleCacheEntries = 8192;
+
+    struct BubbleText
+    {
+        char mText[ SpiNumberFormatter::kMaxLength ];
+    };
+
+    uint64_t SplitMix64( uint64_t x )
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+        x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBull;
+        return x ^ ( x >> 31 );
+    }
+
+    double Seconds( std::chrono::steady_clock::time_point start )
+    {
+        double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        return seconds > 0 ? seconds : 1e-9;
+    }
+
+    bool ParseList( const char* text, std::vector<uint64_t>& values )
+    {
+        values.clear();
+        const char* p = text;
+        while( *p != '\0' )
+        {
+            char* end;
+            uint64_t first = uint64_t( strtod( p, &end ) );
+            if( end == p )
+                return false;
+            uint64_t last = first;
+            p = end;
+            if( *p == '-' )
+            {
+                last = uint64_t( strtod( p + 1, &end ) );
+                if( end == p + 1 )
+                    return false;
+                p = end;
+            }
+            for( uint64_t value = first; value <= last; value++ )
+                values.push_back( value );
+            if( *p == ',' )
+                p++;
+        }
+        return values.empty() == false;
+    }
+
+    bool ParseDisplayBases( const char* text, std::vector<uint32_t>& bases )
+    {
+        bases.clear();
+        const char* p = text;
+        while( *p != '\0' )
+        {
+            size_t length = strcspn( p, "," );
+            size_t i = 0;
+            while( i < 5 && ( strlen( kDisplayBaseNames[ i ] ) != length || strncmp( p, kDisplayBaseNames[ i ], length ) != 0 ) )
+                i++;
+            if( i == 5 )
+                return false;
+            bases.push_back( uint32_t( i ) );
+            p += length;
+            if( *p == ',' )
+                p++;
+        }
+        return bases.empty() == false;
+    }
+
+    void PrintUsage()
+    {
+        fprintf( stderr,
+                 "usage: spi_format_benchmark [options]\n"
+                 "\n"
+                 "  --bits LIST            bits per transfer to test, e.g. 1-64 or 8,16 (default 1,8,16,32,64)\n"
+                 "  --bases LIST           display bases: binary, decimal, hex, ascii, ascii-hex (default all five)\n"
+                 "  --count N              words formatted per configuration (default 1e6)\n"
+                 "  --scroll               replay panning through the bubble cache instead\n"
+                 "  --viewport N           frames on screen when scrolling (default 1000)\n"
+                 "  --pan F                fraction of the viewport moved per step (default 0.1)\n"
+                 "  --json                 print JSON lines instead of CSV\n" );
+    }
+
+    // the bubbles of both channels for every frame in view, one viewport position after another, over count frames.
+    int RunScroll( const std::vector<uint64_t>& bits_list, const std::vector<uint32_t>& bases, uint64_t count, uint64_t viewport,
+                   double pan, bool json )
+    {
+        if( json == false )
+            printf( "base,bits,viewport,pan,bubbles,hits,misses,hit_rate,uncached_ns_per_bubble,cached_ns_per_bubble\n" );
+
+        const uint64_t step = uint64_t( viewport * pan ) > 0 ? uint64_t( viewport * pan ) : 1;
+        char text[ SpiNumberFormatter::kMaxLength ];
+        uint64_t checksum = 0;
+
+        for( size_t b = 0; b < bases.size(); b++ )
+        {
+            for( size_t n = 0; n < bits_list.size(); n++ )
+            {
+                const DisplayBase display_base = kDisplayBases[ bases[ b ] ];
+                const uint32_t bits = uint32_t( bits_list[ n ] );
+                const uint64_t mask = bits == 64 ? ~0ull : ( 1ull << bits ) - 1;
+                SpiNumberFormatter formatter;
+                formatter.Setup( display_base, bits );
+
+                uint64_t bubbles = 0;
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                for( uint64_t first = 0; first + viewport <= count; first += step )
+                {
+                    for( uint64_t frame = first; frame < first + viewport; frame++ )
+                    {
+                        for( uint64_t channel = 0; channel < 2; channel++ )
+                        {
+                            checksum += formatter.Format( SplitMix64( 2 * frame + channel ) & mask, text );
+                            bubbles++;
+                        }
+                    }
+                }
+                double uncached_seconds = Seconds( start );
+
+                SpiLruCache<uint64_t, BubbleText> cache( kBubbleCacheEntries );
+                start = std::chrono::steady_clock::now();
+                for( uint64_t first = 0; first + viewport <= count; first += step )
+                {
+                    for( uint64_t frame = first; frame < first + viewport; frame++ )
+                    {
+                        for( uint64_t channel = 0; channel < 2; channel++ )
+                        {
+                            const uint64_t key = ( frame << 4 ) | ( uint64_t( display_base ) << 1 ) | channel;
+                            const BubbleText* bubble = cache.Find( key );
+                            if( bubble == NULL )
+                            {
+                                BubbleText& entry = cache.Insert( key );
+                                formatter.Format( SplitMix64( 2 * frame + channel ) & mask, entry.mText );
+                                bubble = &entry;
+                            }
+                            checksum += strlen( bubble->mText );
+                        }
+                    }
+                }
+                double cached_seconds = Seconds( start );
+
+                const double per_bubble = bubbles > 0 ? 1e9 / bubbles : 0.0;
+                const double hit_rate = bubbles > 0 ? double( cache.Hits() ) / bubbles : 0.0;
+                const char* format = json ? "{\"base\":\"%s\",\"bits\":%u,\"viewport\":%llu,\"pan\":%.3f,\"bubbles\":%llu,\"hits\":%llu,"
+                                            "\"misses\":%llu,\"hit_rate\":%.4f,\"uncached_ns_per_bubble\":%.1f,"
+                                            "\"cached_ns_per_bubble\":%.1f}\n"
+                                          : "%s,%u,%llu,%.3f,%llu,%llu,%llu,%.4f,%.1f,%.1f\n";
+                printf( format, kDisplayBaseNames[ bases[ b ] ], bits, ( unsigned long long )viewport, pan, ( unsigned long long )bubbles,
+                        ( unsigned long long )cache.Hits(), ( unsigned long long )cache.Misses(), hit_rate, uncached_seconds * per_bubble,
+                        cached_seconds * per_bubble );
+                fflush( stdout );
+            }
+        }
+
+        // keeps the formatting from being optimized away
+        return checksum == 0 ? 2 : 0;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    std::vector<uint64_t> bits_list;
+    ParseList( "1,8,16,32,64", bits_list );
+    std::vector<uint32_t> bases;
+    ParseDisplayBases( "binary,decimal,hex,ascii,ascii-hex", bases );
+    uint64_t count = 1000000;
+    bool json = false;
+    bool scroll = false;
+    uint64_t viewport = 1000;
+    double pan = 0.1;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : NULL;
+        if( strcmp( argv[ i ], "--bits" ) == 0 && value != NULL && ParseList( value, bits_list ) )
+            i++;
+        else if( strcmp( argv[ i ], "--bases" ) == 0 && value != NULL && ParseDisplayBases( value, bases ) )
+            i++;
+        else if( strcmp( argv[ i ], "--count" ) == 0 && value != NULL && atof( value ) >= 1 )
+            count = uint64_t( atof( argv[ ++i ] ) );
+        else if( strcmp( argv[ i ], "--scroll" ) == 0 )
+            scroll = true;
+        else if( strcmp( argv[ i ], "--viewport" ) == 0 && value != NULL && atof( value ) >= 1 )
+            viewport = uint64_t( atof( argv[ ++i ] ) );
+        else if( strcmp( argv[ i ], "--pan" ) == 0 && value != NULL && atof( value ) > 0 )
+            pan = atof( argv[ ++i ] );
+        else if( strcmp( argv[ i ], "--json" ) == 0 )
+            json = true;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    for( size_t i = 0; i < bits_list.size(); i++ )
+    {
+        if( bits_list[ i ] < 1 || bits_list[ i ] > 64 )
+        {
+            fprintf( stderr, "spi_format_benchmark: bits per transfer must be between 1 and 64\n" );
+            return 1;
+        }
+    }
+
+    if( scroll )
+        return RunScroll( bits_list, bases, count, viewport, pan, json );
+
+    if( json == false )
+        printf( "base,bits,count,sdk_ns_per_word,fast_ns_per_word,speedup,mismatches\n" );
+
+    bool all_match = true;
+    std::vector<uint64_t> words( count );
+    std::vector<char> sdk_text( count * SpiNumberFormatter::kMaxLength );
+    std::vector<char> fast_text( count * SpiNumberFormatter::kMaxLength );
+
+    for( size_t b = 0; b < bases.size(); b++ )
+    {
+        for( size_t n = 0; n < bits_list.size(); n++ )
+        {
+            const DisplayBase display_base = kDisplayBases[ bases[ b ] ];
+            const uint32_t bits = uint32_t( bits_list[ n ] );
+            const uint64_t mask = bits == 64 ? ~0ull : ( 1ull << bits ) - 1;
+            for( uint64_t i = 0; i < count; i++ )
+                words[ i ] = SplitMix64( i ) & mask;
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for( uint64_t i = 0; i < count; i++ )
+                AnalyzerHelpers::GetNumberString( words[ i ], display_base, bits, &sdk_text[ i * SpiNumberFormatter::kMaxLength ],
+                                                  SpiNumberFormatter::kMaxLength );
+            double sdk_seconds = Seconds( start );
+
+            // setup is part of the cost: the analyzer pays it once per display base and word size.
+            start = std::chrono::steady_clock::now();
+            SpiNumberFormatter formatter;
+            formatter.Setup( display_base, bits );
+            for( uint64_t i = 0; i < count; i++ )
+                formatter.Format( words[ i ], &fast_text[ i * SpiNumberFormatter::kMaxLength ] );
+            double fast_seconds = Seconds( start );
+
+            uint64_t mismatches = 0;
+            for( uint64_t i = 0; i < count; i++ )
+                if( strcmp( &sdk_text[ i * SpiNumberFormatter::kMaxLength ], &fast_text[ i * SpiNumberFormatter::kMaxLength ] ) != 0 )
+                    mismatches++;
+            all_match = all_match && mismatches == 0;
+
+            const char* format = json ? "{\"base\":\"%s\",\"bits\":%u,\"count\":%llu,\"sdk_ns_per_word\":%.1f,\"fast_ns_per_word\":%.1f,"
+                                        "\"speedup\":%.2f,\"mismatches\":%llu}\n"
+                                      : "%s,%u,%llu,%.1f,%.1f,%.2f,%llu\n";
+            printf( format, kDisplayBaseNames[ bases[ b ] ], bits, ( unsigned long long )count, sdk_seconds * 1e9 / count,
+                    fast_seconds * 1e9 / count, sdk_seconds / fast_seconds, ( unsigned long long )mismatches );
+            fflush( stdout );
+        }
+    }
+
+    return all_match ? 0 : 2;
+}
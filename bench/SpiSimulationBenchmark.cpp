@@ -0,0 +1,245 @@
+// Simulation benchmark.
+//
+// Times SpiSimulationDataGenerator against the per-bit generator it replaced, which advanced every channel and called the clock
+// generator twice per bit, for each word size and data valid edge. Both are asked for the same capture in the same steps, the way
+// Logic asks for more simulated data while it runs, and every row reports simulated samples/s for each, as CSV (or JSON lines with
+// --json). The reference generator only covers standard SPI, so the rows are all one lane. Links the Analyzer SDK, so it is only
+// built with the plugin.
+
+#include "SpiAnalyzerSettings.h"
+#include "SpiSimulationDataGenerator.h"
+
+#include <AnalyzerHelpers.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // the generator before bulk edge generation: MOSI, MISO, clock and enable, one bit at a time.
+    class ReferenceGenerator
+    {
+      public:
+        void Initialize( U32 simulation_sample_rate, SpiAnalyzerSettings* settings )
+        {
+            mSimulationSampleRateHz = simulation_sample_rate;
+            mSettings = settings;
+            mClockGenerator.Init( simulation_sample_rate / 10, simulation_sample_rate );
+
+            mMiso = mSpiSimulationChannels.Add( settings->mMisoChannel, mSimulationSampleRateHz, BIT_LOW );
+            mMosi = mSpiSimulationChannels.Add( settings->mMosiChannel, mSimulationSampleRateHz, BIT_LOW );
+            mClock = mSpiSimulationChannels.Add( settings->mClockChannel, mSimulationSampleRateHz, mSettings->mClockInactiveState );
+            mEnable =
+                mSpiSimulationChannels.Add( settings->mEnableChannel, mSimulationSampleRateHz, Invert( mSettings->mEnableActiveState ) );
+
+            mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( 10.0 ) );
+            mValue = 0;
+        }
+
+        U32 GenerateSimulationData( U64 largest_sample_requested, U32 sample_rate, SimulationChannelDescriptor** simulation_channels )
+        {
+            U64 adjusted_largest_sample_requested =
+                AnalyzerHelpers::AdjustSimulationTargetSample( largest_sample_requested, sample_rate, mSimulationSampleRateHz );
+
+            while( mClock->GetCurrentSampleNumber() < adjusted_largest_sample_requested )
+            {
+                mEnable->Transition();
+                mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( 2.0 ) );
+                for( U32 i = 0; i < 4; i++ )
+                {
+                    if( i == 3 )
+                        mEnable->Transition();
+                    OutputWord( mValue, mValue + 1 );
+                    mValue++;
+                }
+                mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( 10.0 ) );
+            }
+
+            *simulation_channels = mSpiSimulationChannels.GetArray();
+            return mSpiSimulationChannels.GetCount();
+        }
+
+      private:
+        void OutputWord( U64 mosi_data, U64 miso_data )
+        {
+            BitExtractor mosi_bits( mosi_data, mSettings->mShiftOrder, mSettings->mBitsPerTransfer );
+            BitExtractor miso_bits( miso_data, mSettings->mShiftOrder, mSettings->mBitsPerTransfer );
+            const bool leading_edge = mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge;
+
+            for( U32 i = 0; i < mSettings->mBitsPerTransfer; i++ )
+            {
+                if( leading_edge == false )
+                    mClock->Transition();
+                mMosi->TransitionIfNeeded( mosi_bits.GetNextBit() );
+                mMiso->TransitionIfNeeded( miso_bits.GetNextBit() );
+
+                mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( .5 ) );
+                mClock->Transition();
+
+                mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( .5 ) );
+                if( leading_edge )
+                    mClock->Transition();
+            }
+
+            mMosi->TransitionIfNeeded( BIT_LOW );
+            mMiso->TransitionIfNeeded( BIT_LOW );
+            mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( 2.0 ) );
+        }
+
+        SpiAnalyzerSettings* mSettings;
+        U32 mSimulationSampleRateHz;
+        U64 mValue;
+        ClockGenerator mClockGenerator;
+        SimulationChannelDescriptorGroup mSpiSimulationChannels;
+        SimulationChannelDescriptor* mMiso;
+        SimulationChannelDescriptor* mMosi;
+        SimulationChannelDescriptor* mClock;
+        SimulationChannelDescriptor* mEnable;
+    };
+
+    double Seconds( std::chrono::steady_clock::time_point start )
+    {
+        double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        return seconds > 0 ? seconds : 1e-9;
+    }
+
+    bool ParseList( const char* text, std::vector<uint64_t>& values )
+    {
+        values.clear();
+        const char* p = text;
+        while( *p != '\0' )
+        {
+            char* end;
+            uint64_t first = uint64_t( strtod( p, &end ) );
+            if( end == p )
+                return false;
+            uint64_t last = first;
+            p = end;
+            if( *p == '-' )
+            {
+                last = uint64_t( strtod( p + 1, &end ) );
+                if( end == p + 1 )
+                    return false;
+                p = end;
+            }
+            for( uint64_t value = first; value <= last; value++ )
+                values.push_back( value );
+            if( *p == ',' )
+                p++;
+        }
+        return values.empty() == false;
+    }
+
+    void PrintUsage()
+    {
+        fprintf( stderr,
+                 "usage: spi_simulation_benchmark [options]\n"
+                 "\n"
+                 "  --bits LIST            bits per transfer to test, e.g. 1-64 or 8,16 (default 8,16,32)\n"
+                 "  --samples N            simulated samples per configuration (default 1e8)\n"
+                 "  --step N               samples asked for per GenerateSimulationData() call (default 1e6)\n"
+                 "  --json                 print JSON lines instead of CSV\n" );
+    }
+
+    void SetupSettings( SpiAnalyzerSettings& settings, uint32_t bits, AnalyzerEnums::Edge data_valid_edge )
+    {
+        settings.mMosiChannel = Channel( 0, 0 );
+        settings.mMisoChannel = Channel( 0, 1 );
+        settings.mClockChannel = Channel( 0, 2 );
+        settings.mEnableChannel = Channel( 0, 3 );
+        settings.mBitsPerTransfer = bits;
+        settings.mDataValidEdge = data_valid_edge;
+    }
+
+    // the channels' final sample numbers and states, to check both generators made the same capture
+    uint64_t Summarize( SimulationChannelDescriptor* channels, U32 count )
+    {
+        uint64_t summary = 0;
+        for( U32 i = 0; i < count; i++ )
+            summary = summary * 31 + channels[ i ].GetCurrentSampleNumber() * 2 + ( channels[ i ].GetCurrentBitState() == BIT_HIGH );
+        return summary;
+    }
+}
+
+int main( int argc, char** argv )
+{
+    std::vector<uint64_t> bits_list;
+    ParseList( "8,16,32", bits_list );
+    uint64_t samples = 100000000;
+    uint64_t step = 1000000;
+    bool json = false;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : NULL;
+        if( strcmp( argv[ i ], "--bits" ) == 0 && value != NULL && ParseList( value, bits_list ) )
+            i++;
+        else if( strcmp( argv[ i ], "--samples" ) == 0 && value != NULL && atof( value ) >= 1 )
+            samples = uint64_t( atof( argv[ ++i ] ) );
+        else if( strcmp( argv[ i ], "--step" ) == 0 && value != NULL && atof( value ) >= 1 )
+            step = uint64_t( atof( argv[ ++i ] ) );
+        else if( strcmp( argv[ i ], "--json" ) == 0 )
+            json = true;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    for( size_t i = 0; i < bits_list.size(); i++ )
+    {
+        if( bits_list[ i ] < 1 || bits_list[ i ] > 64 )
+        {
+            fprintf( stderr, "spi_simulation_benchmark: bits per transfer must be between 1 and 64\n" );
+            return 1;
+        }
+    }
+
+    if( json == false )
+        printf( "bits,edge,samples,reference_samples_per_s,bulk_samples_per_s,speedup,match\n" );
+
+    const U32 sample_rate = 100000000;
+    const AnalyzerEnums::Edge edges[] = { AnalyzerEnums::LeadingEdge, AnalyzerEnums::TrailingEdge };
+    const char* const edge_names[] = { "leading", "trailing" };
+    bool all_match = true;
+
+    for( size_t n = 0; n < bits_list.size(); n++ )
+    {
+        for( uint32_t e = 0; e < 2; e++ )
+        {
+            SpiAnalyzerSettings settings;
+            SetupSettings( settings, uint32_t( bits_list[ n ] ), edges[ e ] );
+            SimulationChannelDescriptor* channels = NULL;
+            U32 count = 0;
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            ReferenceGenerator reference;
+            reference.Initialize( sample_rate, &settings );
+            for( uint64_t sample = step; sample < samples + step; sample += step )
+                count = reference.GenerateSimulationData( sample, sample_rate, &channels );
+            double reference_seconds = Seconds( start );
+            const uint64_t reference_summary = Summarize( channels, count );
+
+            start = std::chrono::steady_clock::now();
+            SpiSimulationDataGenerator bulk;
+            bulk.Initialize( sample_rate, &settings );
+            for( uint64_t sample = step; sample < samples + step; sample += step )
+                count = bulk.GenerateSimulationData( sample, sample_rate, &channels );
+            double bulk_seconds = Seconds( start );
+            const bool match = Summarize( channels, count ) == reference_summary;
+            all_match = all_match && match;
+
+            const char* format = json ? "{\"bits\":%u,\"edge\":\"%s\",\"samples\":%llu,\"reference_samples_per_s\":%.0f,"
+                                        "\"bulk_samples_per_s\":%.0f,\"speedup\":%.2f,\"match\":%s}\n"
+                                      : "%u,%s,%llu,%.0f,%.0f,%.2f,%s\n";
+            printf( format, uint32_t( bits_list[ n ] ), edge_names[ e ], ( unsigned long long )samples, samples / reference_seconds,
+                    samples / bulk_seconds, reference_seconds / bulk_seconds, match ? "true" : "false" );
+            fflush( stdout );
+        }
+    }
+
+    return all_match ? 0 : 2;
+}
@@ -3,6 +3,7 @@
 #include "SpiAnalyzerSettings.h"
 
 #include <AnalyzerChannelData.h>
+#include <algorithm>
 
 
 // enum SpiBubbleType { SpiData, SpiError };
@@ -11,10 +12,18 @@ SpiAnalyzer::SpiAnalyzer()
     : Analyzer2(),
       mSettings( new SpiAnalyzerSettings() ),
       mSimulationInitilized( false ),
-      mMosi( NULL ),
-      mMiso( NULL ),
-      mClock( NULL ),
-      mEnable( NULL )
+      mProgressSample( 0 ),
+      mLiveLatency( false ),
+      mPacketHasFrames( false ),
+      mPacketFirstFrame( 0 ),
+      mPacketLastFrame( 0 ),
+      mTransactionFrames( false ),
+      mTransactionStart( 0 ),
+      mTransactionSlave( 0 ),
+      mTransactionWords( 0 ),
+      mWideLanes( false ),
+      mPayloadIndex( false ),
+      mCollapseRepeats( false )
 {
     SetAnalyzerSettings( mSettings.get() );
     UseFrameV2();
@@ -40,42 +49,11 @@ void SpiAnalyzer::WorkerThread()
 {
     Setup();
 
-    AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
-
-    for( ;; )
-    {
-        GetWord();
-        CheckIfThreadShouldExit();
-    }
-}
-
-void SpiAnalyzer::AdvanceToActiveEnableEdgeWithCorrectClockPolarity()
-{
-    mResults->CommitPacketAndStartNewPacket();
-    mResults->CommitResults();
-
-    AdvanceToActiveEnableEdge();
-
-    for( ;; )
-    {
-        if( IsInitialClockPolarityCorrect() == true ) // if false, this function moves to the next active enable edge.
-        {
-            if( mEnable )
-            {
-                FrameV2 frame_v2_start_of_transaction;
-                mResults->AddFrameV2( frame_v2_start_of_transaction, "enable", mCurrentSample, mCurrentSample + 1 );
-            }
-            break;
-        }
-    }
+    mDecoder.Run();
 }
 
 void SpiAnalyzer::Setup()
 {
-    bool allow_last_trailing_clock_edge_to_fall_outside_enable = false;
-    if( mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge )
-        allow_last_trailing_clock_edge_to_fall_outside_enable = true;
-
     if( mSettings->mClockInactiveState == BIT_LOW )
     {
         if( mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge )
@@ -91,275 +69,335 @@ void SpiAnalyzer::Setup()
             mArrowMarker = AnalyzerResults::UpArrow;
     }
 
-
+    SpiDecoderSettings decoder_settings;
+    decoder_settings.mLsbFirst = mSettings->mShiftOrder == AnalyzerEnums::LsbFirst;
+    decoder_settings.mBitsPerTransfer = mSettings->mBitsPerTransfer;
+    decoder_settings.mClockInactiveState = mSettings->mClockInactiveState == BIT_HIGH;
+    decoder_settings.mDataValidOnLeadingEdge = mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge;
+    decoder_settings.mEnableActiveState = mSettings->mEnableActiveState == BIT_HIGH;
+    decoder_settings.mBitMarkers = SpiBitMarkers( mSettings->mBitMarkers );
+    decoder_settings.mDataLanes = mSettings->mDataLanes;
+    decoder_settings.mSingleBitWords = mSettings->mSingleBitWords;
+
+    SpiEdgeStream* mosi = NULL;
     if( mSettings->mMosiChannel != UNDEFINED_CHANNEL )
-        mMosi = GetAnalyzerChannelData( mSettings->mMosiChannel );
-    else
-        mMosi = NULL;
+    {
+        mMosi.SetChannelData( GetAnalyzerChannelData( mSettings->mMosiChannel ) );
+        mosi = &mMosi;
+    }
 
+    SpiEdgeStream* miso = NULL;
     if( mSettings->mMisoChannel != UNDEFINED_CHANNEL )
-        mMiso = GetAnalyzerChannelData( mSettings->mMisoChannel );
-    else
-        mMiso = NULL;
+    {
+        mMiso.SetChannelData( GetAnalyzerChannelData( mSettings->mMisoChannel ) );
+        miso = &mMiso;
+    }
 
+    // the decoder only waits for more capture data on the clock and enable lines; publish whatever is pending before it does.
+    mClock.SetChannelData( GetAnalyzerChannelData( mSettings->mClockChannel ), this );
 
-    mClock = GetAnalyzerChannelData( mSettings->mClockChannel );
+    // the decoder and the mux report to the filter, which drops the transactions that don't match, and then to the collapser, which
+    // passes on everything but the repeats
+    mCollapseRepeats = mSettings->mRepeatMode == SpiRepeatsCollapsed;
+    mRepeats.Setup( this );
+    SpiDecoderSink* sink = mCollapseRepeats ? static_cast<SpiDecoderSink*>( &mRepeats ) : this;
 
-    if( mSettings->mEnableChannel != UNDEFINED_CHANNEL )
-        mEnable = GetAnalyzerChannelData( mSettings->mEnableChannel );
-    else
-        mEnable = NULL;
-}
+    std::vector<SpiPayloadFilter::Pattern> filter_patterns;
+    SpiPayloadFilter::ParsePatterns( mSettings->mPayloadFilter.c_str(), filter_patterns );
+    if( filter_patterns.empty() == false )
+    {
+        mPayloadFilter.Setup( filter_patterns, mSettings->mBitsPerTransfer, sink );
+        sink = &mPayloadFilter;
+    }
 
-void SpiAnalyzer::AdvanceToActiveEnableEdge()
-{
-    if( mEnable != NULL )
+    SpiEdgeStream* enable = NULL;
+    mChipSelectChannels = mSettings->GetChipSelectChannels();
+    if( mChipSelectChannels.empty() == false )
     {
-        if( mEnable->GetBitState() != mSettings->mEnableActiveState )
+        // the mux waits for more capture data on the chip selects itself, and lets us know when it does.
+        mChipSelectStreams.resize( mChipSelectChannels.size() );
+        std::vector<SpiEdgeStream*> chip_selects( mChipSelectChannels.size(), static_cast<SpiEdgeStream*>( NULL ) );
+        for( size_t i = 0; i < mChipSelectChannels.size(); i++ )
         {
-            mEnable->AdvanceToNextEdge();
+            if( mChipSelectChannels[ i ] == UNDEFINED_CHANNEL )
+                continue;
+            mChipSelectStreams[ i ].SetChannelData( GetAnalyzerChannelData( mChipSelectChannels[ i ] ) );
+            chip_selects[ i ] = &mChipSelectStreams[ i ];
         }
-        else
-        {
-            mEnable->AdvanceToNextEdge();
-            mEnable->AdvanceToNextEdge();
-        }
-        mCurrentSample = mEnable->GetSampleNumber();
-        mClock->AdvanceToAbsPosition( mCurrentSample );
+        mChipSelects.Setup( chip_selects.data(), U32( chip_selects.size() ), decoder_settings.mEnableActiveState, sink, this );
+        enable = &mChipSelects;
     }
-    else
+    else if( mSettings->mEnableChannel != UNDEFINED_CHANNEL )
     {
-        mCurrentSample = mClock->GetSampleNumber();
+        mEnable.SetChannelData( GetAnalyzerChannelData( mSettings->mEnableChannel ), this );
+        enable = &mEnable;
     }
-}
 
-bool SpiAnalyzer::IsInitialClockPolarityCorrect()
-{
-    if( mClock->GetBitState() == mSettings->mClockInactiveState )
-        return true;
+    // half the latency target for publishing; the rest is for the capture to reach the analyzer.
+    U32 commit_interval_ms = mSettings->mCommitIntervalMs;
+    mLiveLatency = mSettings->mLiveLatencyTargetMs > 0;
+    if( mLiveLatency )
+        commit_interval_ms = std::min( commit_interval_ms, mSettings->mLiveLatencyTargetMs / 2 );
+    mCommitScheduler.Setup( mSettings->mCommitBatchWords, commit_interval_ms, mLiveLatency );
 
-    mResults->AddMarker( mCurrentSample, AnalyzerResults::ErrorSquare, mSettings->mClockChannel );
+    mPacketHasFrames = false;
 
-    if( mEnable != NULL )
-    {
-        Frame error_frame;
-        error_frame.mStartingSampleInclusive = mCurrentSample;
+    mTransactionFrames = mSettings->mFrameV2Mode == SpiFrameV2Transactions && enable != NULL;
+    mTransactionWords = 0;
+    mTransactionMosi.clear();
+    mTransactionMiso.clear();
+    mProgressSample = 0;
 
-        mEnable->AdvanceToNextEdge();
-        mCurrentSample = mEnable->GetSampleNumber();
+    mWideLanes = mSettings->mDataLanes > 1;
+    mPayloadIndex = mSettings->mPayloadIndexMode == SpiPayloadIndexBuilt;
 
-        error_frame.mEndingSampleInclusive = mCurrentSample;
-        error_frame.mFlags = SPI_ERROR_FLAG | DISPLAY_AS_ERROR_FLAG;
-        mResults->AddFrame( error_frame );
+    mDecoder.Setup( decoder_settings, &mClock, mosi, miso, enable, sink );
+    if( mChipSelectChannels.empty() == false )
+        mDecoder.SetupChipSelects( &mChipSelects );
 
-        FrameV2 framev2;
-        mResults->AddFrameV2( framev2, "error", error_frame.mStartingSampleInclusive, error_frame.mEndingSampleInclusive + 1 );
+    if( mSettings->mDataLanes == 4 )
+    {
+        mIo2.SetChannelData( GetAnalyzerChannelData( mSettings->mIo2Channel ) );
+        mIo3.SetChannelData( GetAnalyzerChannelData( mSettings->mIo3Channel ) );
+        mDecoder.SetupWideLanes( &mIo2, &mIo3 );
+    }
+}
 
-        mResults->CommitResults();
-        ReportProgress( error_frame.mEndingSampleInclusive );
+void SpiAnalyzer::OnPacketBoundary()
+{
+    U64 packet_id = mResults->CommitPacketAndStartNewPacket();
+    if( mPacketHasFrames && packet_id != INVALID_RESULT_INDEX )
+        mResults->AddPacketFrames( packet_id, mPacketFirstFrame, mPacketLastFrame );
+    mPacketHasFrames = false;
 
-        // move to the next active-going enable edge
-        mEnable->AdvanceToNextEdge();
-        mCurrentSample = mEnable->GetSampleNumber();
-        mClock->AdvanceToAbsPosition( mCurrentSample );
+    mCommitScheduler.AddEvent();
+}
 
-        return false;
-    }
-    else
+void SpiAnalyzer::AddFrameToPacket( U64 frame_index )
+{
+    if( mPacketHasFrames == false )
     {
-        mClock->AdvanceToNextEdge(); // at least start with the clock in the idle state.
-        mCurrentSample = mClock->GetSampleNumber();
-        return true;
+        mPacketFirstFrame = frame_index;
+        mPacketHasFrames = true;
     }
+    mPacketLastFrame = frame_index;
 }
 
-bool SpiAnalyzer::WouldAdvancingTheClockToggleEnable( bool add_disable_frame, U64* disable_frame )
+void SpiAnalyzer::AddSlave( FrameV2& framev2, uint32_t slave )
 {
-    if( mEnable == NULL )
-        return false;
+    if( mChipSelectChannels.empty() == false )
+        framev2.AddInteger( "cs", S64( slave ) );
+}
 
-    auto log_disable_event = [&]( U64 enable_edge ) {
-        if( add_disable_frame )
-        {
-            FrameV2 frame_v2_end_of_transaction;
-            mResults->AddFrameV2( frame_v2_end_of_transaction, "disable", enable_edge, enable_edge + 1 );
-        }
-        else if( disable_frame != nullptr )
-        {
-            *disable_frame = enable_edge;
-        }
-    };
+void SpiAnalyzer::OnEnable( uint64_t sample, uint32_t slave )
+{
+    if( mPayloadIndex )
+        mResults->EndIndexedStreams();
 
-    // if the enable is currently active, and there are no more clock transitions in the capture, attempt to capture the final disable event
-    if( !mClock->DoMoreTransitionsExistInCurrentData() && mEnable->GetBitState() == mSettings->mEnableActiveState )
+    if( mTransactionFrames )
     {
-        if( mEnable->DoMoreTransitionsExistInCurrentData() )
-        {
-            U64 next_enable_edge = mEnable->GetSampleOfNextEdge();
-            // double check that the clock line actually processed all samples up to the next enable edge.
-            // double check is required becase data is getting processed while we're running, it's possible more has already become
-            // available.
-            if( !mClock->WouldAdvancingToAbsPositionCauseTransition( next_enable_edge ) )
-            {
-                log_disable_event( next_enable_edge );
-                return true;
-            }
-        }
+        mTransactionStart = sample;
+        mTransactionSlave = slave;
+        mTransactionWords = 0;
+        mTransactionMosi.clear();
+        mTransactionMiso.clear();
+        return;
     }
 
-    U64 next_edge = mClock->GetSampleOfNextEdge();
-    bool enable_will_toggle = mEnable->WouldAdvancingToAbsPositionCauseTransition( next_edge );
+    FrameV2 frame_v2_start_of_transaction;
+    AddSlave( frame_v2_start_of_transaction, slave );
+    mResults->AddFrameV2( frame_v2_start_of_transaction, "enable", sample, sample + 1 );
+    mCommitScheduler.AddEvent();
+}
 
-    if( enable_will_toggle )
+void SpiAnalyzer::OnDisable( uint64_t sample, uint32_t slave )
+{
+    if( mTransactionFrames )
     {
-        U64 enable_edge = mEnable->GetSampleOfNextEdge();
-        log_disable_event( enable_edge );
+        AddTransactionFrame( sample + 1 );
+        return;
     }
 
-    if( enable_will_toggle == false )
-        return false;
-    else
-        return true;
+    FrameV2 frame_v2_end_of_transaction;
+    AddSlave( frame_v2_end_of_transaction, slave );
+    mResults->AddFrameV2( frame_v2_end_of_transaction, "disable", sample, sample + 1 );
+    mCommitScheduler.AddEvent();
 }
 
-void SpiAnalyzer::GetWord()
+void SpiAnalyzer::AddTransactionFrame( U64 ending_sample )
 {
-    // we're assuming we come into this function with the clock in the idle state;
-
-    const U32 bits_per_transfer = mSettings->mBitsPerTransfer;
-    const U32 bytes_per_transfer = ( bits_per_transfer + 7 ) / 8;
-
-    U64 mosi_word = 0;
-    mMosiResult.Reset( &mosi_word, mSettings->mShiftOrder, bits_per_transfer );
-
-    U64 miso_word = 0;
-    mMisoResult.Reset( &miso_word, mSettings->mShiftOrder, bits_per_transfer );
-
-    U64 first_sample = 0;
-    bool need_reset = false;
-    U64 disable_event_sample = 0;
-
-
-    mArrowLocations.clear();
-    ReportProgress( mClock->GetSampleNumber() );
-
-    for( U32 i = 0; i < bits_per_transfer; i++ )
+    FrameV2 framev2;
+    if( mWideLanes )
+    {
+        framev2.AddByteArray( "data", mTransactionMosi.data(), mTransactionMosi.size() );
+    }
+    else
     {
-        if( i == 0 )
-            CheckIfThreadShouldExit();
+        framev2.AddByteArray( "mosi", mTransactionMosi.data(), mTransactionMosi.size() );
+        framev2.AddByteArray( "miso", mTransactionMiso.data(), mTransactionMiso.size() );
+    }
+    framev2.AddInteger( "words", S64( mTransactionWords ) );
+    AddSlave( framev2, mTransactionSlave );
+    mResults->AddFrameV2( framev2, "transaction", mTransactionStart, ending_sample );
+    mCommitScheduler.AddEvent();
+}
 
-        // on every single edge, we need to check that enable doesn't toggle.
-        // note that we can't just advance the enable line to the next edge, becuase there may not be another edge
+void SpiAnalyzer::OnClockPolarityError( uint64_t sample )
+{
+    mResults->AddMarker( sample, AnalyzerResults::ErrorSquare, mSettings->mClockChannel );
+}
 
-        if( WouldAdvancingTheClockToggleEnable( true, nullptr ) == true )
-        {
-            AdvanceToActiveEnableEdgeWithCorrectClockPolarity(); // ok, we pretty much need to reset everything and return.
-            return;
-        }
+void SpiAnalyzer::OnErrorFrame( uint64_t starting_sample, uint64_t ending_sample, uint32_t slave )
+{
+    if( mPayloadIndex )
+        mResults->EndIndexedStreams();
 
-        mClock->AdvanceToNextEdge();
-        if( i == 0 )
-            first_sample = mClock->GetSampleNumber();
+    Frame error_frame;
+    error_frame.mType = U8( slave );
+    error_frame.mStartingSampleInclusive = starting_sample;
+    error_frame.mEndingSampleInclusive = ending_sample;
+    error_frame.mFlags = SPI_ERROR_FLAG | DISPLAY_AS_ERROR_FLAG;
+    AddFrameToPacket( mResults->AddFrame( error_frame ) );
 
-        if( mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge )
-        {
-            mCurrentSample = mClock->GetSampleNumber();
-            if( mMosi != NULL )
-            {
-                mMosi->AdvanceToAbsPosition( mCurrentSample );
-                mMosiResult.AddBit( mMosi->GetBitState() );
-            }
-            if( mMiso != NULL )
-            {
-                mMiso->AdvanceToAbsPosition( mCurrentSample );
-                mMisoResult.AddBit( mMiso->GetBitState() );
-            }
-            mArrowLocations.push_back( mCurrentSample );
-        }
+    FrameV2 framev2;
+    AddSlave( framev2, slave );
+    mResults->AddFrameV2( framev2, "error", starting_sample, ending_sample + 1 );
 
+    mProgressSample = ending_sample;
+    mCommitScheduler.AddEvent();
+}
 
-        // ok, the trailing edge is messy -- but only on the very last bit.
-        // If the trialing edge isn't doesn't represent valid data, we want to allow the enable line to rise before the clock trialing edge
-        // -- and still report the frame
-        if( ( i == ( bits_per_transfer - 1 ) ) && ( mSettings->mDataValidEdge != AnalyzerEnums::TrailingEdge ) )
-        {
-            // if this is the last bit, and the trailing edge doesn't represent valid data
-            if( WouldAdvancingTheClockToggleEnable( false, &disable_event_sample ) == true )
-            {
-                // moving to the trailing edge would cause the clock to revert to inactive.  jump out, record the frame, and them move to
-                // the next active enable edge
-                need_reset = true;
-                break;
-            }
-
-            // enable isn't going to go inactive, go ahead and advance the clock as usual.  Then we're done, jump out and record the frame.
-            mClock->AdvanceToNextEdge();
-            break;
-        }
+void SpiAnalyzer::OnWord( const SpiWord& word )
+{
+    const U32 bytes_per_transfer = ( mSettings->mBitsPerTransfer + 7 ) / 8;
 
-        // this isn't the very last bit, etc, so proceed as normal
-        if( WouldAdvancingTheClockToggleEnable( true, nullptr ) == true )
-        {
-            AdvanceToActiveEnableEdgeWithCorrectClockPolarity(); // ok, we pretty much need to reset everything and return.
-            return;
-        }
+    for( U32 i = 0; i < word.mArrowCount; i++ )
+        mResults->AddMarker( word.mArrowLocations[ i ], mArrowMarker, mSettings->mClockChannel );
 
-        mClock->AdvanceToNextEdge();
+    Frame result_frame;
+    result_frame.mStartingSampleInclusive = word.mStartingSample;
+    result_frame.mEndingSampleInclusive = word.mEndingSample;
+    result_frame.mData1 = word.mMosi;
+    result_frame.mData2 = word.mMiso;
+    result_frame.mFlags = word.mDataLanes > 1 ? SPI_WIDE_WORD_FLAG : 0;
+    result_frame.mType = U8( word.mSlave );
+    const U64 frame_index = mResults->AddFrame( result_frame );
+    AddFrameToPacket( frame_index );
+
+    if( mPayloadIndex )
+    {
+        // in dual and quad I/O, MISO only carries IO1 of the single-bit words
+        const bool has_mosi = mSettings->mMosiChannel != UNDEFINED_CHANNEL;
+        const bool has_miso = mSettings->mMisoChannel != UNDEFINED_CHANNEL && word.mDataLanes == 1;
+        mResults->AddIndexedWord( frame_index, has_mosi ? word.mMosiBytes : NULL, has_miso ? word.mMisoBytes : NULL );
+    }
 
-        if( mSettings->mDataValidEdge == AnalyzerEnums::TrailingEdge )
-        {
-            mCurrentSample = mClock->GetSampleNumber();
-            if( mMosi != NULL )
-            {
-                mMosi->AdvanceToAbsPosition( mCurrentSample );
-                mMosiResult.AddBit( mMosi->GetBitState() );
-            }
-            if( mMiso != NULL )
-            {
-                mMiso->AdvanceToAbsPosition( mCurrentSample );
-                mMisoResult.AddBit( mMiso->GetBitState() );
-            }
-            mArrowLocations.push_back( mCurrentSample );
-        }
+    if( mTransactionFrames )
+    {
+        mTransactionMosi.insert( mTransactionMosi.end(), word.mMosiBytes, word.mMosiBytes + bytes_per_transfer );
+        if( mWideLanes == false )
+            mTransactionMiso.insert( mTransactionMiso.end(), word.mMisoBytes, word.mMisoBytes + bytes_per_transfer );
+        mTransactionWords++;
+    }
+    else if( mWideLanes )
+    {
+        // single-bit words too: in dual and quad I/O, MISO only ever carries IO1
+        FrameV2 framev2;
+        framev2.AddByteArray( "data", word.mMosiBytes, bytes_per_transfer );
+        framev2.AddInteger( "lanes", S64( word.mDataLanes ) );
+        AddSlave( framev2, word.mSlave );
+        mResults->AddFrameV2( framev2, "result", word.mStartingSample, word.mEndingSample + 1 );
+    }
+    else
+    {
+        FrameV2 framev2;
+        framev2.AddByteArray( "mosi", word.mMosiBytes, bytes_per_transfer );
+        framev2.AddByteArray( "miso", word.mMisoBytes, bytes_per_transfer );
+        AddSlave( framev2, word.mSlave );
+        mResults->AddFrameV2( framev2, "result", word.mStartingSample, word.mEndingSample + 1 );
     }
 
-    // save the results:
-    U32 count = mArrowLocations.size();
-    for( U32 i = 0; i < count; i++ )
-        mResults->AddMarker( mArrowLocations[ i ], mArrowMarker, mSettings->mClockChannel );
+    if( mCommitScheduler.AddWord() )
+        CommitPendingResults();
+}
 
-    Frame result_frame;
-    result_frame.mStartingSampleInclusive = first_sample;
-    result_frame.mEndingSampleInclusive = mClock->GetSampleNumber();
-    result_frame.mData1 = mosi_word;
-    result_frame.mData2 = miso_word;
-    result_frame.mFlags = 0;
-    mResults->AddFrame( result_frame );
+void SpiAnalyzer::OnRepeat( uint64_t first_sample, uint64_t last_sample, uint64_t count, uint32_t slave, const SpiWord* words,
+                            size_t word_count )
+{
+    const U32 bytes_per_transfer = ( mSettings->mBitsPerTransfer + 7 ) / 8;
+
+    Frame repeat_frame;
+    repeat_frame.mStartingSampleInclusive = first_sample;
+    repeat_frame.mEndingSampleInclusive = last_sample;
+    repeat_frame.mData1 = count;
+    repeat_frame.mData2 = word_count;
+    repeat_frame.mFlags = SPI_REPEAT_FLAG;
+    repeat_frame.mType = U8( slave );
+    AddFrameToPacket( mResults->AddFrame( repeat_frame ) );
+    if( mPayloadIndex )
+        mResults->EndIndexedStreams();
+
+    // runs end between enable windows, so the transaction buffers are free
+    mTransactionMosi.clear();
+    mTransactionMiso.clear();
+    for( size_t i = 0; i < word_count; i++ )
+    {
+        mTransactionMosi.insert( mTransactionMosi.end(), words[ i ].mMosiBytes, words[ i ].mMosiBytes + bytes_per_transfer );
+        if( mWideLanes == false )
+            mTransactionMiso.insert( mTransactionMiso.end(), words[ i ].mMisoBytes, words[ i ].mMisoBytes + bytes_per_transfer );
+    }
 
     FrameV2 framev2;
-
-    // Max bits per transfer == 64, max bytes == 8
-    U8 mosi_bytearray[ 8 ];
-    U8 miso_bytearray[ 8 ];
-    for( int i = 0; i < bytes_per_transfer; ++i )
+    framev2.AddInteger( "count", S64( count ) );
+    framev2.AddInteger( "words", S64( word_count ) );
+    if( mWideLanes )
     {
-        auto bit_offset = ( bytes_per_transfer - i - 1 ) * 8;
-        mosi_bytearray[ i ] = mosi_word >> bit_offset;
-        miso_bytearray[ i ] = miso_word >> bit_offset;
+        framev2.AddByteArray( "data", mTransactionMosi.data(), mTransactionMosi.size() );
     }
-    framev2.AddByteArray( "mosi", mosi_bytearray, bytes_per_transfer );
-    framev2.AddByteArray( "miso", miso_bytearray, bytes_per_transfer );
+    else
+    {
+        framev2.AddByteArray( "mosi", mTransactionMosi.data(), mTransactionMosi.size() );
+        framev2.AddByteArray( "miso", mTransactionMiso.data(), mTransactionMiso.size() );
+    }
+    AddSlave( framev2, slave );
+    mResults->AddFrameV2( framev2, "repeat", first_sample, last_sample + 1 );
+    mCommitScheduler.AddEvent();
+}
 
-    mResults->AddFrameV2( framev2, "result", first_sample, mClock->GetSampleNumber() + 1 );
+void SpiAnalyzer::OnChipSelectOverlap( uint64_t sample, uint32_t slave )
+{
+    // on the chip select of the slave that went active, so each channel gets its markers in order even though the mux reports overlaps
+    // ahead of the words around them.
+    mResults->AddMarker( sample, AnalyzerResults::ErrorX, mChipSelectChannels[ slave ] );
+}
 
-    mResults->CommitResults();
+void SpiAnalyzer::OnProgress( uint64_t sample )
+{
+    // reported along with the results, so progress never runs ahead of what has been published.
+    mProgressSample = sample;
+}
 
-    if( need_reset == true )
-    {
-        FrameV2 frame_v2_end_of_transaction;
-        mResults->AddFrameV2( frame_v2_end_of_transaction, "disable", disable_event_sample, disable_event_sample + 1 );
-        AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
-    }
+void SpiAnalyzer::PollForExit()
+{
+    CheckIfThreadShouldExit();
+}
+
+void SpiAnalyzer::OnCaughtUpWithCapture()
+{
+    // a run of repeats can go on for as long as the capture does, and the window held as its next copy may be the capture's last;
+    // show both. A copy cut short here is shown as a window of its own, splitting the run. The payload filter's window stays held
+    // until enough of its bytes are in: passing it on early could show a transaction that doesn't match.
+    if( mCollapseRepeats )
+        mRepeats.Finish();
+    if( mCommitScheduler.HasPending() )
+        CommitPendingResults();
+}
+
+void SpiAnalyzer::CommitPendingResults()
+{
+    mResults->CommitResults();
+    ReportProgress( mProgressSample );
+    mCommitScheduler.Committed();
 }
 
 bool SpiAnalyzer::NeedsRerun()
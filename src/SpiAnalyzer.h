@@ -4,9 +4,19 @@
 #include <Analyzer.h>
 #include "SpiAnalyzerResults.h"
 #include "SpiSimulationDataGenerator.h"
+#include "SpiDecoder.h"
+#include "SpiChannelDataStream.h"
+#include "SpiChipSelectMux.h"
+#include "SpiCommitScheduler.h"
+#include "SpiPayloadFilter.h"
+#include "SpiRepeatCollapser.h"
+#include <vector>
 
 class SpiAnalyzerSettings;
-class SpiAnalyzer : public Analyzer2
+class SpiAnalyzer : public Analyzer2,
+                    public SpiRepeatCollapser::RepeatSink,
+                    public SpiChannelDataStream::IdleListener,
+                    public SpiChipSelectMux::IdleListener
 {
   public:
     SpiAnalyzer();
@@ -22,11 +32,30 @@ class SpiAnalyzer : public Analyzer2
 
   protected: // functions
     void Setup();
-    void AdvanceToActiveEnableEdge();
-    bool IsInitialClockPolarityCorrect();
-    void AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
-    bool WouldAdvancingTheClockToggleEnable( bool add_disable_frame, U64* disable_frame );
-    void GetWord();
+
+    // SpiDecoderSink
+    virtual void OnPacketBoundary();
+    virtual void OnEnable( uint64_t sample, uint32_t slave );
+    virtual void OnDisable( uint64_t sample, uint32_t slave );
+    virtual void OnClockPolarityError( uint64_t sample );
+    virtual void OnErrorFrame( uint64_t starting_sample, uint64_t ending_sample, uint32_t slave );
+    virtual void OnWord( const SpiWord& word );
+    virtual void OnChipSelectOverlap( uint64_t sample, uint32_t slave );
+    virtual void OnProgress( uint64_t sample );
+    virtual void PollForExit();
+
+    // SpiRepeatCollapser::RepeatSink
+    virtual void OnRepeat( uint64_t first_sample, uint64_t last_sample, uint64_t count, uint32_t slave, const SpiWord* words,
+                           size_t word_count );
+
+    // SpiChannelDataStream::IdleListener and SpiChipSelectMux::IdleListener
+    virtual void OnCaughtUpWithCapture();
+
+    void CommitPendingResults();
+    void AddTransactionFrame( U64 ending_sample );
+    void AddFrameToPacket( U64 frame_index );
+    // with several slaves, tells a FrameV2 which one it belongs to
+    void AddSlave( FrameV2& framev2, uint32_t slave );
 
 #pragma warning( push )
 #pragma warning(                                                                                                                           \
@@ -37,16 +66,51 @@ class SpiAnalyzer : public Analyzer2
     bool mSimulationInitilized;
     SpiSimulationDataGenerator mSimulationDataGenerator;
 
-    AnalyzerChannelData* mMosi;
-    AnalyzerChannelData* mMiso;
-    AnalyzerChannelData* mClock;
-    AnalyzerChannelData* mEnable;
+    SpiChannelDataStream mMosi;
+    SpiChannelDataStream mMiso;
+    SpiChannelDataStream mClock;
+    SpiChannelDataStream mEnable;
+    SpiChannelDataStream mIo2;
+    SpiChannelDataStream mIo3;
+    SpiDecoder mDecoder;
+
+    // several slaves on the bus: the enable line of each, slave 0 first, read together as the decoder's enable line
+    std::vector<Channel> mChipSelectChannels;
+    std::vector<SpiChannelDataStream> mChipSelectStreams;
+    SpiChipSelectMux mChipSelects;
+
+    SpiCommitScheduler mCommitScheduler;
+    U64 mProgressSample;
+
+    // publish in time for the live latency target
+    bool mLiveLatency;
 
-    U64 mCurrentSample;
     AnalyzerResults::MarkerType mArrowMarker;
-    std::vector<U64> mArrowLocations;
-    DataBuilder mMosiResult;
-    DataBuilder mMisoResult;
+
+    // frames added since the last packet was committed
+    bool mPacketHasFrames;
+    U64 mPacketFirstFrame;
+    U64 mPacketLastFrame;
+
+    // one "transaction" FrameV2 per enable window, instead of "enable", "result" and "disable"
+    bool mTransactionFrames;
+    U64 mTransactionStart;
+    uint32_t mTransactionSlave;
+    U64 mTransactionWords;
+    std::vector<U8> mTransactionMosi;
+    std::vector<U8> mTransactionMiso;
+
+    // dual or quad I/O: words carry "data" from all lanes instead of "mosi" and "miso"
+    bool mWideLanes;
+
+    // the words of each data frame go to the payload search index in the results
+    bool mPayloadIndex;
+
+    // between the decoder and the analyzer, in this order: the payload filter, when set, and the repeat collapser, when identical
+    // repeats are collapsed
+    SpiPayloadFilter mPayloadFilter;
+    bool mCollapseRepeats;
+    SpiRepeatCollapser mRepeats;
 
 
 #pragma warning( pop )
@@ -2,14 +2,49 @@
 #include <AnalyzerHelpers.h>
 #include "SpiAnalyzer.h"
 #include "SpiAnalyzerSettings.h"
+#include "SpiExportBuffer.h"
+#include "SpiExportFormat.h"
+#include "SpiFrameFile.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #pragma warning( disable : 4996 ) // warning C4996: 'sprintf': This function or variable may be unsafe. Consider using sprintf_s instead.
 
+namespace
+{
+    // the cancel check is too slow to make for every row of a long export
+    const U32 kExportFramesPerProgressUpdate = 4096;
+    const U64 kExportTimeProbes = 256;
+    // payload bytes per channel shown for a packet
+    const U32 kPacketDumpBytes = 32;
+    // both channels of a few thousand frames, more bubbles than fit on a screen
+    const size_t kBubbleCacheEntries = 8192;
+
+    // a frame's flags in a binary frame file
+    U8 FrameFileFlags( const Frame& frame )
+    {
+        U8 flags = ( frame.mFlags & SPI_ERROR_FLAG ) != 0 ? kSpiFrameFileErrorFlag : 0;
+        if( ( frame.mFlags & SPI_WIDE_WORD_FLAG ) != 0 )
+            flags |= kSpiFrameFileWideWordFlag;
+        if( ( frame.mFlags & SPI_REPEAT_FLAG ) != 0 )
+            flags |= kSpiFrameFileRepeatFlag;
+        return flags | ( U8( frame.mType << kSpiFrameFileSlaveShift ) & kSpiFrameFileSlaveMask );
+    }
+}
+
 SpiAnalyzerResults::SpiAnalyzerResults( SpiAnalyzer* analyzer, SpiAnalyzerSettings* settings )
-    : AnalyzerResults(), mSettings( settings ), mAnalyzer( analyzer )
+    : AnalyzerResults(),
+      mSettings( settings ),
+      mAnalyzer( analyzer ),
+      mBubbleCache( kBubbleCacheEntries ),
+      mBubbleCacheMosiChannel( settings->mMosiChannel ),
+      mBubbleCacheBitsPerTransfer( settings->mBitsPerTransfer )
 {
+    mPayloadIndex.Setup( settings->mBitsPerTransfer );
 }
 
 SpiAnalyzerResults::~SpiAnalyzerResults()
@@ -20,22 +55,51 @@ void SpiAnalyzerResults::GenerateBubbleText( U64 frame_index, Channel& channel,
                                              DisplayBase display_base ) // unrefereced vars commented out to remove warnings.
 {
     ClearResultStrings();
-    Frame frame = GetFrame( frame_index );
 
-    if( ( frame.mFlags & SPI_ERROR_FLAG ) == 0 )
+    // a frame index leaves room for the channel and display base in the key.
+    const bool is_mosi = channel == mSettings->mMosiChannel;
+    const U64 key = ( frame_index << 4 ) | ( U64( display_base ) << 1 ) | ( is_mosi ? 1 : 0 );
+
+    std::lock_guard<std::mutex> lock( mBubbleCacheMutex );
+    if( mBubbleCacheMosiChannel != mSettings->mMosiChannel || mBubbleCacheBitsPerTransfer != mSettings->mBitsPerTransfer )
+    {
+        mBubbleCache.Clear();
+        mBubbleCacheMosiChannel = mSettings->mMosiChannel;
+        mBubbleCacheBitsPerTransfer = mSettings->mBitsPerTransfer;
+    }
+
+    const BubbleText* bubble = mBubbleCache.Find( key );
+    if( bubble == NULL )
     {
-        if( channel == mSettings->mMosiChannel )
+        Frame frame = GetFrame( frame_index );
+        BubbleText& text = mBubbleCache.Insert( key );
+        text.mIsError = ( frame.mFlags & SPI_ERROR_FLAG ) != 0;
+        text.mRepeatCount = 0;
+        text.mText[ 0 ] = '\0';
+        // a dual or quad I/O word is shown once, on MOSI (IO0), and so is a repeat count, unless there's only MISO
+        if( ( frame.mFlags & SPI_REPEAT_FLAG ) != 0 )
         {
-            char number_str[ 128 ];
-            AnalyzerHelpers::GetNumberString( frame.mData1, display_base, mSettings->mBitsPerTransfer, number_str, 128 );
-            AddResultString( number_str );
+            if( is_mosi || mSettings->mMosiChannel == UNDEFINED_CHANNEL )
+                text.mRepeatCount = frame.mData1;
         }
-        else
+        else if( text.mIsError == false && ( is_mosi || ( frame.mFlags & SPI_WIDE_WORD_FLAG ) == 0 ) )
         {
-            char number_str[ 128 ];
-            AnalyzerHelpers::GetNumberString( frame.mData2, display_base, mSettings->mBitsPerTransfer, number_str, 128 );
-            AddResultString( number_str );
+            FormatNumber( is_mosi ? frame.mData1 : frame.mData2, display_base, text.mText );
         }
+        bubble = &text;
+    }
+
+    if( bubble->mRepeatCount != 0 )
+    {
+        std::stringstream count;
+        count << bubble->mRepeatCount;
+        AddResultString( "x", count.str().c_str() );
+        AddResultString( count.str().c_str(), bubble->mRepeatCount == 1 ? " repeat" : " repeats" );
+    }
+    else if( bubble->mIsError == false )
+    {
+        if( bubble->mText[ 0 ] != '\0' )
+            AddResultString( bubble->mText );
     }
     else
     {
@@ -45,19 +109,22 @@ void SpiAnalyzerResults::GenerateBubbleText( U64 frame_index, Channel& channel,
     }
 }
 
-void SpiAnalyzerResults::GenerateExportFile( const char* file, DisplayBase display_base, U32 /*export_type_user_id*/ )
+void SpiAnalyzerResults::GenerateExportFile( const char* file, DisplayBase display_base, U32 export_type_user_id )
 {
-    // export_type_user_id is only important if we have more than one export type.
-
+    if( export_type_user_id == SpiFrameFileExport )
+        GenerateFrameFileExportFile( file );
+    else
+        GenerateCsvExportFile( file, display_base );
+}
 
-    std::stringstream ss;
-    void* f = AnalyzerHelpers::StartFile( file );
+void SpiAnalyzerResults::GenerateCsvExportFile( const char* file, DisplayBase display_base )
+{
+    SpiExportBuffer output;
+    output.Start( file, false );
 
     U64 trigger_sample = mAnalyzer->GetTriggerSample();
     U32 sample_rate = mAnalyzer->GetSampleRate();
 
-    ss << "Time [s],Packet ID,MOSI,MISO" << std::endl;
-
     bool mosi_used = true;
     bool miso_used = true;
 
@@ -67,43 +134,211 @@ void SpiAnalyzerResults::GenerateExportFile( const char* file, DisplayBase displ
     if( mSettings->mMisoChannel == UNDEFINED_CHANNEL )
         miso_used = false;
 
+    // dual and quad I/O: one data column, and the number of lanes each word was read across
+    const bool wide_lanes = mSettings->mDataLanes > 1;
+    if( wide_lanes )
+        miso_used = false;
+    // several chip selects: the slave of each word in a column after the data
+    const bool slave_column = mSettings->HasSlaveEnables();
+    // collapsed repeats: a row with how many copies of the transaction before there were, in a last column
+    const bool repeat_column = mSettings->mRepeatMode == SpiRepeatsCollapsed;
+
     U64 num_frames = GetNumFrames();
+
+    // check the fast time formatting against times from across the capture.
+    std::vector<U64> probe_samples;
+    for( U64 i = 0; i < kExportTimeProbes && i < num_frames; i++ )
+        probe_samples.push_back( GetFrame( i * num_frames / std::min<U64>( num_frames, kExportTimeProbes ) ).mStartingSampleInclusive );
+
+    SpiTimeFormatter time_formatter;
+    time_formatter.Setup( trigger_sample, sample_rate, probe_samples.data(), probe_samples.size() );
+    SpiNumberFormatter number_formatter;
+    number_formatter.Setup( display_base, mSettings->mBitsPerTransfer );
+
+    // the header goes out with the first row, so an export without any rows is empty.
+    bool header_written = false;
+
     for( U32 i = 0; i < num_frames; i++ )
     {
+        if( ( i % kExportFramesPerProgressUpdate ) == 0 && UpdateExportProgressAndCheckForCancel( i, num_frames ) == true )
+        {
+            output.End();
+            return;
+        }
+
         Frame frame = GetFrame( i );
 
         if( ( frame.mFlags & SPI_ERROR_FLAG ) != 0 )
             continue;
 
-        char time_str[ 128 ];
-        AnalyzerHelpers::GetTimeString( frame.mStartingSampleInclusive, trigger_sample, sample_rate, time_str, 128 );
+        if( header_written == false )
+        {
+            const char header[] = "Time [s],Packet ID,MOSI,MISO";
+            const char wide_header[] = "Time [s],Packet ID,Data,Lanes";
+            const char slave_header[] = ",Slave";
+            const char repeat_header[] = ",Repeats";
+            if( wide_lanes )
+                output.Append( wide_header, sizeof( wide_header ) - 1 );
+            else
+                output.Append( header, sizeof( header ) - 1 );
+            if( slave_column )
+                output.Append( slave_header, sizeof( slave_header ) - 1 );
+            if( repeat_column )
+                output.Append( repeat_header, sizeof( repeat_header ) - 1 );
+            output.Append( "\n", 1 );
+            header_written = true;
+        }
 
-        char mosi_str[ 128 ] = "";
-        if( mosi_used == true )
-            AnalyzerHelpers::GetNumberString( frame.mData1, display_base, mSettings->mBitsPerTransfer, mosi_str, 128 );
+        char* row = output.Reserve( SpiTimeFormatter::kMaxLength + 2 * SpiNumberFormatter::kMaxLength + 56 );
+        char* p = row;
 
-        char miso_str[ 128 ] = "";
-        if( miso_used == true )
-            AnalyzerHelpers::GetNumberString( frame.mData2, display_base, mSettings->mBitsPerTransfer, miso_str, 128 );
+        p += time_formatter.Format( frame.mStartingSampleInclusive, p );
+        *p++ = ',';
 
         U64 packet_id = GetPacketContainingFrameSequential( i );
-        if( packet_id != INVALID_RESULT_INDEX )
-            ss << time_str << "," << packet_id << "," << mosi_str << "," << miso_str << std::endl;
-        else
-            ss << time_str << ",," << mosi_str << "," << miso_str << std::endl; // it's ok for a frame not to be included in a packet.
+        if( packet_id != INVALID_RESULT_INDEX ) // it's ok for a frame not to be included in a packet.
+            p += SpiFormatDecimal( packet_id, p );
+        *p++ = ',';
+
+        const bool repeat = ( frame.mFlags & SPI_REPEAT_FLAG ) != 0;
+        if( mosi_used == true && repeat == false )
+            p += number_formatter.Format( frame.mData1, p );
+        *p++ = ',';
+
+        if( repeat == false && wide_lanes )
+            p += SpiFormatDecimal( ( frame.mFlags & SPI_WIDE_WORD_FLAG ) != 0 ? mSettings->mDataLanes : 1, p );
+        else if( repeat == false && miso_used == true )
+            p += number_formatter.Format( frame.mData2, p );
+        if( slave_column )
+        {
+            *p++ = ',';
+            p += SpiFormatDecimal( frame.mType, p );
+        }
+        if( repeat_column )
+        {
+            *p++ = ',';
+            if( repeat )
+                p += SpiFormatDecimal( frame.mData1, p );
+        }
+        *p++ = '\n';
+
+        output.Commit( p - row );
+    }
 
-        AnalyzerHelpers::AppendToFile( ( U8* )ss.str().c_str(), ss.str().length(), f );
-        ss.str( std::string() );
+    UpdateExportProgressAndCheckForCancel( num_frames, num_frames );
+    output.End();
+}
+
+void SpiAnalyzerResults::GenerateFrameFileExportFile( const char* file )
+{
+    SpiExportBuffer output;
+    output.Start( file, true );
 
-        if( UpdateExportProgressAndCheckForCancel( i, num_frames ) == true )
+    U64 num_frames = GetNumFrames();
+
+    SpiFrameFileHeader header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.mMagic, kSpiFrameFileMagic, sizeof( header.mMagic ) );
+    header.mVersion = kSpiFrameFileVersion;
+    header.mHeaderSize = sizeof( header );
+    header.mFrameCount = num_frames;
+    header.mTriggerSample = mAnalyzer->GetTriggerSample();
+    header.mSampleRate = mAnalyzer->GetSampleRate();
+    header.mBitsPerTransfer = mSettings->mBitsPerTransfer;
+    if( mSettings->mMosiChannel != UNDEFINED_CHANNEL )
+        header.mChannels |= kSpiFrameFileMosiUsed;
+    if( mSettings->mMisoChannel != UNDEFINED_CHANNEL )
+        header.mChannels |= kSpiFrameFileMisoUsed;
+    header.mDataLanes = mSettings->mDataLanes;
+    output.Append( &header, sizeof( header ) );
+
+    // the file is written front to back, so each column takes its own pass over the frames.
+    enum Column
+    {
+        StartSample,
+        EndSample,
+        Mosi,
+        Miso,
+        PacketId,
+        Flags,
+        ColumnCount
+    };
+
+    for( U32 column = 0; column < ColumnCount; column++ )
+    {
+        for( U64 i = 0; i < num_frames; i++ )
         {
-            AnalyzerHelpers::EndFile( f );
-            return;
+            if( ( i % kExportFramesPerProgressUpdate ) == 0 &&
+                UpdateExportProgressAndCheckForCancel( column * num_frames + i, ColumnCount * num_frames ) == true )
+            {
+                output.End();
+                return;
+            }
+
+            if( column == PacketId )
+            {
+                U64 packet_id = GetPacketContainingFrameSequential( i );
+                if( packet_id == INVALID_RESULT_INDEX )
+                    packet_id = kSpiFrameFileNoPacket;
+                memcpy( output.Reserve( sizeof( U64 ) ), &packet_id, sizeof( U64 ) );
+                output.Commit( sizeof( U64 ) );
+                continue;
+            }
+
+            Frame frame = GetFrame( i );
+            if( column == Flags )
+            {
+                *output.Reserve( 1 ) = char( FrameFileFlags( frame ) );
+                output.Commit( 1 );
+                continue;
+            }
+
+            U64 value;
+            if( column == StartSample )
+                value = frame.mStartingSampleInclusive;
+            else if( column == EndSample )
+                value = frame.mEndingSampleInclusive;
+            else if( column == Mosi )
+                value = frame.mData1;
+            else
+                value = frame.mData2;
+            memcpy( output.Reserve( sizeof( U64 ) ), &value, sizeof( U64 ) );
+            output.Commit( sizeof( U64 ) );
         }
     }
 
-    UpdateExportProgressAndCheckForCancel( num_frames, num_frames );
-    AnalyzerHelpers::EndFile( f );
+    UpdateExportProgressAndCheckForCancel( ColumnCount * num_frames, ColumnCount * num_frames );
+    output.End();
+
+    if( mSettings->mPayloadIndexMode == SpiPayloadIndexBuilt )
+        GeneratePayloadIndexFile( ( std::string( file ) + ".idx" ).c_str(), header );
+}
+
+void SpiAnalyzerResults::GeneratePayloadIndexFile( const char* file, const SpiFrameFileHeader& frames_header )
+{
+    // the frames spi_search checks an index against, taken from the results rather than read back from the file
+    SpiPayloadIndexFingerprint fingerprint;
+    const U64 frame_count = frames_header.mFrameCount;
+    for( U64 i = 0; i < SpiPayloadIndexFingerprint::SampledFrameCount( frame_count ); i++ )
+    {
+        Frame frame = GetFrame( SpiPayloadIndexFingerprint::Frame( frame_count, i ) );
+        fingerprint.Add( frame.mStartingSampleInclusive, frame.mData1, frame.mData2, FrameFileFlags( frame ) );
+    }
+
+    SpiPayloadIndexHeader header;
+    std::vector<uint64_t> bucket_starts;
+    std::vector<uint64_t> postings;
+    {
+        std::lock_guard<std::mutex> lock( mPayloadIndexMutex );
+        mPayloadIndex.Build( frame_count, frames_header.mChannels, fingerprint.Get(), header, bucket_starts, postings );
+    }
+
+    SpiExportBuffer output;
+    output.Start( file, true );
+    output.Append( &header, sizeof( header ) );
+    output.Append( bucket_starts.data(), bucket_starts.size() * sizeof( uint64_t ) );
+    output.Append( postings.data(), postings.size() * sizeof( uint64_t ) );
+    output.End();
 }
 
 void SpiAnalyzerResults::GenerateFrameTabularText( U64 frame_index, DisplayBase display_base )
@@ -120,53 +355,198 @@ void SpiAnalyzerResults::GenerateFrameTabularText( U64 frame_index, DisplayBase
     if( mSettings->mMisoChannel == UNDEFINED_CHANNEL )
         miso_used = false;
 
-    char mosi_str[ 128 ];
-    char miso_str[ 128 ];
+    if( ( frame.mFlags & SPI_ERROR_FLAG ) != 0 )
+    {
+        AddTabularText( "The initial (idle) state of the CLK line does not match the settings." );
+        return;
+    }
 
-    std::stringstream ss;
+    char text[ 2 * SpiNumberFormatter::kMaxLength + 48 ];
+    char* p = text;
 
-    if( ( frame.mFlags & SPI_ERROR_FLAG ) == 0 )
+    if( mSettings->HasSlaveEnables() )
     {
-        if( mosi_used == true )
-            AnalyzerHelpers::GetNumberString( frame.mData1, display_base, mSettings->mBitsPerTransfer, mosi_str, 128 );
-        if( miso_used == true )
-            AnalyzerHelpers::GetNumberString( frame.mData2, display_base, mSettings->mBitsPerTransfer, miso_str, 128 );
+        memcpy( p, "Slave ", 6 );
+        p += 6;
+        p += SpiFormatDecimal( frame.mType, p );
+        memcpy( p, ";  ", 3 );
+        p += 3;
+    }
 
-        if( mosi_used == true && miso_used == true )
-        {
-            ss << "MOSI: " << mosi_str << ";  MISO: " << miso_str;
-        }
-        else
-        {
-            if( mosi_used == true )
-            {
-                ss << "MOSI: " << mosi_str;
-            }
-            else
-            {
-                ss << "MISO: " << miso_str;
-            }
-        }
+    if( ( frame.mFlags & SPI_REPEAT_FLAG ) != 0 )
+    {
+        std::stringstream ss;
+        ss << frame.mData1 << ( frame.mData1 == 1 ? " repeat (" : " repeats (" ) << frame.mData2
+           << ( frame.mData2 == 1 ? " word)" : " words each)" );
+        *p = '\0';
+        AddTabularText( text, ss.str().c_str() );
+        return;
     }
-    else
+
+    if( ( frame.mFlags & SPI_WIDE_WORD_FLAG ) != 0 )
     {
-        ss << "The initial (idle) state of the CLK line does not match the settings.";
+        memcpy( p, mSettings->mDataLanes == 4 ? "Quad: " : "Dual: ", 6 );
+        p += 6;
+        p += FormatNumber( frame.mData1, display_base, p );
+        *p = '\0';
+        AddTabularText( text );
+        return;
     }
 
-    AddTabularText( ss.str().c_str() );
+    if( mosi_used == true )
+    {
+        memcpy( p, "MOSI: ", 6 );
+        p += 6;
+        p += FormatNumber( frame.mData1, display_base, p );
+    }
+    if( mosi_used == true && miso_used == true )
+    {
+        memcpy( p, ";  ", 3 );
+        p += 3;
+    }
+    if( miso_used == true || mosi_used == false )
+    {
+        memcpy( p, "MISO: ", 6 );
+        p += 6;
+        p += FormatNumber( frame.mData2, display_base, p );
+    }
+    *p = '\0';
+
+    AddTabularText( text );
 }
 
-void SpiAnalyzerResults::GeneratePacketTabularText( U64 /*packet_id*/,
-                                                    DisplayBase /*display_base*/ ) // unrefereced vars commented out to remove warnings.
+void SpiAnalyzerResults::GeneratePacketTabularText( U64 packet_id, DisplayBase /*display_base*/ )
 {
-    ClearResultStrings();
-    AddResultString( "not supported" );
+    ClearTabularText();
+
+    U64 first_frame;
+    U64 last_frame;
+    if( GetPacketFrames( packet_id, first_frame, last_frame ) == false )
+        return;
+
+    bool mosi_used = mSettings->mMosiChannel != UNDEFINED_CHANNEL;
+    bool miso_used = mSettings->mMisoChannel != UNDEFINED_CHANNEL && mSettings->mDataLanes == 1;
+    const U32 bytes_per_transfer = ( mSettings->mBitsPerTransfer + 7 ) / 8;
+
+    // a hex dump of the start of the payload; packets can be megabytes long, so only the frames shown are read.
+    std::string mosi_dump;
+    std::string miso_dump;
+    U32 bytes_shown = 0;
+    U64 repeat_count = 0;
+    U64 frame_index = first_frame;
+    for( ; frame_index <= last_frame && bytes_shown < kPacketDumpBytes; frame_index++ )
+    {
+        Frame frame = GetFrame( frame_index );
+        if( ( frame.mFlags & SPI_REPEAT_FLAG ) != 0 )
+            repeat_count += frame.mData1;
+        if( ( frame.mFlags & ( SPI_ERROR_FLAG | SPI_REPEAT_FLAG ) ) != 0 )
+            continue;
+
+        for( U32 i = 0; i < bytes_per_transfer; i++ )
+        {
+            U32 bit_offset = ( bytes_per_transfer - i - 1 ) * 8;
+            char byte_str[ 4 ];
+            sprintf( byte_str, bytes_shown + i == 0 ? "%02X" : " %02X", U32( ( frame.mData1 >> bit_offset ) & 0xFF ) );
+            mosi_dump += byte_str;
+            sprintf( byte_str, bytes_shown + i == 0 ? "%02X" : " %02X", U32( ( frame.mData2 >> bit_offset ) & 0xFF ) );
+            miso_dump += byte_str;
+        }
+        bytes_shown += bytes_per_transfer;
+    }
+
+    // a packet without data is either a run of collapsed repeats, or the error frame of an enable window that started with the clock in
+    // the wrong state.
+    if( bytes_shown == 0 && repeat_count != 0 )
+    {
+        std::stringstream ss;
+        ss << repeat_count << ( repeat_count == 1 ? " repeat" : " repeats" ) << " of the transaction before";
+        AddTabularText( ss.str().c_str() );
+        return;
+    }
+    if( bytes_shown == 0 )
+    {
+        AddTabularText( "The initial (idle) state of the CLK line does not match the settings." );
+        return;
+    }
+
+    std::stringstream ss;
+    if( mSettings->mDataLanes > 1 )
+        ss << "Data: " << mosi_dump;
+    else if( mosi_used == true )
+        ss << "MOSI: " << mosi_dump;
+    if( mosi_used == true && miso_used == true )
+        ss << ";  ";
+    if( miso_used == true )
+        ss << "MISO: " << miso_dump;
+    if( frame_index <= last_frame )
+        ss << " ... (" << last_frame - first_frame + 1 << " frames)";
+
+    AddTabularText( ss.str().c_str() );
 }
 
 void
     SpiAnalyzerResults::GenerateTransactionTabularText( U64 /*transaction_id*/,
                                                         DisplayBase /*display_base*/ ) // unrefereced vars commented out to remove warnings.
 {
+    // the analyzer doesn't group packets into SDK transactions (AddPacketToTransaction), so there are never any rows to describe.
     ClearResultStrings();
     AddResultString( "not supported" );
 }
+
+void SpiAnalyzerResults::AddPacketFrames( U64 packet_id, U64 first_frame, U64 last_frame )
+{
+    std::lock_guard<std::mutex> lock( mPacketFramesMutex );
+    if( packet_id >= mPacketFrames.size() )
+        mPacketFrames.resize( packet_id + 1, std::make_pair( U64( 1 ), U64( 0 ) ) ); // first > last: no such packet
+    mPacketFrames[ packet_id ] = std::make_pair( first_frame, last_frame );
+}
+
+size_t SpiAnalyzerResults::FormatNumber( U64 value, DisplayBase display_base, char* out )
+{
+    if( U32( display_base ) >= sizeof( mNumberFormatters ) / sizeof( mNumberFormatters[ 0 ] ) )
+    {
+        AnalyzerHelpers::GetNumberString( value, display_base, mSettings->mBitsPerTransfer, out, SpiNumberFormatter::kMaxLength );
+        return strlen( out );
+    }
+
+    std::lock_guard<std::mutex> lock( mNumberFormattersMutex );
+    SpiNumberFormatter& formatter = mNumberFormatters[ display_base ];
+    if( formatter.IsSetUpFor( display_base, mSettings->mBitsPerTransfer ) == false )
+        formatter.Setup( display_base, mSettings->mBitsPerTransfer );
+    return formatter.Format( value, out );
+}
+
+bool SpiAnalyzerResults::GetPacketFrames( U64 packet_id, U64& first_frame, U64& last_frame )
+{
+    std::lock_guard<std::mutex> lock( mPacketFramesMutex );
+    if( packet_id >= mPacketFrames.size() || mPacketFrames[ packet_id ].first > mPacketFrames[ packet_id ].second )
+        return false;
+
+    first_frame = mPacketFrames[ packet_id ].first;
+    last_frame = mPacketFrames[ packet_id ].second;
+    return true;
+}
+
+void SpiAnalyzerResults::AddIndexedWord( U64 frame_index, const U8* mosi_bytes, const U8* miso_bytes )
+{
+    std::lock_guard<std::mutex> lock( mPayloadIndexMutex );
+    mPayloadIndex.AddWord( frame_index, mosi_bytes, miso_bytes );
+}
+
+void SpiAnalyzerResults::EndIndexedStreams()
+{
+    std::lock_guard<std::mutex> lock( mPayloadIndexMutex );
+    mPayloadIndex.EndStreams();
+}
+
+U64 SpiAnalyzerResults::GetBubbleCacheHits()
+{
+    std::lock_guard<std::mutex> lock( mBubbleCacheMutex );
+    return mBubbleCache.Hits();
+}
+
+U64 SpiAnalyzerResults::GetBubbleCacheMisses()
+{
+    std::lock_guard<std::mutex> lock( mBubbleCacheMutex );
+    return mBubbleCache.Misses();
+}
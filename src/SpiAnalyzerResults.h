@@ -2,8 +2,18 @@
 #define SPI_ANALYZER_RESULTS
 
 #include <AnalyzerResults.h>
+#include "SpiExportFormat.h"
+#include "SpiLruCache.h"
+#include "SpiPayloadIndexBuilder.h"
+#include <mutex>
+#include <utility>
+#include <vector>
 
 #define SPI_ERROR_FLAG ( 1 << 0 )
+// read across the dual or quad I/O lanes; mData1 holds the word
+#define SPI_WIDE_WORD_FLAG ( 1 << 1 )
+// copies of the enable window before, collapsed: mData1 holds how many, mData2 the words in each
+#define SPI_REPEAT_FLAG ( 1 << 2 )
 
 class SpiAnalyzer;
 class SpiAnalyzerSettings;
@@ -21,10 +31,54 @@ class SpiAnalyzerResults : public AnalyzerResults
     virtual void GeneratePacketTabularText( U64 packet_id, DisplayBase display_base );
     virtual void GenerateTransactionTabularText( U64 transaction_id, DisplayBase display_base );
 
+    // the frames of each packet, recorded by the analyzer as it commits packets. Safe to use while the analyzer is running.
+    void AddPacketFrames( U64 packet_id, U64 first_frame, U64 last_frame );
+    bool GetPacketFrames( U64 packet_id, U64& first_frame, U64& last_frame );
+
+    // with a payload search index: the words of each data frame as the analyzer adds it, and where the byte streams end. Safe to use
+    // while the analyzer is running.
+    void AddIndexedWord( U64 frame_index, const U8* mosi_bytes, const U8* miso_bytes );
+    void EndIndexedStreams();
+
+    // how often GenerateBubbleText() found its text in the bubble cache, and how often it had to format it.
+    U64 GetBubbleCacheHits();
+    U64 GetBubbleCacheMisses();
+
   protected: // functions
+    // the text of a word in a display base, for bubbles and tabular text.
+    size_t FormatNumber( U64 value, DisplayBase display_base, char* out );
+
+    void GenerateCsvExportFile( const char* file, DisplayBase display_base );
+    void GenerateFrameFileExportFile( const char* file );
+    // the payload search index of the frame file just written, with frames_header
+    void GeneratePayloadIndexFile( const char* file, const SpiFrameFileHeader& frames_header );
   protected: // vars
     SpiAnalyzerSettings* mSettings;
     SpiAnalyzer* mAnalyzer;
+
+    std::mutex mPacketFramesMutex;
+    std::vector<std::pair<U64, U64> > mPacketFrames;
+
+    std::mutex mPayloadIndexMutex;
+    SpiPayloadIndexBuilder mPayloadIndex;
+
+    // one per display base, set up when first used with the current word size.
+    std::mutex mNumberFormattersMutex;
+    SpiNumberFormatter mNumberFormatters[ AsciiHex + 1 ];
+
+    // bubble text by frame, channel and display base, for the settings it was made with. The results are rebuilt for every run, so
+    // the frames behind an entry never change.
+    struct BubbleText
+    {
+        bool mIsError;
+        // 0 for a word
+        U64 mRepeatCount;
+        char mText[ SpiNumberFormatter::kMaxLength ];
+    };
+    std::mutex mBubbleCacheMutex;
+    SpiLruCache<U64, BubbleText> mBubbleCache;
+    Channel mBubbleCacheMosiChannel;
+    U32 mBubbleCacheBitsPerTransfer;
 };
 
 #endif // SPI_ANALYZER_RESULTS
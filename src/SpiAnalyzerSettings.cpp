@@ -1,27 +1,56 @@
 #include "SpiAnalyzerSettings.h"
 
+#include "SpiDecoder.h"
+#include "SpiPayloadFilter.h"
+
 #include <AnalyzerHelpers.h>
 #include <sstream>
 #include <cstring>
 
+namespace
+{
+    std::string SlaveEnableChannelLabel( U32 index )
+    {
+        std::stringstream label;
+        label << "ENABLE " << index + 1;
+        return label.str();
+    }
+}
+
 SpiAnalyzerSettings::SpiAnalyzerSettings()
     : mMosiChannel( UNDEFINED_CHANNEL ),
       mMisoChannel( UNDEFINED_CHANNEL ),
       mClockChannel( UNDEFINED_CHANNEL ),
       mEnableChannel( UNDEFINED_CHANNEL ),
+      mIo2Channel( UNDEFINED_CHANNEL ),
+      mIo3Channel( UNDEFINED_CHANNEL ),
       mShiftOrder( AnalyzerEnums::MsbFirst ),
       mBitsPerTransfer( 8 ),
       mClockInactiveState( BIT_LOW ),
       mDataValidEdge( AnalyzerEnums::LeadingEdge ),
-      mEnableActiveState( BIT_LOW )
+      mEnableActiveState( BIT_LOW ),
+      mCommitBatchWords( 1024 ),
+      mCommitIntervalMs( 50 ),
+      mBitMarkers( SpiBitMarkersAll ),
+      mFrameV2Mode( SpiFrameV2Words ),
+      mDataLanes( 1 ),
+      mSingleBitWords( 0 ),
+      mLiveLatencyTargetMs( 0 ),
+      mRepeatMode( SpiRepeatsShown ),
+      mPayloadIndexMode( SpiPayloadIndexNone ),
+      mSimulationProfile( SpiSimulationDemo ),
+      mSimulationBurstKB( 4 ),
+      mSimulationClockDivider( 5 ),
+      mSimulationSeed( 1 ),
+      mSimulationPolarityErrorInterval( 0 )
 {
     mMosiChannelInterface.reset( new AnalyzerSettingInterfaceChannel() );
-    mMosiChannelInterface->SetTitleAndTooltip( "MOSI", "Master Out, Slave In" );
+    mMosiChannelInterface->SetTitleAndTooltip( "MOSI", "Master Out, Slave In. IO0 in dual and quad I/O" );
     mMosiChannelInterface->SetChannel( mMosiChannel );
     mMosiChannelInterface->SetSelectionOfNoneIsAllowed( true );
 
     mMisoChannelInterface.reset( new AnalyzerSettingInterfaceChannel() );
-    mMisoChannelInterface->SetTitleAndTooltip( "MISO", "Master In, Slave Out" );
+    mMisoChannelInterface->SetTitleAndTooltip( "MISO", "Master In, Slave Out. IO1 in dual and quad I/O" );
     mMisoChannelInterface->SetChannel( mMisoChannel );
     mMisoChannelInterface->SetSelectionOfNoneIsAllowed( true );
 
@@ -34,6 +63,16 @@ SpiAnalyzerSettings::SpiAnalyzerSettings()
     mEnableChannelInterface->SetChannel( mEnableChannel );
     mEnableChannelInterface->SetSelectionOfNoneIsAllowed( true );
 
+    mIo2ChannelInterface.reset( new AnalyzerSettingInterfaceChannel() );
+    mIo2ChannelInterface->SetTitleAndTooltip( "IO2", "Quad I/O only" );
+    mIo2ChannelInterface->SetChannel( mIo2Channel );
+    mIo2ChannelInterface->SetSelectionOfNoneIsAllowed( true );
+
+    mIo3ChannelInterface.reset( new AnalyzerSettingInterfaceChannel() );
+    mIo3ChannelInterface->SetTitleAndTooltip( "IO3", "Quad I/O only" );
+    mIo3ChannelInterface->SetChannel( mIo3Channel );
+    mIo3ChannelInterface->SetSelectionOfNoneIsAllowed( true );
+
     mShiftOrderInterface.reset( new AnalyzerSettingInterfaceNumberList() );
     mShiftOrderInterface->SetTitleAndTooltip( "Significant Bit", "" );
     mShiftOrderInterface->AddNumber( AnalyzerEnums::MsbFirst, "Most Significant Bit First (Standard)",
@@ -76,28 +115,177 @@ SpiAnalyzerSettings::SpiAnalyzerSettings()
     mEnableActiveStateInterface->AddNumber( BIT_HIGH, "Enable line is Active High", "" );
     mEnableActiveStateInterface->SetNumber( mEnableActiveState );
 
+    mCommitBatchWordsInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mCommitBatchWordsInterface->SetTitleAndTooltip( "Results Batch Size",
+                                                    "Number of decoded words to collect before publishing them to the display" );
+    mCommitBatchWordsInterface->SetMax( 1000000 );
+    mCommitBatchWordsInterface->SetMin( 1 );
+    mCommitBatchWordsInterface->SetInteger( mCommitBatchWords );
+
+    mCommitIntervalMsInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mCommitIntervalMsInterface->SetTitleAndTooltip( "Results Interval (ms)",
+                                                    "Longest time a decoded word waits before it is published to the display" );
+    mCommitIntervalMsInterface->SetMax( 10000 );
+    mCommitIntervalMsInterface->SetMin( 0 );
+    mCommitIntervalMsInterface->SetInteger( mCommitIntervalMs );
+
+    mBitMarkersInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mBitMarkersInterface->SetTitleAndTooltip( "Bit Markers", "Clock edges to mark with an arrow where each bit was sampled" );
+    mBitMarkersInterface->AddNumber( SpiBitMarkersAll, "Mark Every Bit (Standard)", "" );
+    mBitMarkersInterface->AddNumber( SpiBitMarkersFirstAndLast, "Mark the First and Last Bit of Each Word",
+                                     "Uses less memory on long captures" );
+    mBitMarkersInterface->AddNumber( SpiBitMarkersOff, "No Bit Markers", "Uses the least memory on long captures" );
+    mBitMarkersInterface->SetNumber( mBitMarkers );
+
+    mFrameV2ModeInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mFrameV2ModeInterface->SetTitleAndTooltip( "Data Table Frames", "" );
+    mFrameV2ModeInterface->AddNumber( SpiFrameV2Words, "One Frame per Word (Standard)", "" );
+    mFrameV2ModeInterface->AddNumber( SpiFrameV2Transactions, "One Frame per Transaction",
+                                      "All the words of an enable window in a single frame. Requires the Enable channel." );
+    mFrameV2ModeInterface->SetNumber( mFrameV2Mode );
+
+    mDataLanesInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mDataLanesInterface->SetTitleAndTooltip( "Data Lines", "" );
+    mDataLanesInterface->AddNumber( 1, "MOSI and MISO, One Bit per Clock (Standard)", "" );
+    mDataLanesInterface->AddNumber( 2, "Dual I/O, Two Bits per Clock", "Words are read across MOSI (IO0) and MISO (IO1)" );
+    mDataLanesInterface->AddNumber( 4, "Quad I/O, Four Bits per Clock", "Words are read across MOSI (IO0), MISO (IO1), IO2 and IO3" );
+    mDataLanesInterface->SetNumber( mDataLanes );
+
+    mSingleBitWordsInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSingleBitWordsInterface->SetTitleAndTooltip( "Single-bit Words",
+                                                  "Dual and quad I/O: words at the start of each transaction sent one bit per clock on "
+                                                  "MOSI, such as the command of a 1-4-4 flash read" );
+    mSingleBitWordsInterface->SetMax( 64 );
+    mSingleBitWordsInterface->SetMin( 0 );
+    mSingleBitWordsInterface->SetInteger( mSingleBitWords );
+
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+    {
+        std::stringstream title;
+        title << "Enable, Slave " << i + 1;
+
+        mSlaveEnableChannels[ i ] = UNDEFINED_CHANNEL;
+        mSlaveEnableChannelInterfaces[ i ].reset( new AnalyzerSettingInterfaceChannel() );
+        mSlaveEnableChannelInterfaces[ i ]->SetTitleAndTooltip(
+            title.str().c_str(), "Another slave on the same bus, decoded along with the one on the Enable channel" );
+        mSlaveEnableChannelInterfaces[ i ]->SetChannel( mSlaveEnableChannels[ i ] );
+        mSlaveEnableChannelInterfaces[ i ]->SetSelectionOfNoneIsAllowed( true );
+    }
+
+    mLiveLatencyTargetMsInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mLiveLatencyTargetMsInterface->SetTitleAndTooltip( "Live Latency Target (ms)",
+                                                       "0 for off. Publishes decoded words in time to show them at most this long "
+                                                       "behind a live capture, overriding a longer Results Interval" );
+    mLiveLatencyTargetMsInterface->SetMax( 10000 );
+    mLiveLatencyTargetMsInterface->SetMin( 0 );
+    mLiveLatencyTargetMsInterface->SetInteger( mLiveLatencyTargetMs );
+
+    mRepeatModeInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mRepeatModeInterface->SetTitleAndTooltip( "Repeated Transactions", "" );
+    mRepeatModeInterface->AddNumber( SpiRepeatsShown, "Show Every Transaction (Standard)", "" );
+    mRepeatModeInterface->AddNumber( SpiRepeatsCollapsed, "Collapse Identical Repeats",
+                                     "Transactions with the same data as the one before are counted in a single frame, such as a "
+                                     "status register being polled. Requires the Enable channel." );
+    mRepeatModeInterface->SetNumber( mRepeatMode );
+
+    mPayloadFilterInterface.reset( new AnalyzerSettingInterfaceText() );
+    mPayloadFilterInterface->SetTitleAndTooltip( "Payload Filter",
+                                                 "Empty to keep every transaction. Otherwise only transactions whose first bytes match one "
+                                                 "of these comma separated patterns are kept, such as \"mosi: 20, mosi: D8, miso: 9F 1X\": "
+                                                 "hex bytes, X for any nibble, or HH/MM for a byte under a mask. Requires the Enable "
+                                                 "channel." );
+    mPayloadFilterInterface->SetText( mPayloadFilter.c_str() );
+
+    mPayloadIndexModeInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mPayloadIndexModeInterface->SetTitleAndTooltip( "Payload Search Index", "" );
+    mPayloadIndexModeInterface->AddNumber( SpiPayloadIndexNone, "None (Standard)", "" );
+    mPayloadIndexModeInterface->AddNumber( SpiPayloadIndexBuilt, "Index for Binary Frame Export",
+                                           "Every 4 byte sequence on MOSI and MISO is indexed as frames are added, and the binary frame "
+                                           "export writes the index next to the .spif file, for spi_search to find byte sequences in." );
+    mPayloadIndexModeInterface->SetNumber( mPayloadIndexMode );
+
+    mSimulationProfileInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mSimulationProfileInterface->SetTitleAndTooltip( "Simulation Profile", "The traffic in simulated captures" );
+    mSimulationProfileInterface->AddNumber( SpiSimulationDemo, "Demo (Standard)", "Four incrementing words per transaction" );
+    mSimulationProfileInterface->AddNumber( SpiSimulationFlashRead, "Flash Read Bursts",
+                                            "A read command and address, then Simulation Burst Size of data from the slave" );
+    mSimulationProfileInterface->AddNumber( SpiSimulationRegisterPoll, "Register Poll Storm",
+                                            "Two-word register reads back to back, one clock apart" );
+    mSimulationProfileInterface->AddNumber( SpiSimulationRandom, "Random Payloads",
+                                            "Random transaction lengths, data and gaps, repeatable with Simulation Seed" );
+    mSimulationProfileInterface->SetNumber( mSimulationProfile );
+
+    mSimulationBurstKBInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSimulationBurstKBInterface->SetTitleAndTooltip( "Simulation Burst Size (KB)", "Data read per transaction by Flash Read Bursts" );
+    mSimulationBurstKBInterface->SetMax( 1024 );
+    mSimulationBurstKBInterface->SetMin( 1 );
+    mSimulationBurstKBInterface->SetInteger( mSimulationBurstKB );
+
+    mSimulationClockDividerInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSimulationClockDividerInterface->SetTitleAndTooltip( "Simulation Clock Divider", "Samples per clock period in simulated captures" );
+    mSimulationClockDividerInterface->SetMax( 1000000 );
+    mSimulationClockDividerInterface->SetMin( 2 );
+    mSimulationClockDividerInterface->SetInteger( mSimulationClockDivider );
+
+    mSimulationSeedInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSimulationSeedInterface->SetTitleAndTooltip( "Simulation Seed", "Seeds the random data of simulated captures" );
+    mSimulationSeedInterface->SetMax( 2147483647 );
+    mSimulationSeedInterface->SetMin( 0 );
+    mSimulationSeedInterface->SetInteger( mSimulationSeed );
+
+    mSimulationPolarityErrorIntervalInterface.reset( new AnalyzerSettingInterfaceInteger() );
+    mSimulationPolarityErrorIntervalInterface->SetTitleAndTooltip(
+        "Simulation Polarity Errors", "0 for none. Every Nth simulated transaction starts with the clock idling at the wrong level" );
+    mSimulationPolarityErrorIntervalInterface->SetMax( 1000000 );
+    mSimulationPolarityErrorIntervalInterface->SetMin( 0 );
+    mSimulationPolarityErrorIntervalInterface->SetInteger( mSimulationPolarityErrorInterval );
 
     AddInterface( mMosiChannelInterface.get() );
     AddInterface( mMisoChannelInterface.get() );
     AddInterface( mClockChannelInterface.get() );
     AddInterface( mEnableChannelInterface.get() );
+    AddInterface( mIo2ChannelInterface.get() );
+    AddInterface( mIo3ChannelInterface.get() );
     AddInterface( mShiftOrderInterface.get() );
     AddInterface( mBitsPerTransferInterface.get() );
     AddInterface( mClockInactiveStateInterface.get() );
     AddInterface( mDataValidEdgeInterface.get() );
     AddInterface( mEnableActiveStateInterface.get() );
+    AddInterface( mCommitBatchWordsInterface.get() );
+    AddInterface( mCommitIntervalMsInterface.get() );
+    AddInterface( mBitMarkersInterface.get() );
+    AddInterface( mFrameV2ModeInterface.get() );
+    AddInterface( mDataLanesInterface.get() );
+    AddInterface( mSingleBitWordsInterface.get() );
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+        AddInterface( mSlaveEnableChannelInterfaces[ i ].get() );
+    AddInterface( mLiveLatencyTargetMsInterface.get() );
+    AddInterface( mRepeatModeInterface.get() );
+    AddInterface( mPayloadFilterInterface.get() );
+    AddInterface( mPayloadIndexModeInterface.get() );
+    AddInterface( mSimulationProfileInterface.get() );
+    AddInterface( mSimulationBurstKBInterface.get() );
+    AddInterface( mSimulationClockDividerInterface.get() );
+    AddInterface( mSimulationSeedInterface.get() );
+    AddInterface( mSimulationPolarityErrorIntervalInterface.get() );
 
 
     // AddExportOption( 0, "Export as text/csv file", "text (*.txt);;csv (*.csv)" );
-    AddExportOption( 0, "Export as text/csv file" );
-    AddExportExtension( 0, "text", "txt" );
-    AddExportExtension( 0, "csv", "csv" );
+    AddExportOption( SpiCsvExport, "Export as text/csv file" );
+    AddExportExtension( SpiCsvExport, "text", "txt" );
+    AddExportExtension( SpiCsvExport, "csv", "csv" );
+    AddExportOption( SpiFrameFileExport, "Export as binary frame file" );
+    AddExportExtension( SpiFrameFileExport, "binary frame file", "spif" );
 
     ClearChannels();
     AddChannel( mMosiChannel, "MOSI", false );
     AddChannel( mMisoChannel, "MISO", false );
     AddChannel( mClockChannel, "CLOCK", false );
     AddChannel( mEnableChannel, "ENABLE", false );
+    AddChannel( mIo2Channel, "IO2", false );
+    AddChannel( mIo3Channel, "IO3", false );
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+        AddChannel( mSlaveEnableChannels[ i ], SlaveEnableChannelLabel( i ).c_str(), false );
 }
 
 SpiAnalyzerSettings::~SpiAnalyzerSettings()
@@ -110,12 +298,32 @@ bool SpiAnalyzerSettings::SetSettingsFromInterfaces()
     Channel miso = mMisoChannelInterface->GetChannel();
     Channel clock = mClockChannelInterface->GetChannel();
     Channel enable = mEnableChannelInterface->GetChannel();
+    Channel io2 = mIo2ChannelInterface->GetChannel();
+    Channel io3 = mIo3ChannelInterface->GetChannel();
+    U32 data_lanes = U32( mDataLanesInterface->GetNumber() );
+    Channel slave_enables[ kSpiMaxChipSelects - 1 ];
+    bool slave_enable_used = false;
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+    {
+        slave_enables[ i ] = mSlaveEnableChannelInterfaces[ i ]->GetChannel();
+        slave_enable_used |= slave_enables[ i ] != UNDEFINED_CHANNEL;
+    }
 
     std::vector<Channel> channels;
     channels.push_back( mosi );
     channels.push_back( miso );
     channels.push_back( clock );
     channels.push_back( enable );
+    if( data_lanes == 4 )
+    {
+        channels.push_back( io2 );
+        channels.push_back( io3 );
+    }
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+    {
+        if( slave_enables[ i ] != UNDEFINED_CHANNEL )
+            channels.push_back( slave_enables[ i ] );
+    }
 
     if( AnalyzerHelpers::DoChannelsOverlap( &channels[ 0 ], channels.size() ) == true )
     {
@@ -129,22 +337,87 @@ bool SpiAnalyzerSettings::SetSettingsFromInterfaces()
         return false;
     }
 
+    if( data_lanes > 1 && ( mosi == UNDEFINED_CHANNEL || miso == UNDEFINED_CHANNEL ) )
+    {
+        SetErrorText( "Dual and quad I/O read IO0 and IO1 from the MOSI and MISO channels. Please select both." );
+        return false;
+    }
+
+    if( data_lanes == 4 && ( io2 == UNDEFINED_CHANNEL || io3 == UNDEFINED_CHANNEL ) )
+    {
+        SetErrorText( "Quad I/O needs the IO2 and IO3 channels." );
+        return false;
+    }
+
+    if( U32( mBitsPerTransferInterface->GetNumber() ) % data_lanes != 0 )
+    {
+        SetErrorText( "With dual or quad I/O, bits per transfer must be a multiple of the bits sent per clock." );
+        return false;
+    }
+
+    if( enable == UNDEFINED_CHANNEL && slave_enable_used )
+    {
+        SetErrorText( "With several slaves, the Enable channel is the first slave's enable line. Please select it." );
+        return false;
+    }
+
+    if( enable == UNDEFINED_CHANNEL && U32( mFrameV2ModeInterface->GetNumber() ) == SpiFrameV2Transactions )
+    {
+        SetErrorText( "One frame per transaction needs the Enable channel to tell where transactions start and end." );
+        return false;
+    }
+
+    if( enable == UNDEFINED_CHANNEL && U32( mRepeatModeInterface->GetNumber() ) == SpiRepeatsCollapsed )
+    {
+        SetErrorText( "Collapsing repeated transactions needs the Enable channel to tell where transactions start and end." );
+        return false;
+    }
+
+    std::vector<SpiPayloadFilter::Pattern> filter_patterns;
+    if( SpiPayloadFilter::ParsePatterns( mPayloadFilterInterface->GetText(), filter_patterns ) == false )
+    {
+        SetErrorText( "The payload filter should be comma separated patterns of hex bytes, each optionally after \"mosi:\" or "
+                      "\"miso:\", such as \"mosi: 20, miso: 9F 1X\"." );
+        return false;
+    }
+
+    if( enable == UNDEFINED_CHANNEL && filter_patterns.empty() == false )
+    {
+        SetErrorText( "The payload filter needs the Enable channel to tell where transactions start and end." );
+        return false;
+    }
+
     mMosiChannel = mMosiChannelInterface->GetChannel();
     mMisoChannel = mMisoChannelInterface->GetChannel();
     mClockChannel = mClockChannelInterface->GetChannel();
     mEnableChannel = mEnableChannelInterface->GetChannel();
+    mIo2Channel = io2;
+    mIo3Channel = io3;
 
     mShiftOrder = ( AnalyzerEnums::ShiftOrder )U32( mShiftOrderInterface->GetNumber() );
     mBitsPerTransfer = U32( mBitsPerTransferInterface->GetNumber() );
     mClockInactiveState = ( BitState )U32( mClockInactiveStateInterface->GetNumber() );
     mDataValidEdge = ( AnalyzerEnums::Edge )U32( mDataValidEdgeInterface->GetNumber() );
     mEnableActiveState = ( BitState )U32( mEnableActiveStateInterface->GetNumber() );
-
-    ClearChannels();
-    AddChannel( mMosiChannel, "MOSI", mMosiChannel != UNDEFINED_CHANNEL );
-    AddChannel( mMisoChannel, "MISO", mMisoChannel != UNDEFINED_CHANNEL );
-    AddChannel( mClockChannel, "CLOCK", mClockChannel != UNDEFINED_CHANNEL );
-    AddChannel( mEnableChannel, "ENABLE", mEnableChannel != UNDEFINED_CHANNEL );
+    mCommitBatchWords = U32( mCommitBatchWordsInterface->GetInteger() );
+    mCommitIntervalMs = U32( mCommitIntervalMsInterface->GetInteger() );
+    mBitMarkers = U32( mBitMarkersInterface->GetNumber() );
+    mFrameV2Mode = U32( mFrameV2ModeInterface->GetNumber() );
+    mDataLanes = data_lanes;
+    mSingleBitWords = U32( mSingleBitWordsInterface->GetInteger() );
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+        mSlaveEnableChannels[ i ] = slave_enables[ i ];
+    mLiveLatencyTargetMs = U32( mLiveLatencyTargetMsInterface->GetInteger() );
+    mRepeatMode = U32( mRepeatModeInterface->GetNumber() );
+    mPayloadFilter = mPayloadFilterInterface->GetText();
+    mPayloadIndexMode = U32( mPayloadIndexModeInterface->GetNumber() );
+    mSimulationProfile = U32( mSimulationProfileInterface->GetNumber() );
+    mSimulationBurstKB = U32( mSimulationBurstKBInterface->GetInteger() );
+    mSimulationClockDivider = U32( mSimulationClockDividerInterface->GetInteger() );
+    mSimulationSeed = U32( mSimulationSeedInterface->GetInteger() );
+    mSimulationPolarityErrorInterval = U32( mSimulationPolarityErrorIntervalInterface->GetInteger() );
+
+    AddChannels();
 
     return true;
 }
@@ -169,15 +442,51 @@ void SpiAnalyzerSettings::LoadSettings( const char* settings )
     text_archive >> *( U32* )&mDataValidEdge;
     text_archive >> *( U32* )&mEnableActiveState;
 
-    // bool success = text_archive >> mUsePackets;  //new paramater added -- do this for backwards compatibility
-    // if( success == false )
-    //	mUsePackets = false; //if the archive fails, set the default value
-
-    ClearChannels();
-    AddChannel( mMosiChannel, "MOSI", mMosiChannel != UNDEFINED_CHANNEL );
-    AddChannel( mMisoChannel, "MISO", mMisoChannel != UNDEFINED_CHANNEL );
-    AddChannel( mClockChannel, "CLOCK", mClockChannel != UNDEFINED_CHANNEL );
-    AddChannel( mEnableChannel, "ENABLE", mEnableChannel != UNDEFINED_CHANNEL );
+    // added later; older settings strings end before these.
+    if( text_archive >> mCommitBatchWords == false )
+        mCommitBatchWords = 1024;
+    if( text_archive >> mCommitIntervalMs == false )
+        mCommitIntervalMs = 50;
+    if( text_archive >> mBitMarkers == false )
+        mBitMarkers = SpiBitMarkersAll;
+    if( text_archive >> mFrameV2Mode == false )
+        mFrameV2Mode = SpiFrameV2Words;
+    if( text_archive >> mDataLanes == false )
+        mDataLanes = 1;
+    if( text_archive >> mSingleBitWords == false )
+        mSingleBitWords = 0;
+    if( text_archive >> mIo2Channel == false )
+        mIo2Channel = UNDEFINED_CHANNEL;
+    if( text_archive >> mIo3Channel == false )
+        mIo3Channel = UNDEFINED_CHANNEL;
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+    {
+        if( text_archive >> mSlaveEnableChannels[ i ] == false )
+            mSlaveEnableChannels[ i ] = UNDEFINED_CHANNEL;
+    }
+    if( text_archive >> mLiveLatencyTargetMs == false )
+        mLiveLatencyTargetMs = 0;
+    if( text_archive >> mSimulationProfile == false )
+        mSimulationProfile = SpiSimulationDemo;
+    if( text_archive >> mSimulationBurstKB == false )
+        mSimulationBurstKB = 4;
+    if( text_archive >> mSimulationClockDivider == false )
+        mSimulationClockDivider = 5;
+    if( text_archive >> mSimulationSeed == false )
+        mSimulationSeed = 1;
+    if( text_archive >> mSimulationPolarityErrorInterval == false )
+        mSimulationPolarityErrorInterval = 0;
+    if( text_archive >> mRepeatMode == false )
+        mRepeatMode = SpiRepeatsShown;
+    const char* payload_filter;
+    if( text_archive >> &payload_filter == true )
+        mPayloadFilter = payload_filter;
+    else
+        mPayloadFilter.clear();
+    if( text_archive >> mPayloadIndexMode == false )
+        mPayloadIndexMode = SpiPayloadIndexNone;
+
+    AddChannels();
 
     UpdateInterfacesFromSettings();
 }
@@ -196,6 +505,25 @@ const char* SpiAnalyzerSettings::SaveSettings()
     text_archive << mClockInactiveState;
     text_archive << mDataValidEdge;
     text_archive << mEnableActiveState;
+    text_archive << mCommitBatchWords;
+    text_archive << mCommitIntervalMs;
+    text_archive << mBitMarkers;
+    text_archive << mFrameV2Mode;
+    text_archive << mDataLanes;
+    text_archive << mSingleBitWords;
+    text_archive << mIo2Channel;
+    text_archive << mIo3Channel;
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+        text_archive << mSlaveEnableChannels[ i ];
+    text_archive << mLiveLatencyTargetMs;
+    text_archive << mSimulationProfile;
+    text_archive << mSimulationBurstKB;
+    text_archive << mSimulationClockDivider;
+    text_archive << mSimulationSeed;
+    text_archive << mSimulationPolarityErrorInterval;
+    text_archive << mRepeatMode;
+    text_archive << mPayloadFilter.c_str();
+    text_archive << mPayloadIndexMode;
 
     return SetReturnString( text_archive.GetString() );
 }
@@ -211,4 +539,62 @@ void SpiAnalyzerSettings::UpdateInterfacesFromSettings()
     mClockInactiveStateInterface->SetNumber( mClockInactiveState );
     mDataValidEdgeInterface->SetNumber( mDataValidEdge );
     mEnableActiveStateInterface->SetNumber( mEnableActiveState );
+    mCommitBatchWordsInterface->SetInteger( mCommitBatchWords );
+    mCommitIntervalMsInterface->SetInteger( mCommitIntervalMs );
+    mBitMarkersInterface->SetNumber( mBitMarkers );
+    mFrameV2ModeInterface->SetNumber( mFrameV2Mode );
+    mIo2ChannelInterface->SetChannel( mIo2Channel );
+    mIo3ChannelInterface->SetChannel( mIo3Channel );
+    mDataLanesInterface->SetNumber( mDataLanes );
+    mSingleBitWordsInterface->SetInteger( mSingleBitWords );
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+        mSlaveEnableChannelInterfaces[ i ]->SetChannel( mSlaveEnableChannels[ i ] );
+    mLiveLatencyTargetMsInterface->SetInteger( mLiveLatencyTargetMs );
+    mRepeatModeInterface->SetNumber( mRepeatMode );
+    mPayloadFilterInterface->SetText( mPayloadFilter.c_str() );
+    mPayloadIndexModeInterface->SetNumber( mPayloadIndexMode );
+    mSimulationProfileInterface->SetNumber( mSimulationProfile );
+    mSimulationBurstKBInterface->SetInteger( mSimulationBurstKB );
+    mSimulationClockDividerInterface->SetInteger( mSimulationClockDivider );
+    mSimulationSeedInterface->SetInteger( mSimulationSeed );
+    mSimulationPolarityErrorIntervalInterface->SetInteger( mSimulationPolarityErrorInterval );
+}
+
+bool SpiAnalyzerSettings::HasSlaveEnables() const
+{
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+    {
+        if( mSlaveEnableChannels[ i ] != UNDEFINED_CHANNEL )
+            return true;
+    }
+    return false;
+}
+
+std::vector<Channel> SpiAnalyzerSettings::GetChipSelectChannels() const
+{
+    std::vector<Channel> chip_selects;
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+    {
+        if( mSlaveEnableChannels[ i ] == UNDEFINED_CHANNEL )
+            continue;
+        // slaves keep their numbers when one in the middle isn't used
+        chip_selects.resize( i + 2, UNDEFINED_CHANNEL );
+        chip_selects[ i + 1 ] = mSlaveEnableChannels[ i ];
+    }
+    if( chip_selects.empty() == false )
+        chip_selects[ 0 ] = mEnableChannel;
+    return chip_selects;
+}
+
+void SpiAnalyzerSettings::AddChannels()
+{
+    ClearChannels();
+    AddChannel( mMosiChannel, "MOSI", mMosiChannel != UNDEFINED_CHANNEL );
+    AddChannel( mMisoChannel, "MISO", mMisoChannel != UNDEFINED_CHANNEL );
+    AddChannel( mClockChannel, "CLOCK", mClockChannel != UNDEFINED_CHANNEL );
+    AddChannel( mEnableChannel, "ENABLE", mEnableChannel != UNDEFINED_CHANNEL );
+    AddChannel( mIo2Channel, "IO2", mDataLanes == 4 && mIo2Channel != UNDEFINED_CHANNEL );
+    AddChannel( mIo3Channel, "IO3", mDataLanes == 4 && mIo3Channel != UNDEFINED_CHANNEL );
+    for( U32 i = 0; i < kSpiMaxChipSelects - 1; i++ )
+        AddChannel( mSlaveEnableChannels[ i ], SlaveEnableChannelLabel( i ).c_str(), mSlaveEnableChannels[ i ] != UNDEFINED_CHANNEL );
 }
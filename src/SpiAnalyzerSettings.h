@@ -3,6 +3,48 @@
 
 #include <AnalyzerSettings.h>
 #include <AnalyzerTypes.h>
+#include <string>
+#include <vector>
+
+// export_type_user_id values
+enum SpiExportType
+{
+    SpiCsvExport = 0,
+    SpiFrameFileExport = 1
+};
+
+// what the analyzer reports as FrameV2
+enum SpiFrameV2Mode
+{
+    SpiFrameV2Words = 0,       // "enable", "result" per word and "disable"
+    SpiFrameV2Transactions = 1 // one "transaction" per enable window
+};
+
+// what the analyzer does with enable windows that repeat the one before
+enum SpiRepeatMode
+{
+    SpiRepeatsShown = 0,    // every window reported as usual
+    SpiRepeatsCollapsed = 1 // a run of copies reported as one "repeat" frame
+};
+
+// whether the binary frame export comes with a payload search index (SpiPayloadIndex.h)
+enum SpiPayloadIndexMode
+{
+    SpiPayloadIndexNone = 0,
+    SpiPayloadIndexBuilt = 1 // built as frames are added, and written next to the export
+};
+
+// the traffic the simulation generates
+enum SpiSimulationProfile
+{
+    SpiSimulationDemo = 0,         // four incrementing words per transaction
+    SpiSimulationFlashRead = 1,    // a read command and address, then a long burst from the slave
+    SpiSimulationRegisterPoll = 2, // short transactions back to back, one clock apart
+    SpiSimulationRandom = 3        // random payloads and gaps from a seeded generator
+};
+
+// slaves on one bus, each with its own enable line; slave 0's is the Enable channel
+const U32 kSpiMaxChipSelects = 8;
 
 class SpiAnalyzerSettings : public AnalyzerSettings
 {
@@ -20,23 +62,73 @@ class SpiAnalyzerSettings : public AnalyzerSettings
     Channel mMisoChannel;
     Channel mClockChannel;
     Channel mEnableChannel;
+    // quad I/O only; IO0 and IO1 are the MOSI and MISO channels
+    Channel mIo2Channel;
+    Channel mIo3Channel;
     AnalyzerEnums::ShiftOrder mShiftOrder;
     U32 mBitsPerTransfer;
     BitState mClockInactiveState;
     AnalyzerEnums::Edge mDataValidEdge;
     BitState mEnableActiveState;
+    U32 mCommitBatchWords;
+    U32 mCommitIntervalMs;
+    U32 mBitMarkers;
+    U32 mFrameV2Mode;
+    // 1 for standard SPI, 2 for dual I/O, 4 for quad I/O
+    U32 mDataLanes;
+    // dual and quad I/O: words sent a bit per clock at the start of each transaction
+    U32 mSingleBitWords;
+    // the enable lines of slaves 1 and up
+    Channel mSlaveEnableChannels[ kSpiMaxChipSelects - 1 ];
+    // 0 for off. Otherwise results are published soon enough to show up at most this long behind a live capture.
+    U32 mLiveLatencyTargetMs;
+    U32 mRepeatMode;
+    // SpiPayloadFilter patterns; empty to keep every transaction
+    std::string mPayloadFilter;
+    U32 mPayloadIndexMode;
+    // simulation only
+    U32 mSimulationProfile;
+    U32 mSimulationBurstKB;
+    // samples per clock period
+    U32 mSimulationClockDivider;
+    U32 mSimulationSeed;
+    // every Nth transaction starts with the clock idling at the wrong level; 0 for none
+    U32 mSimulationPolarityErrorInterval;
 
+    // the enable line of each slave in use, slave 0 first; empty with a single enable line, or none.
+    std::vector<Channel> GetChipSelectChannels() const;
+    bool HasSlaveEnables() const;
 
   protected:
+    void AddChannels();
+
     std::auto_ptr<AnalyzerSettingInterfaceChannel> mMosiChannelInterface;
     std::auto_ptr<AnalyzerSettingInterfaceChannel> mMisoChannelInterface;
     std::auto_ptr<AnalyzerSettingInterfaceChannel> mClockChannelInterface;
     std::auto_ptr<AnalyzerSettingInterfaceChannel> mEnableChannelInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceChannel> mIo2ChannelInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceChannel> mIo3ChannelInterface;
     std::auto_ptr<AnalyzerSettingInterfaceNumberList> mShiftOrderInterface;
     std::auto_ptr<AnalyzerSettingInterfaceNumberList> mBitsPerTransferInterface;
     std::auto_ptr<AnalyzerSettingInterfaceNumberList> mClockInactiveStateInterface;
     std::auto_ptr<AnalyzerSettingInterfaceNumberList> mDataValidEdgeInterface;
     std::auto_ptr<AnalyzerSettingInterfaceNumberList> mEnableActiveStateInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceInteger> mCommitBatchWordsInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceInteger> mCommitIntervalMsInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceNumberList> mBitMarkersInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceNumberList> mFrameV2ModeInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceNumberList> mDataLanesInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceInteger> mSingleBitWordsInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceChannel> mSlaveEnableChannelInterfaces[ kSpiMaxChipSelects - 1 ];
+    std::auto_ptr<AnalyzerSettingInterfaceInteger> mLiveLatencyTargetMsInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceNumberList> mRepeatModeInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceText> mPayloadFilterInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceNumberList> mPayloadIndexModeInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceNumberList> mSimulationProfileInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceInteger> mSimulationBurstKBInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceInteger> mSimulationClockDividerInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceInteger> mSimulationSeedInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceInteger> mSimulationPolarityErrorIntervalInterface;
 };
 
 #endif // SPI_ANALYZER_SETTINGS
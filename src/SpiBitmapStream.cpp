@@ -0,0 +1,254 @@
+#include "SpiBitmapStream.h"
+
+#include "SpiTransitionStream.h"
+
+#if defined( __x86_64__ ) || defined( _M_X64 )
+#define SPI_BITMAP_SCAN_X86 1
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+#endif
+
+#if defined( __GNUC__ ) && SPI_BITMAP_SCAN_X86
+#define SPI_BITMAP_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#else
+#define SPI_BITMAP_TARGET_AVX2
+#endif
+
+namespace
+{
+    // the index of the lowest set bit; word must not be zero.
+    inline uint32_t LowestSetBit( uint64_t word )
+    {
+#if defined( _MSC_VER )
+        unsigned long index;
+        _BitScanForward64( &index, word );
+        return uint32_t( index );
+#else
+        return uint32_t( __builtin_ctzll( word ) );
+#endif
+    }
+
+    inline uint64_t PopCount( uint64_t word )
+    {
+#if defined( _MSC_VER )
+        return __popcnt64( word );
+#else
+        return uint64_t( __builtin_popcountll( word ) );
+#endif
+    }
+
+    // the first word in [begin, end) that isn't fill, or end.
+    typedef uint64_t ( *ScanFunction )( const uint64_t* words, uint64_t begin, uint64_t end, uint64_t fill );
+
+    uint64_t ScanScalar( const uint64_t* words, uint64_t begin, uint64_t end, uint64_t fill )
+    {
+        while( begin < end && words[ begin ] == fill )
+            begin++;
+        return begin;
+    }
+
+#if SPI_BITMAP_SCAN_X86
+    // every x86-64 processor has SSE2.
+    uint64_t ScanSse2( const uint64_t* words, uint64_t begin, uint64_t end, uint64_t fill )
+    {
+        const __m128i fill_vector = _mm_set1_epi64x( int64_t( fill ) );
+        for( ; begin + 4 <= end; begin += 4 )
+        {
+            __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( words + begin ) );
+            __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( words + begin + 2 ) );
+            __m128i same = _mm_and_si128( _mm_cmpeq_epi32( a, fill_vector ), _mm_cmpeq_epi32( b, fill_vector ) );
+            if( _mm_movemask_epi8( same ) != 0xFFFF )
+                break;
+        }
+        return ScanScalar( words, begin, end, fill );
+    }
+
+    SPI_BITMAP_TARGET_AVX2 uint64_t ScanAvx2( const uint64_t* words, uint64_t begin, uint64_t end, uint64_t fill )
+    {
+        const __m256i fill_vector = _mm256_set1_epi64x( int64_t( fill ) );
+        for( ; begin + 8 <= end; begin += 8 )
+        {
+            __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( words + begin ) );
+            __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( words + begin + 4 ) );
+            __m256i differs = _mm256_or_si256( _mm256_xor_si256( a, fill_vector ), _mm256_xor_si256( b, fill_vector ) );
+            if( _mm256_testz_si256( differs, differs ) == 0 )
+                break;
+        }
+        return ScanScalar( words, begin, end, fill );
+    }
+
+    bool HasAvx2()
+    {
+#if defined( _MSC_VER )
+        int info[ 4 ];
+        __cpuid( info, 1 );
+        const bool os_saves_ymm = ( info[ 2 ] & ( 1 << 27 ) ) != 0 && ( _xgetbv( 0 ) & 6 ) == 6;
+        if( os_saves_ymm == false )
+            return false;
+        __cpuidex( info, 7, 0 );
+        return ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+    }
+#endif
+
+    struct Scanner
+    {
+        Scanner()
+        {
+#if SPI_BITMAP_SCAN_X86
+            if( HasAvx2() )
+            {
+                mScan = ScanAvx2;
+                mName = "avx2";
+            }
+            else
+            {
+                mScan = ScanSse2;
+                mName = "sse2";
+            }
+#else
+            mScan = ScanScalar;
+            mName = "scalar";
+#endif
+        }
+
+        ScanFunction mScan;
+        const char* mName;
+    };
+
+    const Scanner kScanner;
+}
+
+SpiBitmapStream::SpiBitmapStream()
+    : mWords( NULL ), mWordCount( 0 ), mSampleCount( 0 ), mSample( 0 ), mBitState( false ), mNextEdge( 0 ), mNextEdgeKnown( false )
+{
+}
+
+SpiBitmapStream::~SpiBitmapStream()
+{
+}
+
+void SpiBitmapStream::Setup( const uint64_t* words, uint64_t sample_count )
+{
+    mWords = words;
+    mWordCount = ( sample_count + 63 ) / 64;
+    mSampleCount = sample_count;
+    mSample = 0;
+    mBitState = sample_count > 0 && BitAt( 0 );
+    mNextEdgeKnown = false;
+}
+
+uint64_t SpiBitmapStream::GetSampleNumber()
+{
+    return mSample;
+}
+
+bool SpiBitmapStream::GetBitState()
+{
+    return mBitState;
+}
+
+void SpiBitmapStream::AdvanceToNextEdge()
+{
+    if( mNextEdgeKnown == false )
+        FindNextEdge();
+    if( mNextEdge == mSampleCount )
+        throw SpiEndOfStream();
+
+    mSample = mNextEdge;
+    mBitState = !mBitState;
+    mNextEdgeKnown = false;
+}
+
+void SpiBitmapStream::AdvanceToAbsPosition( uint64_t sample_number )
+{
+    if( sample_number >= mSampleCount )
+        throw SpiEndOfStream();
+
+    if( mNextEdgeKnown && sample_number >= mNextEdge )
+        mNextEdgeKnown = false;
+    mSample = sample_number;
+    mBitState = BitAt( sample_number );
+}
+
+uint64_t SpiBitmapStream::GetSampleOfNextEdge()
+{
+    if( mNextEdgeKnown == false )
+        FindNextEdge();
+    if( mNextEdge == mSampleCount )
+        throw SpiEndOfStream();
+
+    return mNextEdge;
+}
+
+bool SpiBitmapStream::WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number )
+{
+    if( mNextEdgeKnown == false )
+        FindNextEdge();
+    if( mNextEdge < mSampleCount )
+        return mNextEdge <= sample_number;
+
+    if( sample_number >= mSampleCount )
+        throw SpiEndOfStream();
+    return false;
+}
+
+bool SpiBitmapStream::DoMoreTransitionsExistInCurrentData()
+{
+    if( mNextEdgeKnown == false )
+        FindNextEdge();
+    return mNextEdge < mSampleCount;
+}
+
+void SpiBitmapStream::FindNextEdge()
+{
+    mNextEdgeKnown = true;
+    mNextEdge = mSampleCount;
+
+    const uint64_t first = mSample + 1;
+    if( first >= mSampleCount )
+        return;
+
+    // bits that differ from the current state are edges; the rest of the current word first, then whole words.
+    const uint64_t fill = mBitState ? ~0ull : 0;
+    uint64_t word = first >> 6;
+    uint64_t differs = ( mWords[ word ] ^ fill ) & ( ~0ull << ( first & 63 ) );
+    if( differs == 0 )
+    {
+        word = kScanner.mScan( mWords, word + 1, mWordCount, fill );
+        if( word == mWordCount )
+            return;
+        differs = mWords[ word ] ^ fill;
+    }
+
+    const uint64_t edge = ( word << 6 ) + LowestSetBit( differs );
+    if( edge < mSampleCount )
+        mNextEdge = edge;
+}
+
+uint64_t SpiCountBitmapEdges( const uint64_t* words, uint64_t sample_count )
+{
+    const uint64_t word_count = ( sample_count + 63 ) / 64;
+    uint64_t edges = 0;
+    uint64_t previous = word_count > 0 ? words[ 0 ] & 1 : 0; // so sample 0 isn't an edge
+    for( uint64_t i = 0; i < word_count; i++ )
+    {
+        // each bit against the one before it, which for bit 0 is the top bit of the previous word.
+        uint64_t toggles = words[ i ] ^ ( ( words[ i ] << 1 ) | previous );
+        if( i + 1 == word_count && ( sample_count & 63 ) != 0 )
+            toggles &= ( 1ull << ( sample_count & 63 ) ) - 1;
+        edges += PopCount( toggles );
+        previous = words[ i ] >> 63;
+    }
+    return edges;
+}
+
+const char* SpiBitmapScanName()
+{
+    return kScanner.mName;
+}
@@ -0,0 +1,58 @@
+#ifndef SPI_BITMAP_STREAM_H
+#define SPI_BITMAP_STREAM_H
+
+#include "SpiEdgeStream.h"
+
+#include <cstdint>
+
+// A channel of a complete capture, held as one bit per sample: sample i is bit i % 64 of words[ i / 64 ].
+//
+// The state at any sample is read straight from the bitmap, so sampling the data lines costs the same however often they toggle.
+// Next edges are found by comparing whole words against the current state, 512 samples at a time with AVX2 or 256 with SSE2 where the
+// processor has them, and picking out the first differing bit with a count of trailing zeros.
+class SpiBitmapStream : public SpiEdgeStream
+{
+  public:
+    SpiBitmapStream();
+    virtual ~SpiBitmapStream();
+
+    // words must hold at least sample_count bits and outlive the stream. Bits past sample_count are ignored.
+    void Setup( const uint64_t* words, uint64_t sample_count );
+
+    virtual uint64_t GetSampleNumber();
+    virtual bool GetBitState();
+
+    virtual void AdvanceToNextEdge();
+    virtual void AdvanceToAbsPosition( uint64_t sample_number );
+
+    virtual uint64_t GetSampleOfNextEdge();
+    virtual bool WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number );
+    virtual bool DoMoreTransitionsExistInCurrentData();
+
+  protected:
+    bool BitAt( uint64_t sample_number ) const
+    {
+        return ( ( mWords[ sample_number >> 6 ] >> ( sample_number & 63 ) ) & 1 ) != 0;
+    }
+
+    // sets mNextEdge to the first edge after mSample, or to mSampleCount if there isn't one.
+    void FindNextEdge();
+
+    const uint64_t* mWords;
+    uint64_t mWordCount;
+    uint64_t mSampleCount;
+    uint64_t mSample;
+    bool mBitState;
+
+    // found once, and kept until the stream moves past it; no edges lie in between.
+    uint64_t mNextEdge;
+    bool mNextEdgeKnown;
+};
+
+// the number of times the line toggles in a bitmap.
+uint64_t SpiCountBitmapEdges( const uint64_t* words, uint64_t sample_count );
+
+// the word scan in use: "avx2", "sse2" or "scalar".
+const char* SpiBitmapScanName();
+
+#endif // SPI_BITMAP_STREAM_H
@@ -0,0 +1,113 @@
+#include "SpiChannelDataStream.h"
+
+SpiChannelDataStream::SpiChannelDataStream()
+    : mChannelData( NULL ),
+      mIdleListener( NULL ),
+      mSampleNumber( 0 ),
+      mBitState( false ),
+      mChannelSampleNumber( 0 ),
+      mFirstEdge( 0 ),
+      mEdgeCount( 0 )
+{
+}
+
+SpiChannelDataStream::~SpiChannelDataStream()
+{
+}
+
+void SpiChannelDataStream::SetChannelData( AnalyzerChannelData* channel_data, IdleListener* idle_listener )
+{
+    mChannelData = channel_data;
+    mIdleListener = idle_listener;
+
+    mSampleNumber = channel_data->GetSampleNumber();
+    mBitState = channel_data->GetBitState() == BIT_HIGH;
+    mChannelSampleNumber = mSampleNumber;
+    mFirstEdge = 0;
+    mEdgeCount = 0;
+}
+
+void SpiChannelDataStream::ReadAhead()
+{
+    while( mEdgeCount < kReadAheadEdges && mChannelData->DoMoreTransitionsExistInCurrentData() )
+    {
+        mChannelData->AdvanceToNextEdge();
+        PushEdge( mChannelData->GetSampleNumber() );
+    }
+
+    if( mEdgeCount > 0 )
+        return;
+
+    // caught up with the capture; the SDK waits for the next edge.
+    if( mIdleListener != NULL )
+        mIdleListener->OnCaughtUpWithCapture();
+    mChannelData->AdvanceToNextEdge();
+    PushEdge( mChannelData->GetSampleNumber() );
+}
+
+void SpiChannelDataStream::PushEdge( uint64_t sample_number )
+{
+    mEdges[ ( mFirstEdge + mEdgeCount ) & ( kReadAheadEdges - 1 ) ] = sample_number;
+    mEdgeCount++;
+    mChannelSampleNumber = sample_number;
+}
+
+void SpiChannelDataStream::PopEdge()
+{
+    mSampleNumber = mEdges[ mFirstEdge ];
+    mBitState = !mBitState;
+    mFirstEdge = ( mFirstEdge + 1 ) & ( kReadAheadEdges - 1 );
+    mEdgeCount--;
+}
+
+uint64_t SpiChannelDataStream::GetSampleNumber()
+{
+    return mSampleNumber;
+}
+
+bool SpiChannelDataStream::GetBitState()
+{
+    return mBitState;
+}
+
+void SpiChannelDataStream::AdvanceToNextEdge()
+{
+    if( mEdgeCount == 0 )
+        ReadAhead();
+    PopEdge();
+}
+
+void SpiChannelDataStream::AdvanceToAbsPosition( uint64_t sample_number )
+{
+    while( mEdgeCount > 0 && mEdges[ mFirstEdge ] <= sample_number )
+        PopEdge();
+
+    // past everything read ahead, the SDK skips the rest in one call; skipped edges are never read.
+    if( mEdgeCount == 0 && sample_number > mChannelSampleNumber )
+    {
+        if( ( mChannelData->AdvanceToAbsPosition( sample_number ) & 1 ) != 0 )
+            mBitState = !mBitState;
+        mChannelSampleNumber = sample_number;
+    }
+
+    mSampleNumber = sample_number;
+}
+
+uint64_t SpiChannelDataStream::GetSampleOfNextEdge()
+{
+    if( mEdgeCount == 0 )
+        ReadAhead();
+    return mEdges[ mFirstEdge ];
+}
+
+bool SpiChannelDataStream::WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number )
+{
+    if( mEdgeCount > 0 )
+        return mEdges[ mFirstEdge ] <= sample_number;
+    return sample_number > mChannelSampleNumber && mChannelData->WouldAdvancingToAbsPositionCauseTransition( sample_number );
+}
+
+bool SpiChannelDataStream::DoMoreTransitionsExistInCurrentData()
+{
+    return mEdgeCount > 0 || mChannelData->DoMoreTransitionsExistInCurrentData();
+}
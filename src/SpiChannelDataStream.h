@@ -0,0 +1,66 @@
+#ifndef SPI_CHANNEL_DATA_STREAM_H
+#define SPI_CHANNEL_DATA_STREAM_H
+
+#include <AnalyzerChannelData.h>
+#include "SpiEdgeStream.h"
+
+// Lets the decoder walk a channel of the live capture.
+//
+// The SDK's cursor runs ahead of the decoder's. When the decoder asks for an edge, edges are read in a block, as far as the capture
+// has data without waiting, into a ring of sample numbers; the next edges, position and bit state are then answered from the ring.
+// Jumps past the ring go to the SDK in one call, which also gives the bit state by counting the transitions, so the edges of stretches
+// the decoder skips (data lines between samples, the clock outside enable) are never read one by one.
+class SpiChannelDataStream : public SpiEdgeStream
+{
+  public:
+    // told when the decoder has caught up with the capture, before a call that may wait for more data.
+    class IdleListener
+    {
+      public:
+        virtual ~IdleListener()
+        {
+        }
+        virtual void OnCaughtUpWithCapture() = 0;
+    };
+
+    SpiChannelDataStream();
+    virtual ~SpiChannelDataStream();
+
+    void SetChannelData( AnalyzerChannelData* channel_data, IdleListener* idle_listener = NULL );
+
+    virtual uint64_t GetSampleNumber();
+    virtual bool GetBitState();
+
+    virtual void AdvanceToNextEdge();
+    virtual void AdvanceToAbsPosition( uint64_t sample_number );
+
+    virtual uint64_t GetSampleOfNextEdge();
+    virtual bool WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number );
+    virtual bool DoMoreTransitionsExistInCurrentData();
+
+  protected:
+    // edges read ahead at most; a power of two. Each edge costs the same SDK calls however many are read at once, so larger blocks
+    // only read more of the edges a jump would have skipped.
+    static const uint32_t kReadAheadEdges = 16;
+
+    // fills the empty ring with edges the capture already has; if there are none, waits for the next one.
+    void ReadAhead();
+    void PushEdge( uint64_t sample_number );
+    void PopEdge();
+
+    AnalyzerChannelData* mChannelData;
+    IdleListener* mIdleListener;
+
+    // the decoder's position
+    uint64_t mSampleNumber;
+    bool mBitState;
+
+    // where the SDK's cursor is. Every edge after mSampleNumber, up to it, is in the ring.
+    uint64_t mChannelSampleNumber;
+
+    uint64_t mEdges[ kReadAheadEdges ];
+    uint32_t mFirstEdge;
+    uint32_t mEdgeCount;
+};
+
+#endif // SPI_CHANNEL_DATA_STREAM_H
@@ -0,0 +1,210 @@
+#include "SpiChipSelectMux.h"
+
+#include "SpiDecoder.h"
+
+#include <algorithm>
+
+namespace
+{
+    const uint64_t kNoEdge = ~uint64_t( 0 );
+
+    uint32_t LowestSlave( uint32_t mask )
+    {
+        uint32_t slave = 0;
+        while( ( mask & 1 ) == 0 )
+        {
+            mask >>= 1;
+            slave++;
+        }
+        return slave;
+    }
+}
+
+const uint32_t SpiChipSelectMux::kMaxChipSelects;
+const uint64_t SpiChipSelectMux::kFirstWaitSamples;
+const uint64_t SpiChipSelectMux::kMaxWaitSamples;
+
+SpiChipSelectMux::SpiChipSelectMux()
+    : mActiveState( false ),
+      mSink( NULL ),
+      mIdleListener( NULL ),
+      mSample( 0 ),
+      mBitState( true ),
+      mActiveSlave( 0 ),
+      mScanSample( 0 ),
+      mActiveMask( 0 ),
+      mNextEdge( 0 ),
+      mNextEdgeKnown( false ),
+      mNextSlave( 0 )
+{
+}
+
+SpiChipSelectMux::~SpiChipSelectMux()
+{
+}
+
+void SpiChipSelectMux::Setup( SpiEdgeStream* const* chip_selects, uint32_t count, bool active_state, SpiDecoderSink* sink,
+                              IdleListener* idle_listener )
+{
+    mChipSelects.assign( chip_selects, chip_selects + std::min( count, kMaxChipSelects ) );
+    mActiveState = active_state;
+    mSink = sink;
+    mIdleListener = idle_listener;
+
+    mSample = 0;
+    mActiveMask = 0;
+    for( uint32_t i = 0; i < mChipSelects.size(); i++ )
+    {
+        if( mChipSelects[ i ] == NULL )
+            continue;
+        mSample = mChipSelects[ i ]->GetSampleNumber();
+        if( mChipSelects[ i ]->GetBitState() == mActiveState )
+            mActiveMask |= 1u << i;
+    }
+
+    mBitState = mActiveMask != 0 ? mActiveState : !mActiveState;
+    mActiveSlave = mActiveMask != 0 ? LowestSlave( mActiveMask ) : 0;
+    mScanSample = mSample;
+    mNextEdgeKnown = false;
+}
+
+uint32_t SpiChipSelectMux::GetActiveSlave() const
+{
+    return mActiveSlave;
+}
+
+uint64_t SpiChipSelectMux::GetSampleNumber()
+{
+    return mSample;
+}
+
+bool SpiChipSelectMux::GetBitState()
+{
+    return mBitState;
+}
+
+void SpiChipSelectMux::AdvanceToNextEdge()
+{
+    if( mNextEdgeKnown == false )
+        FindNextEdge();
+
+    mSample = mNextEdge;
+    mBitState = !mBitState;
+    if( mBitState == mActiveState )
+        mActiveSlave = mNextSlave;
+    mNextEdgeKnown = false;
+}
+
+void SpiChipSelectMux::AdvanceToAbsPosition( uint64_t sample_number )
+{
+    while( WouldAdvancingToAbsPositionCauseTransition( sample_number ) )
+        AdvanceToNextEdge();
+    mSample = sample_number;
+}
+
+uint64_t SpiChipSelectMux::GetSampleOfNextEdge()
+{
+    if( mNextEdgeKnown == false )
+        FindNextEdge();
+    return mNextEdge;
+}
+
+bool SpiChipSelectMux::WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number )
+{
+    if( mNextEdgeKnown )
+        return mNextEdge <= sample_number;
+    return ScanTo( sample_number );
+}
+
+bool SpiChipSelectMux::DoMoreTransitionsExistInCurrentData()
+{
+    while( mNextEdgeKnown == false )
+    {
+        // the lines may toggle without the combined line toggling, so keep reading what's there until it does.
+        uint64_t edge = kNoEdge;
+        for( uint32_t i = 0; i < mChipSelects.size(); i++ )
+        {
+            if( mChipSelects[ i ] != NULL && mChipSelects[ i ]->DoMoreTransitionsExistInCurrentData() )
+                edge = std::min( edge, mChipSelects[ i ]->GetSampleOfNextEdge() );
+        }
+        if( edge == kNoEdge )
+            return false;
+        ScanTo( edge );
+    }
+    return true;
+}
+
+void SpiChipSelectMux::FindNextEdge()
+{
+    // with every line caught up, there's no single line whose next edge is sure to come first; wait for the capture to reach a sample
+    // a little ahead instead, and look again.
+    uint64_t wait_samples = kFirstWaitSamples;
+    while( DoMoreTransitionsExistInCurrentData() == false )
+    {
+        if( mIdleListener != NULL )
+            mIdleListener->OnCaughtUpWithCapture();
+        if( ScanTo( mScanSample + wait_samples ) )
+            return;
+        wait_samples = std::min( wait_samples * 2, kMaxWaitSamples );
+    }
+}
+
+bool SpiChipSelectMux::ScanTo( uint64_t bound )
+{
+    uint64_t next_edges[ kMaxChipSelects ];
+    while( mScanSample < bound )
+    {
+        // the earliest chip select edge, if any is at or before bound
+        uint64_t edge = kNoEdge;
+        for( uint32_t i = 0; i < mChipSelects.size(); i++ )
+        {
+            next_edges[ i ] = kNoEdge;
+            if( mChipSelects[ i ] != NULL && mChipSelects[ i ]->WouldAdvancingToAbsPositionCauseTransition( bound ) )
+            {
+                next_edges[ i ] = mChipSelects[ i ]->GetSampleOfNextEdge();
+                edge = std::min( edge, next_edges[ i ] );
+            }
+        }
+        if( edge == kNoEdge )
+        {
+            mScanSample = bound;
+            return false;
+        }
+
+        const uint32_t previous_mask = mActiveMask;
+        uint32_t went_active = 0;
+        for( uint32_t i = 0; i < mChipSelects.size(); i++ )
+        {
+            if( next_edges[ i ] != edge )
+                continue;
+            mChipSelects[ i ]->AdvanceToNextEdge();
+            if( mChipSelects[ i ]->GetBitState() == mActiveState )
+            {
+                mActiveMask |= 1u << i;
+                went_active |= 1u << i;
+            }
+            else
+            {
+                mActiveMask &= ~( 1u << i );
+            }
+        }
+        mScanSample = edge;
+
+        // the slave that opens a window doesn't overlap anything; any other that goes active here, or while a window is open, does.
+        const uint32_t opener = previous_mask == 0 && went_active != 0 ? LowestSlave( went_active ) : kMaxChipSelects;
+        for( uint32_t i = 0; i < mChipSelects.size(); i++ )
+        {
+            if( ( went_active & ( 1u << i ) ) != 0 && i != opener && mSink != NULL )
+                mSink->OnChipSelectOverlap( edge, i );
+        }
+
+        if( ( previous_mask != 0 ) != ( mActiveMask != 0 ) )
+        {
+            mNextEdge = edge;
+            mNextEdgeKnown = true;
+            mNextSlave = opener < kMaxChipSelects ? opener : 0;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,84 @@
+#ifndef SPI_CHIP_SELECT_MUX_H
+#define SPI_CHIP_SELECT_MUX_H
+
+#include "SpiEdgeStream.h"
+
+#include <cstddef>
+#include <vector>
+
+class SpiDecoderSink;
+
+// The enable (chip select) lines of several slaves on one bus, seen as a single enable line that is active while any of them is. Given
+// to SpiDecoder as its enable stream, it lets one walk of the clock decode every slave; SpiDecoder asks which slave opened each
+// enable window.
+//
+// A chip select going active while another one is active (or on the sample another goes inactive, which leaves no gap between the
+// transactions) is reported to the sink as an overlap. The enable window carries on, and stays with the slave that opened it.
+class SpiChipSelectMux : public SpiEdgeStream
+{
+  public:
+    // told when every chip select line has caught up with the capture, before the mux waits for more data.
+    class IdleListener
+    {
+      public:
+        virtual ~IdleListener()
+        {
+        }
+        virtual void OnCaughtUpWithCapture() = 0;
+    };
+
+    static const uint32_t kMaxChipSelects = 32;
+
+    SpiChipSelectMux();
+    virtual ~SpiChipSelectMux();
+
+    // chip_selects[ i ] is the enable line of slave i, or NULL for a slave that isn't in use; all of them at the same sample. sink
+    // and idle_listener may be NULL.
+    void Setup( SpiEdgeStream* const* chip_selects, uint32_t count, bool active_state, SpiDecoderSink* sink,
+                IdleListener* idle_listener = NULL );
+
+    // the slave that opened the current enable window, or the last one to, while no chip select is active.
+    uint32_t GetActiveSlave() const;
+
+    virtual uint64_t GetSampleNumber();
+    virtual bool GetBitState();
+
+    virtual void AdvanceToNextEdge();
+    virtual void AdvanceToAbsPosition( uint64_t sample_number );
+
+    virtual uint64_t GetSampleOfNextEdge();
+    virtual bool WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number );
+    virtual bool DoMoreTransitionsExistInCurrentData();
+
+  protected:
+    // the first chip select edges of a wait for more data are this far ahead at most; the distance doubles up to the maximum while
+    // the lines stay quiet.
+    static const uint64_t kFirstWaitSamples = 1 << 10;
+    static const uint64_t kMaxWaitSamples = 1 << 20;
+
+    // reads the chip select lines up to the next edge of the combined line, if it's at or before bound.
+    bool ScanTo( uint64_t bound );
+    // reads the chip select lines up to the next edge of the combined line, waiting for more data as needed.
+    void FindNextEdge();
+
+    std::vector<SpiEdgeStream*> mChipSelects;
+    bool mActiveState;
+    SpiDecoderSink* mSink;
+    IdleListener* mIdleListener;
+
+    // the combined line
+    uint64_t mSample;
+    bool mBitState;
+    uint32_t mActiveSlave;
+
+    // the chip select lines have been read up to mScanSample, where mActiveMask has a bit set for each active one.
+    uint64_t mScanSample;
+    uint32_t mActiveMask;
+
+    // the next edge of the combined line, once the lines have been read that far, and the slave that opens the window there.
+    uint64_t mNextEdge;
+    bool mNextEdgeKnown;
+    uint32_t mNextSlave;
+};
+
+#endif // SPI_CHIP_SELECT_MUX_H
@@ -0,0 +1,60 @@
+#include "SpiCommitScheduler.h"
+
+namespace
+{
+    // the clock is only read every few words; at any realistic word rate that is well under a millisecond.
+    const uint32_t kWordsPerTimeCheck = 16;
+}
+
+SpiCommitScheduler::SpiCommitScheduler()
+    : mMaxWords( 1 ), mWordsPerTimeCheck( kWordsPerTimeCheck ), mMaxInterval( 0 ), mPendingWords( 0 ), mPending( false )
+{
+}
+
+void SpiCommitScheduler::Setup( uint32_t max_words, uint32_t max_interval_ms, bool check_time_every_word )
+{
+    mMaxWords = max_words > 0 ? max_words : 1;
+    mWordsPerTimeCheck = check_time_every_word ? 1 : kWordsPerTimeCheck;
+    mMaxInterval = std::chrono::milliseconds( max_interval_ms );
+    mPendingWords = 0;
+    mPending = false;
+}
+
+bool SpiCommitScheduler::AddWord()
+{
+    AddEvent();
+    mPendingWords++;
+
+    if( mPendingWords >= mMaxWords )
+        return true;
+
+    if( ( mPendingWords % mWordsPerTimeCheck ) == 0 )
+        return IntervalElapsed();
+
+    return false;
+}
+
+void SpiCommitScheduler::AddEvent()
+{
+    if( mPending == false )
+    {
+        mPending = true;
+        mFirstPending = std::chrono::steady_clock::now();
+    }
+}
+
+bool SpiCommitScheduler::HasPending() const
+{
+    return mPending;
+}
+
+void SpiCommitScheduler::Committed()
+{
+    mPendingWords = 0;
+    mPending = false;
+}
+
+bool SpiCommitScheduler::IntervalElapsed()
+{
+    return std::chrono::steady_clock::now() - mFirstPending >= mMaxInterval;
+}
@@ -0,0 +1,38 @@
+#ifndef SPI_COMMIT_SCHEDULER_H
+#define SPI_COMMIT_SCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+
+// Decides when decoded results are published. Publishing after every word costs far more than decoding it, so results are held
+// until a batch of words has built up or the oldest unpublished result has waited for the maximum interval. Whoever owns the
+// scheduler must also publish before waiting on more capture data, so nothing stays hidden while the decoder is idle.
+class SpiCommitScheduler
+{
+  public:
+    SpiCommitScheduler();
+
+    // the clock is normally read every few words; with check_time_every_word, as for a live latency target, after every one.
+    void Setup( uint32_t max_words, uint32_t max_interval_ms, bool check_time_every_word = false );
+
+    // returns true when the pending results should be published now.
+    bool AddWord();
+    // results other than words (enable, disable, errors) that aren't published yet.
+    void AddEvent();
+
+    bool HasPending() const;
+    void Committed();
+
+  protected:
+    bool IntervalElapsed();
+
+    uint32_t mMaxWords;
+    uint32_t mWordsPerTimeCheck;
+    std::chrono::steady_clock::duration mMaxInterval;
+
+    uint32_t mPendingWords;
+    bool mPending;
+    std::chrono::steady_clock::time_point mFirstPending;
+};
+
+#endif // SPI_COMMIT_SCHEDULER_H
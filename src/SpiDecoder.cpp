@@ -0,0 +1,447 @@
+#include "SpiDecoder.h"
+#include "SpiChipSelectMux.h"
+#include "SpiWordAccumulator.h"
+
+#include <cstddef>
+
+SpiDecoderSettings::SpiDecoderSettings()
+    : mLsbFirst( false ),
+      mBitsPerTransfer( 8 ),
+      mClockInactiveState( false ),
+      mDataValidOnLeadingEdge( true ),
+      mEnableActiveState( false ),
+      mBitMarkers( SpiBitMarkersAll ),
+      mDataLanes( 1 ),
+      mSingleBitWords( 0 ),
+      mGenericKernel( false )
+{
+}
+
+SpiDecoder::SpiDecoder()
+    : mSink( NULL ),
+      mMosi( NULL ),
+      mMiso( NULL ),
+      mClock( NULL ),
+      mEnable( NULL ),
+      mIo2( NULL ),
+      mIo3( NULL ),
+      mChipSelects( NULL ),
+      mGetWord( NULL ),
+      mGetWideWord( NULL ),
+      mSingleBitWordsLeft( 0 ),
+      mCurrentSample( 0 ),
+      mEnableWindowEnd( 0 ),
+      mEnableWindowEndKnown( false )
+{
+}
+
+SpiDecoder::~SpiDecoder()
+{
+}
+
+void SpiDecoder::Setup( const SpiDecoderSettings& settings, SpiEdgeStream* clock, SpiEdgeStream* mosi, SpiEdgeStream* miso,
+                        SpiEdgeStream* enable, SpiDecoderSink* sink )
+{
+    mSettings = settings;
+    mClock = clock;
+    mMosi = mosi;
+    mMiso = miso;
+    mEnable = enable;
+    mIo2 = NULL;
+    mIo3 = NULL;
+    mChipSelects = NULL;
+    mSink = sink;
+
+    mCurrentSample = 0;
+    mEnableWindowEndKnown = false;
+
+    // indexed by [data valid edge][mosi used][miso used][enable used]
+    static const GetWordKernel kernels[ 16 ] = {
+        &SpiDecoder::GetWord<false, false, false, false, false, 1>, &SpiDecoder::GetWord<false, false, false, false, true, 1>,
+        &SpiDecoder::GetWord<false, false, false, true, false, 1>,  &SpiDecoder::GetWord<false, false, false, true, true, 1>,
+        &SpiDecoder::GetWord<false, false, true, false, false, 1>,  &SpiDecoder::GetWord<false, false, true, false, true, 1>,
+        &SpiDecoder::GetWord<false, false, true, true, false, 1>,   &SpiDecoder::GetWord<false, false, true, true, true, 1>,
+        &SpiDecoder::GetWord<false, true, false, false, false, 1>,  &SpiDecoder::GetWord<false, true, false, false, true, 1>,
+        &SpiDecoder::GetWord<false, true, false, true, false, 1>,   &SpiDecoder::GetWord<false, true, false, true, true, 1>,
+        &SpiDecoder::GetWord<false, true, true, false, false, 1>,   &SpiDecoder::GetWord<false, true, true, false, true, 1>,
+        &SpiDecoder::GetWord<false, true, true, true, false, 1>,    &SpiDecoder::GetWord<false, true, true, true, true, 1>,
+    };
+
+    // indexed by [data valid edge][enable used][quad]
+    static const GetWordKernel wide_kernels[ 8 ] = {
+        &SpiDecoder::GetWord<false, false, true, true, false, 2>, &SpiDecoder::GetWord<false, false, true, true, false, 4>,
+        &SpiDecoder::GetWord<false, false, true, true, true, 2>,  &SpiDecoder::GetWord<false, false, true, true, true, 4>,
+        &SpiDecoder::GetWord<false, true, true, true, false, 2>,  &SpiDecoder::GetWord<false, true, true, true, false, 4>,
+        &SpiDecoder::GetWord<false, true, true, true, true, 2>,   &SpiDecoder::GetWord<false, true, true, true, true, 4>,
+    };
+
+    uint32_t kernel_index = 0;
+    if( mSettings.mDataValidOnLeadingEdge )
+        kernel_index |= 8;
+    if( mMosi != NULL )
+        kernel_index |= 4;
+    if( mMiso != NULL )
+        kernel_index |= 2;
+    if( mEnable != NULL )
+        kernel_index |= 1;
+    mGetWord = kernels[ kernel_index ];
+
+    uint32_t wide_kernel_index = 0;
+    if( mSettings.mDataValidOnLeadingEdge )
+        wide_kernel_index |= 4;
+    if( mEnable != NULL )
+        wide_kernel_index |= 2;
+    if( mSettings.mDataLanes == 4 )
+        wide_kernel_index |= 1;
+    mGetWideWord = wide_kernels[ wide_kernel_index ];
+
+    if( mSettings.mGenericKernel )
+    {
+        mGetWord = &SpiDecoder::GetWord<true, false, false, false, false, 1>;
+        mGetWideWord = &SpiDecoder::GetWord<true, false, false, false, false, 0>;
+    }
+}
+
+void SpiDecoder::SetupWideLanes( SpiEdgeStream* io2, SpiEdgeStream* io3 )
+{
+    mIo2 = io2;
+    mIo3 = io3;
+}
+
+void SpiDecoder::SetupChipSelects( SpiChipSelectMux* chip_selects )
+{
+    mChipSelects = chip_selects;
+}
+
+uint32_t SpiDecoder::GetActiveSlave() const
+{
+    return mChipSelects != NULL ? mChipSelects->GetActiveSlave() : 0;
+}
+
+void SpiDecoder::Run()
+{
+    AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
+
+    if( mSettings.mDataLanes <= 1 )
+    {
+        for( ;; )
+        {
+            ( this->*mGetWord )();
+            mSink->PollForExit();
+        }
+    }
+
+    for( ;; )
+    {
+        // counted down before the word, so an enable window that ends inside it starts the next window's count afresh.
+        if( mSingleBitWordsLeft > 0 )
+        {
+            mSingleBitWordsLeft--;
+            ( this->*mGetWord )();
+        }
+        else
+        {
+            ( this->*mGetWideWord )();
+        }
+        mSink->PollForExit();
+    }
+}
+
+void SpiDecoder::AdvanceToActiveEnableEdgeWithCorrectClockPolarity()
+{
+    mSink->OnPacketBoundary();
+    mSingleBitWordsLeft = mSettings.mSingleBitWords;
+
+    AdvanceToActiveEnableEdge();
+
+    for( ;; )
+    {
+        if( IsInitialClockPolarityCorrect() == true ) // if false, this function moves to the next active enable edge.
+        {
+            if( mEnable )
+            {
+                mSink->OnEnable( mCurrentSample, GetActiveSlave() );
+
+                // the end of this enable window is looked up lazily, once the inactive-going edge is in the data.
+                mEnableWindowEndKnown = false;
+            }
+            break;
+        }
+    }
+}
+
+void SpiDecoder::AdvanceToActiveEnableEdge()
+{
+    if( mEnable != NULL )
+    {
+        if( mEnable->GetBitState() != mSettings.mEnableActiveState )
+        {
+            mEnable->AdvanceToNextEdge();
+        }
+        else
+        {
+            mEnable->AdvanceToNextEdge();
+            mEnable->AdvanceToNextEdge();
+        }
+        mCurrentSample = mEnable->GetSampleNumber();
+        mClock->AdvanceToAbsPosition( mCurrentSample );
+    }
+    else
+    {
+        mCurrentSample = mClock->GetSampleNumber();
+    }
+}
+
+bool SpiDecoder::IsInitialClockPolarityCorrect()
+{
+    if( mClock->GetBitState() == mSettings.mClockInactiveState )
+        return true;
+
+    mSink->OnClockPolarityError( mCurrentSample );
+
+    if( mEnable != NULL )
+    {
+        uint64_t error_start = mCurrentSample;
+
+        mEnable->AdvanceToNextEdge();
+        mCurrentSample = mEnable->GetSampleNumber();
+
+        mSink->OnErrorFrame( error_start, mCurrentSample, GetActiveSlave() );
+
+        // move to the next active-going enable edge
+        mEnable->AdvanceToNextEdge();
+        mCurrentSample = mEnable->GetSampleNumber();
+        mClock->AdvanceToAbsPosition( mCurrentSample );
+
+        return false;
+    }
+    else
+    {
+        mClock->AdvanceToNextEdge(); // at least start with the clock in the idle state.
+        mCurrentSample = mClock->GetSampleNumber();
+        return true;
+    }
+}
+
+bool SpiDecoder::WouldAdvancingTheClockToggleEnable( bool add_disable_frame, uint64_t* disable_frame )
+{
+    if( mEnable == NULL )
+        return false;
+
+    auto log_disable_event = [&]( uint64_t enable_edge ) {
+        if( add_disable_frame )
+            mSink->OnDisable( enable_edge, GetActiveSlave() );
+        else if( disable_frame != nullptr )
+            *disable_frame = enable_edge;
+    };
+
+    if( mEnableWindowEndKnown == false && mEnable->DoMoreTransitionsExistInCurrentData() )
+    {
+        mEnableWindowEnd = mEnable->GetSampleOfNextEdge();
+        mEnableWindowEndKnown = true;
+    }
+
+    if( mEnableWindowEndKnown == true )
+    {
+        // the enable line doesn't move within the window, so only the clock needs checking: advancing toggles enable if the next
+        // clock edge lands on or after the end of the window.
+        if( mClock->WouldAdvancingToAbsPositionCauseTransition( mEnableWindowEnd - 1 ) == true )
+            return false;
+
+        log_disable_event( mEnableWindowEnd );
+        return true;
+    }
+
+    // the end of the window hasn't been captured yet, so check both lines on every edge.
+    // if the enable is currently active, and there are no more clock transitions in the capture, attempt to capture the final disable event
+    if( !mClock->DoMoreTransitionsExistInCurrentData() && mEnable->GetBitState() == mSettings.mEnableActiveState )
+    {
+        if( mEnable->DoMoreTransitionsExistInCurrentData() )
+        {
+            uint64_t next_enable_edge = mEnable->GetSampleOfNextEdge();
+            // double check that the clock line actually processed all samples up to the next enable edge.
+            // double check is required becase data is getting processed while we're running, it's possible more has already become
+            // available.
+            if( !mClock->WouldAdvancingToAbsPositionCauseTransition( next_enable_edge ) )
+            {
+                log_disable_event( next_enable_edge );
+                return true;
+            }
+        }
+    }
+
+    uint64_t next_edge = mClock->GetSampleOfNextEdge();
+    bool enable_will_toggle = mEnable->WouldAdvancingToAbsPositionCauseTransition( next_edge );
+
+    if( enable_will_toggle )
+    {
+        uint64_t enable_edge = mEnable->GetSampleOfNextEdge();
+        log_disable_event( enable_edge );
+    }
+
+    if( enable_will_toggle == false )
+        return false;
+    else
+        return true;
+}
+
+// inlined into each kernel, where the arguments are constants unless the kernel is generic
+inline void SpiDecoder::SampleDataLines( bool use_mosi, bool use_miso, uint32_t lanes, SpiWordAccumulator& mosi_bits,
+                                         SpiWordAccumulator& miso_bits )
+{
+    if( lanes == 1 )
+    {
+        if( use_mosi )
+        {
+            mMosi->AdvanceToAbsPosition( mCurrentSample );
+            mosi_bits.AddBit( mMosi->GetBitState() );
+        }
+        if( use_miso )
+        {
+            mMiso->AdvanceToAbsPosition( mCurrentSample );
+            miso_bits.AddBit( mMiso->GetBitState() );
+        }
+        return;
+    }
+
+    // IO0 is the least significant bit of each group.
+    mMosi->AdvanceToAbsPosition( mCurrentSample );
+    mMiso->AdvanceToAbsPosition( mCurrentSample );
+    uint32_t group = uint32_t( mMosi->GetBitState() ) | ( uint32_t( mMiso->GetBitState() ) << 1 );
+    if( lanes == 4 )
+    {
+        mIo2->AdvanceToAbsPosition( mCurrentSample );
+        mIo3->AdvanceToAbsPosition( mCurrentSample );
+        group |= ( uint32_t( mIo2->GetBitState() ) << 2 ) | ( uint32_t( mIo3->GetBitState() ) << 3 );
+    }
+
+    // an LSB first word is reversed bit by bit once it's complete, which puts its groups in order; reversing each group as it comes
+    // in keeps the lanes in order too.
+    if( mSettings.mLsbFirst )
+        group = kSpiReversedBytes[ group ] >> ( 8 - lanes );
+    mosi_bits.AddBits( group, lanes );
+}
+
+template <bool kGeneric, bool kDataOnLeadingEdge, bool kUseMosi, bool kUseMiso, bool kUseEnable, uint32_t kLanes>
+void SpiDecoder::GetWord()
+{
+    // we're assuming we come into this function with the clock in the idle state;
+
+    const bool data_on_leading_edge = kGeneric ? mSettings.mDataValidOnLeadingEdge : kDataOnLeadingEdge;
+    const bool use_mosi = kGeneric ? mMosi != NULL : kUseMosi;
+    const bool use_miso = kGeneric ? mMiso != NULL : kUseMiso;
+    const bool use_enable = kGeneric ? mEnable != NULL : kUseEnable;
+    const uint32_t lanes = kLanes != 0 ? kLanes : mSettings.mDataLanes;
+
+    const uint32_t bits_per_transfer = mSettings.mBitsPerTransfer;
+    const uint32_t clocks_per_word = bits_per_transfer / lanes;
+
+    const bool record_arrows = mSettings.mBitMarkers != SpiBitMarkersOff;
+
+    SpiWordAccumulator mosi_bits;
+    SpiWordAccumulator miso_bits;
+
+    uint64_t first_sample = 0;
+    bool need_reset = false;
+    uint64_t disable_event_sample = 0;
+
+    mSink->OnProgress( mClock->GetSampleNumber() );
+
+    for( uint32_t i = 0; i < clocks_per_word; i++ )
+    {
+        if( i == 0 )
+            mSink->PollForExit();
+
+        // on every single edge, we need to check that enable doesn't toggle.
+        // note that we can't just advance the enable line to the next edge, becuase there may not be another edge
+
+        if( use_enable && WouldAdvancingTheClockToggleEnable( true, nullptr ) == true )
+        {
+            AdvanceToActiveEnableEdgeWithCorrectClockPolarity(); // ok, we pretty much need to reset everything and return.
+            return;
+        }
+
+        mClock->AdvanceToNextEdge();
+        if( i == 0 )
+            first_sample = mClock->GetSampleNumber();
+
+        if( data_on_leading_edge )
+        {
+            mCurrentSample = mClock->GetSampleNumber();
+            SampleDataLines( use_mosi, use_miso, lanes, mosi_bits, miso_bits );
+            if( record_arrows )
+                mArrowLocations[ i ] = mCurrentSample;
+        }
+
+
+        // ok, the trailing edge is messy -- but only on the very last bit.
+        // If the trialing edge isn't doesn't represent valid data, we want to allow the enable line to rise before the clock trialing edge
+        // -- and still report the frame
+        if( data_on_leading_edge && ( i == ( clocks_per_word - 1 ) ) )
+        {
+            // if this is the last bit, and the trailing edge doesn't represent valid data
+            if( use_enable && WouldAdvancingTheClockToggleEnable( false, &disable_event_sample ) == true )
+            {
+                // moving to the trailing edge would cause the clock to revert to inactive.  jump out, record the frame, and them move to
+                // the next active enable edge
+                need_reset = true;
+                break;
+            }
+
+            // enable isn't going to go inactive, go ahead and advance the clock as usual.  Then we're done, jump out and record the frame.
+            mClock->AdvanceToNextEdge();
+            break;
+        }
+
+        // this isn't the very last bit, etc, so proceed as normal
+        if( use_enable && WouldAdvancingTheClockToggleEnable( true, nullptr ) == true )
+        {
+            AdvanceToActiveEnableEdgeWithCorrectClockPolarity(); // ok, we pretty much need to reset everything and return.
+            return;
+        }
+
+        mClock->AdvanceToNextEdge();
+
+        if( !data_on_leading_edge )
+        {
+            mCurrentSample = mClock->GetSampleNumber();
+            SampleDataLines( use_mosi, use_miso, lanes, mosi_bits, miso_bits );
+            if( record_arrows )
+                mArrowLocations[ i ] = mCurrentSample;
+        }
+    }
+
+    // save the results:
+    SpiWord word;
+    word.mStartingSample = first_sample;
+    word.mEndingSample = mClock->GetSampleNumber();
+    word.mMosi = mosi_bits.GetWord( bits_per_transfer, mSettings.mLsbFirst );
+    word.mMiso = lanes == 1 ? miso_bits.GetWord( bits_per_transfer, mSettings.mLsbFirst ) : 0;
+    SpiPackWordBytes( word.mMosi, ( bits_per_transfer + 7 ) / 8, word.mMosiBytes );
+    SpiPackWordBytes( word.mMiso, ( bits_per_transfer + 7 ) / 8, word.mMisoBytes );
+    word.mArrowLocations = mArrowLocations;
+    word.mDataLanes = lanes;
+    word.mSlave = GetActiveSlave();
+
+    // a word is only reported once every one of its bits has been sampled.
+    if( mSettings.mBitMarkers == SpiBitMarkersAll )
+    {
+        word.mArrowCount = clocks_per_word;
+    }
+    else if( mSettings.mBitMarkers == SpiBitMarkersFirstAndLast )
+    {
+        mArrowLocations[ 1 ] = mArrowLocations[ clocks_per_word - 1 ];
+        word.mArrowCount = clocks_per_word > 1 ? 2 : 1;
+    }
+    else
+    {
+        word.mArrowCount = 0;
+    }
+    mSink->OnWord( word );
+
+    if( need_reset == true )
+    {
+        mSink->OnDisable( disable_event_sample, GetActiveSlave() );
+        AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
+    }
+}
@@ -0,0 +1,147 @@
+#ifndef SPI_DECODER_H
+#define SPI_DECODER_H
+
+#include "SpiEdgeStream.h"
+
+#include <cstdint>
+
+class SpiChipSelectMux;
+class SpiWordAccumulator;
+
+// which clock edges of a word are reported in SpiWord::mArrowLocations
+enum SpiBitMarkers
+{
+    SpiBitMarkersOff,
+    SpiBitMarkersFirstAndLast,
+    SpiBitMarkersAll
+};
+
+struct SpiDecoderSettings
+{
+    SpiDecoderSettings();
+
+    bool mLsbFirst;
+    uint32_t mBitsPerTransfer;
+    bool mClockInactiveState;
+    bool mDataValidOnLeadingEdge;
+    bool mEnableActiveState;
+    SpiBitMarkers mBitMarkers;
+
+    // data lines a word is read from: 1 for standard SPI, 2 for dual or 4 for quad I/O. Dual and quad words take
+    // mBitsPerTransfer / mDataLanes clocks, so mBitsPerTransfer must be a multiple of mDataLanes.
+    uint32_t mDataLanes;
+    // dual and quad I/O: how many words at the start of each enable window are sent one bit per clock, as in standard SPI, before
+    // the lanes go wide. For example 1 for the command of a 1-4-4 flash read, 4 for the command and address of a 1-1-4 read.
+    uint32_t mSingleBitWords;
+
+    // decode every word with the one kernel that tests the settings, and which lines are in use, on every bit, instead of the
+    // kernel specialized for them. The words are the same; spi_benchmark uses it to measure what the specialization is worth.
+    bool mGenericKernel;
+};
+
+struct SpiWord
+{
+    uint64_t mStartingSample;
+    uint64_t mEndingSample;
+    uint64_t mMosi;
+    uint64_t mMiso;
+    // the words as (bits + 7) / 8 bytes, most significant first
+    uint8_t mMosiBytes[ 8 ];
+    uint8_t mMisoBytes[ 8 ];
+
+    // samples of the clock edges the bits were taken on, as selected by SpiDecoderSettings::mBitMarkers
+    const uint64_t* mArrowLocations;
+    uint32_t mArrowCount;
+
+    // 1 for a word read a bit per clock from MOSI and MISO. 2 or 4 for a word read across the dual or quad I/O lanes, which is in
+    // mMosi; mMiso is then zero.
+    uint32_t mDataLanes;
+
+    // the slave whose enable window the word is in, with several chip selects (see SpiDecoder::SetupChipSelects()); otherwise 0.
+    uint32_t mSlave;
+};
+
+// Receives everything the decoder finds, in capture order.
+class SpiDecoderSink
+{
+  public:
+    virtual ~SpiDecoderSink()
+    {
+    }
+
+    // called before searching for the next active enable edge
+    virtual void OnPacketBoundary() = 0;
+    // slave is as in SpiWord::mSlave.
+    virtual void OnEnable( uint64_t sample, uint32_t slave ) = 0;
+    virtual void OnDisable( uint64_t sample, uint32_t slave ) = 0;
+    // the clock wasn't idle when the enable line went active (or at the start of the capture, without enable)
+    virtual void OnClockPolarityError( uint64_t sample ) = 0;
+    // the enable window that started with a clock polarity error
+    virtual void OnErrorFrame( uint64_t starting_sample, uint64_t ending_sample, uint32_t slave ) = 0;
+    virtual void OnWord( const SpiWord& word ) = 0;
+    // several chip selects: slave's went active while another slave's was. Reported by SpiChipSelectMux as it reads ahead on the
+    // chip select lines, so it can come before the words of the window it's in.
+    virtual void OnChipSelectOverlap( uint64_t sample, uint32_t slave ) = 0;
+
+    virtual void OnProgress( uint64_t sample ) = 0;
+    // may not return (throw) if decoding should stop
+    virtual void PollForExit() = 0;
+};
+
+// The SPI decode state machine, independent of the Logic SDK. Run() only returns by exception: either from the sink, or from a
+// stream that has run out of data.
+class SpiDecoder
+{
+  public:
+    SpiDecoder();
+    ~SpiDecoder();
+
+    // mosi, miso and enable may be NULL when not in use.
+    void Setup( const SpiDecoderSettings& settings, SpiEdgeStream* clock, SpiEdgeStream* mosi, SpiEdgeStream* miso, SpiEdgeStream* enable,
+                SpiDecoderSink* sink );
+    // dual and quad I/O: the lanes after IO0 and IO1, which are the mosi and miso streams given to Setup() and must not be NULL. io2
+    // and io3 are only used, and must not be NULL, for quad I/O. Call after Setup().
+    void SetupWideLanes( SpiEdgeStream* io2, SpiEdgeStream* io3 );
+    // several chip selects on one bus: chip_selects is also the enable stream given to Setup(), and tells which slave each enable
+    // window belongs to. Call after Setup().
+    void SetupChipSelects( SpiChipSelectMux* chip_selects );
+    void Run();
+
+  protected: // functions
+    void AdvanceToActiveEnableEdge();
+    bool IsInitialClockPolarityCorrect();
+    void AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
+    bool WouldAdvancingTheClockToggleEnable( bool add_disable_frame, uint64_t* disable_frame );
+    uint32_t GetActiveSlave() const;
+
+    // GetWord is specialized for the settings that don't change during a run; Setup() picks the matching kernels. Every lane is
+    // sampled on the same walk of the clock. The kGeneric kernels ignore the other parameters and test the settings as they go,
+    // except kLanes: 1 for the single-bit words, 0 for SpiDecoderSettings::mDataLanes.
+    template <bool kGeneric, bool kDataOnLeadingEdge, bool kUseMosi, bool kUseMiso, bool kUseEnable, uint32_t kLanes>
+    void GetWord();
+    void SampleDataLines( bool use_mosi, bool use_miso, uint32_t lanes, SpiWordAccumulator& mosi_bits, SpiWordAccumulator& miso_bits );
+    typedef void ( SpiDecoder::*GetWordKernel )();
+
+  protected: // vars
+    SpiDecoderSettings mSettings;
+    SpiDecoderSink* mSink;
+
+    SpiEdgeStream* mMosi;
+    SpiEdgeStream* mMiso;
+    SpiEdgeStream* mClock;
+    SpiEdgeStream* mEnable;
+    SpiEdgeStream* mIo2;
+    SpiEdgeStream* mIo3;
+    SpiChipSelectMux* mChipSelects;
+    GetWordKernel mGetWord;
+    // dual and quad I/O words, after the single-bit ones
+    GetWordKernel mGetWideWord;
+    uint32_t mSingleBitWordsLeft;
+
+    uint64_t mCurrentSample;
+    uint64_t mEnableWindowEnd;
+    bool mEnableWindowEndKnown;
+    uint64_t mArrowLocations[ 64 ];
+};
+
+#endif // SPI_DECODER_H
@@ -0,0 +1,26 @@
+#ifndef SPI_EDGE_STREAM_H
+#define SPI_EDGE_STREAM_H
+
+#include <cstdint>
+
+// The subset of AnalyzerChannelData the decoder needs, so it can run against the Logic SDK or against captures loaded from disk.
+// Bit states are true when the line is high.
+class SpiEdgeStream
+{
+  public:
+    virtual ~SpiEdgeStream()
+    {
+    }
+
+    virtual uint64_t GetSampleNumber() = 0;
+    virtual bool GetBitState() = 0;
+
+    virtual void AdvanceToNextEdge() = 0;
+    virtual void AdvanceToAbsPosition( uint64_t sample_number ) = 0;
+
+    virtual uint64_t GetSampleOfNextEdge() = 0;
+    virtual bool WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number ) = 0;
+    virtual bool DoMoreTransitionsExistInCurrentData() = 0;
+};
+
+#endif // SPI_EDGE_STREAM_H
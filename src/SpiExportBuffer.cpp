@@ -0,0 +1,67 @@
+#include "SpiExportBuffer.h"
+
+#include <AnalyzerHelpers.h>
+#include <cstring>
+
+namespace
+{
+    const size_t kFlushSize = 4 << 20;
+    // Reserve() never asks for more than a row
+    const size_t kSlack = 64 << 10;
+}
+
+SpiExportBuffer::SpiExportBuffer() : mFile( NULL ), mUsed( 0 )
+{
+}
+
+SpiExportBuffer::~SpiExportBuffer()
+{
+    End();
+}
+
+void SpiExportBuffer::Start( const char* file, bool is_binary )
+{
+    End();
+    mFile = AnalyzerHelpers::StartFile( file, is_binary );
+    mBuffer.resize( kFlushSize + kSlack );
+    mUsed = 0;
+}
+
+void SpiExportBuffer::End()
+{
+    if( mFile == NULL )
+        return;
+
+    Flush();
+    AnalyzerHelpers::EndFile( mFile );
+    mFile = NULL;
+
+    std::vector<char>().swap( mBuffer );
+}
+
+void SpiExportBuffer::Append( const void* data, size_t length )
+{
+    const char* bytes = static_cast<const char*>( data );
+    while( length > 0 )
+    {
+        size_t room = mBuffer.size() - mUsed;
+        if( room == 0 )
+        {
+            Flush();
+            room = mBuffer.size();
+        }
+
+        size_t count = length < room ? length : room;
+        memcpy( &mBuffer[ mUsed ], bytes, count );
+        mUsed += count;
+        bytes += count;
+        length -= count;
+    }
+}
+
+void SpiExportBuffer::Flush()
+{
+    if( mUsed > 0 )
+        AnalyzerHelpers::AppendToFile( reinterpret_cast<U8*>( &mBuffer[ 0 ] ), U32( mUsed ), mFile );
+    mUsed = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef SPI_EXPORT_BUFFER_H
+#define SPI_EXPORT_BUFFER_H
+
+#include <AnalyzerTypes.h>
+#include <cstddef>
+#include <vector>
+
+// Collects export output in one large buffer and hands it to AnalyzerHelpers in multi-megabyte writes, instead of once per row.
+class SpiExportBuffer
+{
+  public:
+    SpiExportBuffer();
+    ~SpiExportBuffer();
+
+    void Start( const char* file, bool is_binary );
+    void End();
+
+    // returns room for at least length bytes; Commit() the number actually written.
+    char* Reserve( size_t length )
+    {
+        if( mUsed + length > mBuffer.size() )
+            Flush();
+        return &mBuffer[ mUsed ];
+    }
+
+    void Commit( size_t length )
+    {
+        mUsed += length;
+    }
+
+    void Append( const void* data, size_t length );
+
+  protected:
+    void Flush();
+
+    void* mFile;
+    std::vector<char> mBuffer;
+    size_t mUsed;
+};
+
+#endif // SPI_EXPORT_BUFFER_H
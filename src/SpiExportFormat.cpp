@@ -0,0 +1,360 @@
+#include "SpiExportFormat.h"
+
+#include <AnalyzerHelpers.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // the SDK divides in double precision; its result is within about 2^-52 of the exact value, relative. Rows whose exact value is
+    // closer than 2^-50 to a rounding midpoint are left to the SDK.
+    const double kDoubleErrorBound = 1.0 / ( 1ull << 50 );
+
+    // the exact value's decimals are worked out 9 at a time, so remainder * 10^9 stays within 64 bits.
+    const U32 kDecimalsPerStep = 9;
+    const U32 kMaxDecimals = 18;
+
+    const char kHexDigits[] = "0123456789ABCDEF";
+
+    U64 PowerOfTen( U32 exponent )
+    {
+        U64 result = 1;
+        while( exponent-- > 0 )
+            result *= 10;
+        return result;
+    }
+
+    U64 SplitMix64( U64 x )
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+        x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBull;
+        return x ^ ( x >> 31 );
+    }
+
+    struct FormatTables
+    {
+        FormatTables()
+        {
+            for( U32 i = 0; i < 256; i++ )
+            {
+                mHexPairs[ i ][ 0 ] = kHexDigits[ i >> 4 ];
+                mHexPairs[ i ][ 1 ] = kHexDigits[ i & 0xF ];
+                for( U32 bit = 0; bit < 8; bit++ )
+                    mBinaryBytes[ i ][ bit ] = ( ( i >> ( 7 - bit ) ) & 1 ) != 0 ? '1' : '0';
+            }
+            for( U32 i = 0; i < 100; i++ )
+            {
+                mDecimalPairs[ i ][ 0 ] = char( '0' + i / 10 );
+                mDecimalPairs[ i ][ 1 ] = char( '0' + i % 10 );
+            }
+        }
+
+        char mHexPairs[ 256 ][ 2 ];
+        char mBinaryBytes[ 256 ][ 8 ];
+        char mDecimalPairs[ 100 ][ 2 ];
+    };
+
+    const FormatTables kTables;
+
+    // the low digits hex digits of value, most significant first.
+    void WriteHex( U64 value, U32 digits, char* out )
+    {
+        char* p = out + digits;
+        for( ; digits >= 2; digits -= 2 )
+        {
+            p -= 2;
+            memcpy( p, kTables.mHexPairs[ value & 0xFF ], 2 );
+            value >>= 8;
+        }
+        if( digits == 1 )
+            p[ -1 ] = kHexDigits[ value & 0xF ];
+    }
+
+    // the low bits of value, most significant first.
+    void WriteBinary( U64 value, U32 bits, char* out )
+    {
+        char* p = out + bits;
+        for( ; bits >= 8; bits -= 8 )
+        {
+            p -= 8;
+            memcpy( p, kTables.mBinaryBytes[ value & 0xFF ], 8 );
+            value >>= 8;
+        }
+        if( bits > 0 )
+            memcpy( out, kTables.mBinaryBytes[ value & 0xFF ] + 8 - bits, bits );
+    }
+
+    // zero padded to digits
+    char* WriteFixedDecimal( U64 value, U32 digits, char* out )
+    {
+        for( U32 i = digits; i > 0; i-- )
+        {
+            out[ i - 1 ] = char( '0' + value % 10 );
+            value /= 10;
+        }
+        return out + digits;
+    }
+}
+
+size_t SpiFormatDecimal( U64 value, char* out )
+{
+    char digits[ 20 ];
+    char* p = digits + sizeof( digits );
+    while( value >= 100 )
+    {
+        p -= 2;
+        memcpy( p, kTables.mDecimalPairs[ value % 100 ], 2 );
+        value /= 100;
+    }
+    if( value >= 10 )
+    {
+        p -= 2;
+        memcpy( p, kTables.mDecimalPairs[ value ], 2 );
+    }
+    else
+        *--p = char( '0' + value );
+
+    size_t count = digits + sizeof( digits ) - p;
+    memcpy( out, p, count );
+    return count;
+}
+
+SpiTimeFormatter::SpiTimeFormatter() : mTriggerSample( 0 ), mSampleRate( 0 ), mUseFastPath( false ), mDecimals( 0 ), mDecimalScale( 1 )
+{
+}
+
+void SpiTimeFormatter::Setup( U64 trigger_sample, U32 sample_rate, const U64* probe_samples, size_t probe_count )
+{
+    mTriggerSample = trigger_sample;
+    mSampleRate = sample_rate;
+    mUseFastPath = false;
+
+    if( sample_rate == 0 )
+        return;
+
+    // the SDK's precision, from a time with plenty of nonzero decimals.
+    char reference[ kMaxLength ];
+    AnalyzerHelpers::GetTimeString( trigger_sample + sample_rate + sample_rate / 3, trigger_sample, sample_rate, reference, kMaxLength );
+    const char* point = strchr( reference, '.' );
+    mDecimals = point != NULL ? U32( strlen( point + 1 ) ) : 0;
+    if( mDecimals > kMaxDecimals )
+        return;
+    mDecimalScale = PowerOfTen( mDecimals );
+
+    std::vector<U64> probes( probe_samples, probe_samples + probe_count );
+    const S64 rate = sample_rate;
+    const S64 offsets[] = { 0, 1, -1, rate, -rate, rate / 3, -rate / 3, rate - 1, 7 * rate / 3, 1000 * rate + 12345, -1000 * rate - 12345 };
+    for( size_t i = 0; i < sizeof( offsets ) / sizeof( offsets[ 0 ] ); i++ )
+        probes.push_back( trigger_sample + U64( offsets[ i ] ) );
+    for( U64 i = 0; i < 64; i++ )
+        probes.push_back( trigger_sample + SplitMix64( i ) % ( U64( sample_rate ) * 100 ) );
+
+    mUseFastPath = true;
+    for( size_t i = 0; i < probes.size() && mUseFastPath; i++ )
+        mUseFastPath = Matches( probes[ i ] );
+}
+
+bool SpiTimeFormatter::Matches( U64 sample ) const
+{
+    char fast[ kMaxLength ];
+    size_t length;
+    if( FormatFast( sample, fast, length ) == false )
+        return true; // this one would go to the SDK anyway
+
+    char reference[ kMaxLength ];
+    AnalyzerHelpers::GetTimeString( sample, mTriggerSample, mSampleRate, reference, kMaxLength );
+    return strcmp( fast, reference ) == 0;
+}
+
+size_t SpiTimeFormatter::Format( U64 sample, char* out ) const
+{
+    size_t length;
+    if( mUseFastPath && FormatFast( sample, out, length ) )
+        return length;
+
+    AnalyzerHelpers::GetTimeString( sample, mTriggerSample, mSampleRate, out, kMaxLength );
+    return strlen( out );
+}
+
+bool SpiTimeFormatter::FormatFast( U64 sample, char* out, size_t& length ) const
+{
+    const S64 offset = S64( sample - mTriggerSample );
+    const U64 magnitude = offset < 0 ? U64( 0 ) - U64( offset ) : U64( offset );
+
+    U64 seconds = magnitude / mSampleRate;
+    U64 remainder = magnitude % mSampleRate;
+    U64 fraction = 0;
+    for( U32 done = 0; done < mDecimals; )
+    {
+        U32 step = mDecimals - done < kDecimalsPerStep ? mDecimals - done : kDecimalsPerStep;
+        U64 scale = PowerOfTen( step );
+        remainder *= scale;
+        fraction = fraction * scale + remainder / mSampleRate;
+        remainder %= mSampleRate;
+        done += step;
+    }
+
+    // round to nearest, unless the value is too close to the midpoint to be sure the SDK rounds the same way.
+    double distance = std::fabs( 2.0 * double( remainder ) - double( mSampleRate ) ) / ( 2.0 * double( mSampleRate ) );
+    double units = double( magnitude ) / double( mSampleRate ) * double( mDecimalScale );
+    if( distance <= units * kDoubleErrorBound )
+        return false;
+
+    if( 2 * remainder > mSampleRate )
+    {
+        fraction++;
+        if( fraction == mDecimalScale )
+        {
+            fraction = 0;
+            seconds++;
+        }
+    }
+
+    char* p = out;
+    if( offset < 0 )
+        *p++ = '-';
+    p += SpiFormatDecimal( seconds, p );
+    if( mDecimals > 0 )
+    {
+        *p++ = '.';
+        p = WriteFixedDecimal( fraction, mDecimals, p );
+    }
+    *p = '\0';
+
+    length = p - out;
+    return true;
+}
+
+SpiNumberFormatter::SpiNumberFormatter()
+    : mDisplayBase( Hexadecimal ), mNumDataBits( 8 ), mMask( 0xFF ), mIsSetUp( false ), mUseFastPath( false ), mSmallCount( 0 )
+{
+}
+
+void SpiNumberFormatter::Setup( DisplayBase display_base, U32 num_data_bits )
+{
+    mDisplayBase = display_base;
+    mNumDataBits = num_data_bits;
+    mIsSetUp = true;
+    mUseFastPath = false;
+    mSmallCount = 0;
+
+    if( num_data_bits < 1 || num_data_bits > 64 )
+        return;
+    mMask = num_data_bits == 64 ? ~0ull : ( 1ull << num_data_bits ) - 1;
+
+    // small values, which is every value of an 8 bit word, are copied from the SDK when they fit the table. This also covers the ASCII
+    // bases' character names.
+    U32 small_count = mMask < 256 ? U32( mMask + 1 ) : 256;
+    for( U32 i = 0; i < small_count; i++ )
+    {
+        char reference[ kMaxLength ];
+        AnalyzerHelpers::GetNumberString( i, display_base, num_data_bits, reference, kMaxLength );
+        size_t length = strlen( reference );
+        if( length >= kSmallEntryLength )
+        {
+            small_count = 0;
+            break;
+        }
+        memcpy( mSmallText[ i ], reference, length + 1 );
+        mSmallLength[ i ] = U8( length );
+    }
+    mSmallCount = small_count;
+
+    if( mMask < 256 && mSmallCount == mMask + 1 )
+        return;
+
+    std::vector<U64> probes;
+    probes.push_back( 0 );
+    probes.push_back( 1 );
+    probes.push_back( 256 & mMask );
+    probes.push_back( mMask );
+    probes.push_back( mMask >> 1 );
+    probes.push_back( 0x5555555555555555ull & mMask );
+    probes.push_back( 0xAAAAAAAAAAAAAAAAull & mMask );
+    for( U64 i = 0; i < 64; i++ )
+        probes.push_back( SplitMix64( i ) & mMask );
+
+    for( size_t i = 0; i < probes.size(); i++ )
+    {
+        if( probes[ i ] < mSmallCount )
+            continue;
+
+        char fast[ kMaxLength ];
+        fast[ FormatFast( probes[ i ], fast ) ] = '\0';
+
+        char reference[ kMaxLength ];
+        AnalyzerHelpers::GetNumberString( probes[ i ], display_base, num_data_bits, reference, kMaxLength );
+        if( strcmp( fast, reference ) != 0 )
+            return;
+    }
+
+    mUseFastPath = true;
+}
+
+size_t SpiNumberFormatter::Format( U64 value, char* out ) const
+{
+    // values wider than the word go to the SDK, whatever it makes of them.
+    if( ( value & ~mMask ) == 0 )
+    {
+        if( value < mSmallCount )
+        {
+            memcpy( out, mSmallText[ value ], mSmallLength[ value ] + 1 );
+            return mSmallLength[ value ];
+        }
+
+        if( mUseFastPath )
+        {
+            size_t length = FormatFast( value, out );
+            out[ length ] = '\0';
+            return length;
+        }
+    }
+
+    AnalyzerHelpers::GetNumberString( value, mDisplayBase, mNumDataBits, out, kMaxLength );
+    return strlen( out );
+}
+
+size_t SpiNumberFormatter::FormatFast( U64 value, char* out ) const
+{
+    const U32 hex_digits = ( mNumDataBits + 3 ) / 4;
+    char* p = out;
+
+    switch( mDisplayBase )
+    {
+    case Decimal:
+        p += SpiFormatDecimal( value, p );
+        break;
+    case Hexadecimal:
+        *p++ = '0';
+        *p++ = 'x';
+        WriteHex( value, hex_digits, p );
+        p += hex_digits;
+        break;
+    case Binary:
+        *p++ = '0';
+        *p++ = 'b';
+        WriteBinary( value, mNumDataBits, p );
+        p += mNumDataBits;
+        break;
+    case ASCII:
+    case AsciiHex:
+        *p++ = '\'';
+        p += SpiFormatDecimal( value, p );
+        *p++ = '\'';
+        if( mDisplayBase == AsciiHex )
+        {
+            memcpy( p, " (0x", 4 );
+            p += 4;
+            WriteHex( value, hex_digits, p );
+            p += hex_digits;
+            *p++ = ')';
+        }
+        break;
+    default:
+        break; // an empty string, which never matches the SDK
+    }
+
+    return p - out;
+}
@@ -0,0 +1,73 @@
+#ifndef SPI_EXPORT_FORMAT_H
+#define SPI_EXPORT_FORMAT_H
+
+#include <AnalyzerTypes.h>
+#include <cstddef>
+
+// Formatters for exports and views with millions of rows. Each one produces exactly what the matching AnalyzerHelpers function does:
+// Setup() compares the fast path with the SDK on a set of probe values and uses the SDK for everything if any of them differ.
+
+// Like AnalyzerHelpers::GetTimeString().
+class SpiTimeFormatter
+{
+  public:
+    // longest string Format() writes, including the terminator
+    static const size_t kMaxLength = 128;
+
+    SpiTimeFormatter();
+
+    // probe_samples are extra samples to check, typically taken from the data being exported.
+    void Setup( U64 trigger_sample, U32 sample_rate, const U64* probe_samples, size_t probe_count );
+
+    // returns the length, not counting the terminator.
+    size_t Format( U64 sample, char* out ) const;
+
+  protected:
+    // false if the exact decimal value might round differently from the SDK's double precision arithmetic
+    bool FormatFast( U64 sample, char* out, size_t& length ) const;
+    bool Matches( U64 sample ) const;
+
+    U64 mTriggerSample;
+    U32 mSampleRate;
+    bool mUseFastPath;
+    U32 mDecimals;
+    U64 mDecimalScale;
+};
+
+// Like AnalyzerHelpers::GetNumberString(), for one display base and word size. Values below 256 come from a table of the SDK's own
+// strings; larger ones are built from byte lookup tables. Format() never allocates.
+class SpiNumberFormatter
+{
+  public:
+    static const size_t kMaxLength = 128;
+
+    SpiNumberFormatter();
+
+    void Setup( DisplayBase display_base, U32 num_data_bits );
+    bool IsSetUpFor( DisplayBase display_base, U32 num_data_bits ) const
+    {
+        return mIsSetUp && mDisplayBase == display_base && mNumDataBits == num_data_bits;
+    }
+
+    size_t Format( U64 value, char* out ) const;
+
+  protected:
+    // longest table entry, including the terminator
+    static const size_t kSmallEntryLength = 24;
+
+    size_t FormatFast( U64 value, char* out ) const;
+
+    DisplayBase mDisplayBase;
+    U32 mNumDataBits;
+    U64 mMask;
+    bool mIsSetUp;
+    bool mUseFastPath;
+    U32 mSmallCount;
+    char mSmallText[ 256 ][ kSmallEntryLength ];
+    U8 mSmallLength[ 256 ];
+};
+
+// Plain decimal, as std::ostream writes an unsigned number. Returns the length; writes no terminator.
+size_t SpiFormatDecimal( U64 value, char* out );
+
+#endif // SPI_EXPORT_FORMAT_H
@@ -0,0 +1,152 @@
+#ifndef SPI_FRAME_FILE_H
+#define SPI_FRAME_FILE_H
+
+// The binary frame export: a fixed 64 byte header, then one column per frame field. Everything is little-endian, and every column
+// starts on an 8 byte boundary, so the file can be memory-mapped and the columns used in place.
+//
+//   offset  size  field
+//        0     8  magic, "SPIFRAME"
+//        8     4  version, 1
+//       12     4  header size in bytes, 64
+//       16     8  frame count, N
+//       24     8  trigger sample
+//       32     4  sample rate, Hz
+//       36     4  bits per transfer
+//       40     4  channels: bit 0 set if MOSI was decoded, bit 1 if MISO was
+//       44     4  data lanes: 1 for standard SPI, 2 for dual I/O, 4 for quad I/O; 0 in older files, meaning 1
+//       48    16  reserved, zero
+//
+// followed by the columns, in this order:
+//
+//   start sample   N x u64   first sample of the frame
+//   end sample     N x u64   last sample of the frame, inclusive
+//   mosi           N x u64
+//   miso           N x u64
+//   packet id      N x u64   all ones for a frame outside any packet
+//   flags          N x u8    bit 0: the frame is an error (clock polarity doesn't match the settings), not data
+//                            bit 1: the word was read across all the dual or quad I/O lanes; it is in the mosi column
+//                            bits 2-4: the slave the frame belongs to, with several chip selects on the bus; 0 otherwise
+//                            bit 5: the frame stands for copies of the enable window before it, collapsed; how many are in the
+//                            mosi column, and the words in each in the miso column
+//
+// This header has no dependencies, so readers outside the analyzer can include it.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+struct SpiFrameFileHeader
+{
+    char mMagic[ 8 ];
+    uint32_t mVersion;
+    uint32_t mHeaderSize;
+    uint64_t mFrameCount;
+    uint64_t mTriggerSample;
+    uint32_t mSampleRate;
+    uint32_t mBitsPerTransfer;
+    uint32_t mChannels;
+    uint32_t mDataLanes;
+    uint8_t mReserved[ 16 ];
+};
+
+static_assert( sizeof( SpiFrameFileHeader ) == 64, "SpiFrameFileHeader must match the file layout" );
+
+const char kSpiFrameFileMagic[ 8 ] = { 'S', 'P', 'I', 'F', 'R', 'A', 'M', 'E' };
+const uint32_t kSpiFrameFileVersion = 1;
+const uint32_t kSpiFrameFileMosiUsed = 1 << 0;
+const uint32_t kSpiFrameFileMisoUsed = 1 << 1;
+const uint8_t kSpiFrameFileErrorFlag = 1 << 0;
+const uint8_t kSpiFrameFileWideWordFlag = 1 << 1;
+const uint8_t kSpiFrameFileSlaveShift = 2;
+const uint8_t kSpiFrameFileSlaveMask = 7 << kSpiFrameFileSlaveShift;
+const uint8_t kSpiFrameFileRepeatFlag = 1 << 5;
+const uint64_t kSpiFrameFileNoPacket = ~uint64_t( 0 );
+const uint64_t kSpiFrameFileBytesPerFrame = 5 * sizeof( uint64_t ) + sizeof( uint8_t );
+
+// Finds the columns of a frame file that is already in memory (read or memory-mapped). The data must be 8 byte aligned, as mappings
+// and heap blocks are.
+class SpiFrameFileView
+{
+  public:
+    SpiFrameFileView()
+        : mHeader( NULL ), mStartSamples( NULL ), mEndSamples( NULL ), mMosi( NULL ), mMiso( NULL ), mPacketIds( NULL ), mFlags( NULL )
+    {
+    }
+
+    // returns false if the data isn't a complete frame file of a version this header knows.
+    bool Open( const void* data, size_t size )
+    {
+        if( size < sizeof( SpiFrameFileHeader ) )
+            return false;
+
+        const SpiFrameFileHeader* header = static_cast<const SpiFrameFileHeader*>( data );
+        if( memcmp( header->mMagic, kSpiFrameFileMagic, sizeof( kSpiFrameFileMagic ) ) != 0 || header->mVersion != kSpiFrameFileVersion ||
+            header->mHeaderSize != sizeof( SpiFrameFileHeader ) )
+            return false;
+
+        const uint64_t count = header->mFrameCount;
+        if( count > ( size - sizeof( SpiFrameFileHeader ) ) / kSpiFrameFileBytesPerFrame )
+            return false;
+
+        const uint64_t* columns = reinterpret_cast<const uint64_t*>( header + 1 );
+        mHeader = header;
+        mStartSamples = columns;
+        mEndSamples = columns + count;
+        mMosi = columns + 2 * count;
+        mMiso = columns + 3 * count;
+        mPacketIds = columns + 4 * count;
+        mFlags = reinterpret_cast<const uint8_t*>( columns + 5 * count );
+        return true;
+    }
+
+    const SpiFrameFileHeader& Header() const
+    {
+        return *mHeader;
+    }
+
+    uint64_t FrameCount() const
+    {
+        return mHeader->mFrameCount;
+    }
+
+    const uint64_t* StartSamples() const
+    {
+        return mStartSamples;
+    }
+
+    const uint64_t* EndSamples() const
+    {
+        return mEndSamples;
+    }
+
+    const uint64_t* Mosi() const
+    {
+        return mMosi;
+    }
+
+    const uint64_t* Miso() const
+    {
+        return mMiso;
+    }
+
+    const uint64_t* PacketIds() const
+    {
+        return mPacketIds;
+    }
+
+    const uint8_t* Flags() const
+    {
+        return mFlags;
+    }
+
+  protected:
+    const SpiFrameFileHeader* mHeader;
+    const uint64_t* mStartSamples;
+    const uint64_t* mEndSamples;
+    const uint64_t* mMosi;
+    const uint64_t* mMiso;
+    const uint64_t* mPacketIds;
+    const uint8_t* mFlags;
+};
+
+#endif // SPI_FRAME_FILE_H
@@ -0,0 +1,59 @@
+#include "SpiLatencyHistogram.h"
+
+#include <algorithm>
+
+const uint32_t SpiLatencyHistogram::kBuckets;
+
+SpiLatencyHistogram::SpiLatencyHistogram()
+{
+    Clear();
+}
+
+void SpiLatencyHistogram::Clear()
+{
+    std::fill( mBuckets, mBuckets + kBuckets, uint64_t( 0 ) );
+    mCount = 0;
+    mMax = 0;
+}
+
+void SpiLatencyHistogram::Add( uint64_t latency_us )
+{
+    uint32_t bucket = 0;
+    while( bucket < kBuckets - 1 && ( latency_us >> bucket ) != 0 )
+        bucket++;
+
+    mBuckets[ bucket ]++;
+    mCount++;
+    mMax = std::max( mMax, latency_us );
+}
+
+uint64_t SpiLatencyHistogram::GetCount() const
+{
+    return mCount;
+}
+
+uint64_t SpiLatencyHistogram::GetMax() const
+{
+    return mMax;
+}
+
+uint64_t SpiLatencyHistogram::GetBucketCount( uint32_t bucket ) const
+{
+    return bucket < kBuckets ? mBuckets[ bucket ] : 0;
+}
+
+uint64_t SpiLatencyHistogram::GetPercentile( double fraction ) const
+{
+    if( mCount == 0 )
+        return 0;
+
+    const double wanted = fraction * double( mCount );
+    uint64_t counted = 0;
+    for( uint32_t bucket = 0; bucket < kBuckets - 1; bucket++ )
+    {
+        counted += mBuckets[ bucket ];
+        if( double( counted ) >= wanted )
+            return std::min( ( uint64_t( 1 ) << bucket ), mMax );
+    }
+    return mMax;
+}
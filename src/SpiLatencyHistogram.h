@@ -0,0 +1,32 @@
+#ifndef SPI_LATENCY_HISTOGRAM_H
+#define SPI_LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+
+// Counts latencies in microseconds, in power-of-two buckets: cheap enough to record for every frame, and percentiles stay within a
+// factor of two of the true value at any scale.
+class SpiLatencyHistogram
+{
+  public:
+    // bucket 0 counts latencies under 1 us, bucket i those from 2^( i - 1 ) up to 2^i us; the last one everything longer.
+    static const uint32_t kBuckets = 40;
+
+    SpiLatencyHistogram();
+
+    void Clear();
+    void Add( uint64_t latency_us );
+
+    uint64_t GetCount() const;
+    uint64_t GetMax() const;
+    uint64_t GetBucketCount( uint32_t bucket ) const;
+    // the upper bound of the bucket that holds the latency below which fraction ( 0 to 1 ) of the latencies fall, capped at the
+    // longest latency recorded. 0 when nothing has been recorded.
+    uint64_t GetPercentile( double fraction ) const;
+
+  protected:
+    uint64_t mBuckets[ kBuckets ];
+    uint64_t mCount;
+    uint64_t mMax;
+};
+
+#endif // SPI_LATENCY_HISTOGRAM_H
@@ -0,0 +1,127 @@
+#ifndef SPI_LRU_CACHE_H
+#define SPI_LRU_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// A fixed number of values, looked up by key, that drops the least recently used value to make room for a new one. The entries are
+// allocated up front and linked into a recency list by index. Not thread safe.
+template <typename Key, typename Value>
+class SpiLruCache
+{
+  public:
+    explicit SpiLruCache( size_t capacity )
+        : mEntries( capacity > 0 ? capacity : 1 ), mUsed( 0 ), mNewest( kNone ), mOldest( kNone ), mHits( 0 ), mMisses( 0 )
+    {
+        mIndex.reserve( mEntries.size() );
+    }
+
+    // NULL if the key isn't cached. A hit makes the value the most recently used.
+    const Value* Find( const Key& key )
+    {
+        typename std::unordered_map<Key, size_t>::const_iterator found = mIndex.find( key );
+        if( found == mIndex.end() )
+        {
+            mMisses++;
+            return NULL;
+        }
+
+        mHits++;
+        Unlink( found->second );
+        PushNewest( found->second );
+        return &mEntries[ found->second ].mValue;
+    }
+
+    // the value to fill in for a key that Find() just missed, evicting the least recently used value if the cache is full.
+    Value& Insert( const Key& key )
+    {
+        size_t entry;
+        if( mUsed < mEntries.size() )
+        {
+            entry = mUsed++;
+        }
+        else
+        {
+            entry = mOldest;
+            Unlink( entry );
+            mIndex.erase( mEntries[ entry ].mKey );
+        }
+
+        mEntries[ entry ].mKey = key;
+        mIndex[ key ] = entry;
+        PushNewest( entry );
+        return mEntries[ entry ].mValue;
+    }
+
+    // drops every value; the counters keep counting.
+    void Clear()
+    {
+        mIndex.clear();
+        mUsed = 0;
+        mNewest = kNone;
+        mOldest = kNone;
+    }
+
+    size_t Size() const
+    {
+        return mUsed;
+    }
+
+    uint64_t Hits() const
+    {
+        return mHits;
+    }
+
+    uint64_t Misses() const
+    {
+        return mMisses;
+    }
+
+  protected:
+    static const size_t kNone = ~size_t( 0 );
+
+    struct Entry
+    {
+        Key mKey;
+        size_t mNewer;
+        size_t mOlder;
+        Value mValue;
+    };
+
+    void Unlink( size_t entry )
+    {
+        Entry& e = mEntries[ entry ];
+        if( e.mNewer != kNone )
+            mEntries[ e.mNewer ].mOlder = e.mOlder;
+        else
+            mNewest = e.mOlder;
+        if( e.mOlder != kNone )
+            mEntries[ e.mOlder ].mNewer = e.mNewer;
+        else
+            mOldest = e.mNewer;
+    }
+
+    void PushNewest( size_t entry )
+    {
+        Entry& e = mEntries[ entry ];
+        e.mNewer = kNone;
+        e.mOlder = mNewest;
+        if( mNewest != kNone )
+            mEntries[ mNewest ].mNewer = entry;
+        else
+            mOldest = entry;
+        mNewest = entry;
+    }
+
+    std::vector<Entry> mEntries;
+    std::unordered_map<Key, size_t> mIndex;
+    size_t mUsed;
+    size_t mNewest;
+    size_t mOldest;
+    uint64_t mHits;
+    uint64_t mMisses;
+};
+
+#endif // SPI_LRU_CACHE_H
@@ -0,0 +1,370 @@
+#include "SpiParallelDecoder.h"
+#include "SpiChipSelectMux.h"
+#include "SpiTransitionStream.h"
+#include "SpiWorkStealingPool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+namespace
+{
+    // The enable line of one chunk: the chunk ends when the decoder moves on to the enable edge where the next chunk starts.
+    class ChunkEnableStream : public SpiTransitionStream
+    {
+      public:
+        ChunkEnableStream() : mStopSample( UINT64_MAX )
+        {
+        }
+
+        void SetStopSample( uint64_t stop_sample )
+        {
+            mStopSample = stop_sample;
+        }
+
+        virtual void AdvanceToNextEdge()
+        {
+            if( mNextEdge < mEdgeCount && mEdges[ mNextEdge ] >= mStopSample )
+                throw SpiEndOfStream();
+            SpiTransitionStream::AdvanceToNextEdge();
+        }
+
+      protected:
+        uint64_t mStopSample;
+    };
+
+    // The same, for the combined line of several chip selects.
+    class ChunkChipSelectMux : public SpiChipSelectMux
+    {
+      public:
+        ChunkChipSelectMux() : mStopSample( UINT64_MAX )
+        {
+        }
+
+        void SetStopSample( uint64_t stop_sample )
+        {
+            mStopSample = stop_sample;
+        }
+
+        virtual void AdvanceToNextEdge()
+        {
+            if( GetSampleOfNextEdge() >= mStopSample )
+                throw SpiEndOfStream();
+            SpiChipSelectMux::AdvanceToNextEdge();
+        }
+
+      protected:
+        uint64_t mStopSample;
+    };
+
+    // A single run reports a packet boundary just before it looks for the next active enable edge, and the chunk before has already
+    // reported that one. Chip select overlaps on the edge the next chunk starts at are reported by that chunk.
+    class ChunkSink : public SpiDecoderSink
+    {
+      public:
+        ChunkSink( SpiDecoderSink* sink, bool skip_first_packet_boundary, uint64_t stop_sample )
+            : mSink( sink ), mSkipPacketBoundary( skip_first_packet_boundary ), mStopSample( stop_sample )
+        {
+        }
+
+        virtual void OnPacketBoundary()
+        {
+            if( mSkipPacketBoundary )
+                mSkipPacketBoundary = false;
+            else
+                mSink->OnPacketBoundary();
+        }
+
+        virtual void OnEnable( uint64_t sample, uint32_t slave )
+        {
+            mSink->OnEnable( sample, slave );
+        }
+
+        virtual void OnDisable( uint64_t sample, uint32_t slave )
+        {
+            mSink->OnDisable( sample, slave );
+        }
+
+        virtual void OnClockPolarityError( uint64_t sample )
+        {
+            mSink->OnClockPolarityError( sample );
+        }
+
+        virtual void OnErrorFrame( uint64_t starting_sample, uint64_t ending_sample, uint32_t slave )
+        {
+            mSink->OnErrorFrame( starting_sample, ending_sample, slave );
+        }
+
+        virtual void OnWord( const SpiWord& word )
+        {
+            mSink->OnWord( word );
+        }
+
+        virtual void OnChipSelectOverlap( uint64_t sample, uint32_t slave )
+        {
+            if( sample < mStopSample )
+                mSink->OnChipSelectOverlap( sample, slave );
+        }
+
+        virtual void OnProgress( uint64_t sample )
+        {
+            mSink->OnProgress( sample );
+        }
+
+        virtual void PollForExit()
+        {
+            mSink->PollForExit();
+        }
+
+      protected:
+        SpiDecoderSink* mSink;
+        bool mSkipPacketBoundary;
+        uint64_t mStopSample;
+    };
+
+    size_t EdgesBefore( const std::vector<uint64_t>& edges, uint64_t sample )
+    {
+        return std::lower_bound( edges.begin(), edges.end(), sample ) - edges.begin();
+    }
+}
+
+SpiCaptureChannel::SpiCaptureChannel() : mInitialState( false ), mEdges( NULL )
+{
+}
+
+SpiParallelDecoder::SpiParallelDecoder()
+    : mLastSample( 0 ), mRangeSet( false ), mRangeFirstSample( 0 ), mRangeLastSample( 0 ), mStopSample( UINT64_MAX )
+{
+}
+
+SpiParallelDecoder::~SpiParallelDecoder()
+{
+}
+
+void SpiParallelDecoder::Setup( const SpiDecoderSettings& settings, const SpiCaptureChannel& clock, const SpiCaptureChannel& mosi,
+                                const SpiCaptureChannel& miso, const SpiCaptureChannel& enable, uint64_t last_sample )
+{
+    mSettings = settings;
+    mClock = clock;
+    mMosi = mosi;
+    mMiso = miso;
+    mEnable = enable;
+    mIo2 = SpiCaptureChannel();
+    mIo3 = SpiCaptureChannel();
+    mChipSelects.clear();
+    mLastSample = last_sample;
+    mRangeSet = false;
+}
+
+void SpiParallelDecoder::SetupWideLanes( const SpiCaptureChannel& io2, const SpiCaptureChannel& io3 )
+{
+    mIo2 = io2;
+    mIo3 = io3;
+}
+
+void SpiParallelDecoder::SetupChipSelects( const SpiCaptureChannel* chip_selects, uint32_t count )
+{
+    mChipSelects.assign( chip_selects, chip_selects + count );
+}
+
+void SpiParallelDecoder::SetupRange( uint64_t first_sample, uint64_t last_sample )
+{
+    mRangeSet = true;
+    mRangeFirstSample = first_sample;
+    mRangeLastSample = last_sample;
+}
+
+void SpiParallelDecoder::FindActiveEnableEdges( std::vector<uint64_t>& active_edges )
+{
+    active_edges.clear();
+
+    if( mChipSelects.empty() )
+    {
+        // active-going edges alternate with inactive-going ones, starting with the first edge when the line starts out inactive.
+        const std::vector<uint64_t>& enable_edges = *mEnable.mEdges;
+        size_t first_active_edge = ( mEnable.mInitialState == mSettings.mEnableActiveState ) ? 1 : 0;
+        for( size_t i = first_active_edge; i < enable_edges.size(); i += 2 )
+            active_edges.push_back( enable_edges[ i ] );
+        return;
+    }
+
+    // only the chip select lines are read, so walking the combined line is cheap next to decoding.
+    std::vector<SpiTransitionStream> lines( mChipSelects.size() );
+    std::vector<SpiEdgeStream*> streams( mChipSelects.size(), NULL );
+    for( size_t i = 0; i < mChipSelects.size(); i++ )
+    {
+        if( mChipSelects[ i ].mEdges == NULL )
+            continue;
+        lines[ i ].Setup( mChipSelects[ i ].mInitialState, mChipSelects[ i ].mEdges, mLastSample );
+        streams[ i ] = &lines[ i ];
+    }
+
+    SpiChipSelectMux combined;
+    combined.Setup( streams.data(), uint32_t( streams.size() ), mSettings.mEnableActiveState, NULL );
+    try
+    {
+        for( ;; )
+        {
+            combined.AdvanceToNextEdge();
+            if( combined.GetBitState() == mSettings.mEnableActiveState )
+                active_edges.push_back( combined.GetSampleNumber() );
+        }
+    }
+    catch( SpiEndOfStream& )
+    {
+    }
+}
+
+void SpiParallelDecoder::PlanChunks( uint32_t thread_count, uint64_t min_chunk_clock_edges )
+{
+    mChunkStarts.clear();
+    mChunkStarts.push_back( 0 );
+    mStopSample = UINT64_MAX;
+
+    if( ( mEnable.mEdges == NULL && mChipSelects.empty() ) || ( thread_count < 2 && mRangeSet == false ) )
+        return;
+
+    std::vector<uint64_t> active_edges;
+    FindActiveEnableEdges( active_edges );
+
+    if( mRangeSet )
+    {
+        // the window open at the first sample starts at the last active-going edge at or before it; the one after the last sample
+        // starts at the first active-going edge past it.
+        std::vector<uint64_t>::iterator first = std::upper_bound( active_edges.begin(), active_edges.end(), mRangeFirstSample );
+        std::vector<uint64_t>::iterator stop = std::upper_bound( first, active_edges.end(), mRangeLastSample );
+        if( first != active_edges.begin() )
+            mChunkStarts[ 0 ] = *( first - 1 );
+        if( stop != active_edges.end() )
+            mStopSample = *stop;
+        active_edges.assign( first, stop );
+    }
+
+    if( thread_count < 2 )
+        return;
+
+    // a few chunks per thread, so threads that finish early have something to steal.
+    const std::vector<uint64_t>& clock_edges = *mClock.mEdges;
+    size_t chunk_first_clock_edge = EdgesBefore( clock_edges, mChunkStarts[ 0 ] );
+    const uint64_t decoded_clock_edges = EdgesBefore( clock_edges, mStopSample ) - chunk_first_clock_edge;
+    uint64_t chunk_clock_edges = std::max<uint64_t>( min_chunk_clock_edges, decoded_clock_edges / ( uint64_t( thread_count ) * 8 ) );
+
+    for( size_t i = 0; i < active_edges.size(); i++ )
+    {
+        size_t clock_edge = EdgesBefore( clock_edges, active_edges[ i ] );
+        if( clock_edge - chunk_first_clock_edge >= chunk_clock_edges )
+        {
+            mChunkStarts.push_back( active_edges[ i ] );
+            chunk_first_clock_edge = clock_edge;
+        }
+    }
+}
+
+size_t SpiParallelDecoder::Run( uint32_t thread_count, uint64_t min_chunk_clock_edges, Output* output )
+{
+    PlanChunks( thread_count, min_chunk_clock_edges );
+    const size_t chunk_count = mChunkStarts.size();
+
+    std::mutex mutex;
+    std::condition_variable chunk_done;
+    std::vector<SpiDecoderSink*> sinks( chunk_count, NULL );
+    std::vector<bool> done( chunk_count, false );
+
+    SpiWorkStealingPool pool;
+    pool.Start( uint32_t( std::min<size_t>( thread_count, chunk_count ) ), chunk_count, [&]( size_t chunk ) {
+        SpiDecoderSink* sink = output->BeginChunk( chunk );
+        DecodeChunk( chunk, sink );
+
+        std::lock_guard<std::mutex> lock( mutex );
+        sinks[ chunk ] = sink;
+        done[ chunk ] = true;
+        chunk_done.notify_all();
+    } );
+
+    for( size_t chunk = 0; chunk < chunk_count; chunk++ )
+    {
+        SpiDecoderSink* sink;
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            while( done[ chunk ] == false )
+                chunk_done.wait( lock );
+            sink = sinks[ chunk ];
+        }
+        output->EndChunk( chunk, sink );
+    }
+
+    pool.Wait();
+    return chunk_count;
+}
+
+void SpiParallelDecoder::DecodeChunk( size_t chunk, SpiDecoderSink* sink )
+{
+    SpiTransitionStream clock, mosi, miso, io2, io3;
+    ChunkEnableStream enable;
+    clock.Setup( mClock.mInitialState, mClock.mEdges, mLastSample );
+    if( mMosi.mEdges != NULL )
+        mosi.Setup( mMosi.mInitialState, mMosi.mEdges, mLastSample );
+    if( mMiso.mEdges != NULL )
+        miso.Setup( mMiso.mInitialState, mMiso.mEdges, mLastSample );
+    if( mEnable.mEdges != NULL )
+        enable.Setup( mEnable.mInitialState, mEnable.mEdges, mLastSample );
+    if( mIo2.mEdges != NULL )
+        io2.Setup( mIo2.mInitialState, mIo2.mEdges, mLastSample );
+    if( mIo3.mEdges != NULL )
+        io3.Setup( mIo3.mInitialState, mIo3.mEdges, mLastSample );
+    std::vector<SpiTransitionStream> chip_selects( mChipSelects.size() );
+    for( size_t i = 0; i < mChipSelects.size(); i++ )
+    {
+        if( mChipSelects[ i ].mEdges != NULL )
+            chip_selects[ i ].Setup( mChipSelects[ i ].mInitialState, mChipSelects[ i ].mEdges, mLastSample );
+    }
+
+    // a chunk starts one sample before its active-going enable edge, where the enable line is inactive, so the decoder's search for
+    // the next active edge lands on it.
+    if( mChunkStarts[ chunk ] > 0 )
+    {
+        uint64_t start = mChunkStarts[ chunk ] - 1;
+        clock.Seek( start );
+        mosi.Seek( start );
+        miso.Seek( start );
+        enable.Seek( start );
+        io2.Seek( start );
+        io3.Seek( start );
+        for( size_t i = 0; i < chip_selects.size(); i++ )
+            chip_selects[ i ].Seek( start );
+    }
+    const uint64_t stop_sample = chunk + 1 < mChunkStarts.size() ? mChunkStarts[ chunk + 1 ] : mStopSample;
+    enable.SetStopSample( stop_sample );
+
+    ChunkSink chunk_sink( sink, chunk > 0, stop_sample );
+
+    std::vector<SpiEdgeStream*> chip_select_streams( mChipSelects.size(), NULL );
+    for( size_t i = 0; i < mChipSelects.size(); i++ )
+    {
+        if( mChipSelects[ i ].mEdges != NULL )
+            chip_select_streams[ i ] = &chip_selects[ i ];
+    }
+    ChunkChipSelectMux combined;
+    combined.Setup( chip_select_streams.data(), uint32_t( chip_select_streams.size() ), mSettings.mEnableActiveState, &chunk_sink );
+    combined.SetStopSample( stop_sample );
+
+    SpiEdgeStream* enable_stream = NULL;
+    if( mChipSelects.empty() == false )
+        enable_stream = &combined;
+    else if( mEnable.mEdges != NULL )
+        enable_stream = &enable;
+
+    SpiDecoder decoder;
+    decoder.Setup( mSettings, &clock, mMosi.mEdges != NULL ? &mosi : NULL, mMiso.mEdges != NULL ? &miso : NULL, enable_stream,
+                   &chunk_sink );
+    decoder.SetupWideLanes( mIo2.mEdges != NULL ? &io2 : NULL, mIo3.mEdges != NULL ? &io3 : NULL );
+    if( mChipSelects.empty() == false )
+        decoder.SetupChipSelects( &combined );
+    try
+    {
+        decoder.Run();
+    }
+    catch( SpiEndOfStream& )
+    {
+    }
+}
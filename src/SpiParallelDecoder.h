@@ -0,0 +1,83 @@
+#ifndef SPI_PARALLEL_DECODER_H
+#define SPI_PARALLEL_DECODER_H
+
+#include "SpiDecoder.h"
+
+#include <cstddef>
+#include <vector>
+
+// A channel of a complete capture, as given to SpiTransitionStream.
+struct SpiCaptureChannel
+{
+    SpiCaptureChannel();
+
+    bool mInitialState;
+    const std::vector<uint64_t>* mEdges; // NULL when the channel isn't in use
+};
+
+// Decodes a complete capture on several threads. The capture is cut just before active-going enable edges, where SpiDecoder is in
+// the same state no matter what came before, so the chunks can be decoded independently; joined in order, their events are exactly
+// what a single SpiDecoder run produces. Without an enable channel there is nowhere to cut, and the capture is decoded in one piece.
+//
+// The same edges are checkpoints for decoding part of a capture again: SetupRange() decodes only the enable windows around a range of
+// samples, with exactly the events a run over the whole capture has for them.
+class SpiParallelDecoder
+{
+  public:
+    // Provides a sink for each chunk, and collects them back in capture order.
+    class Output
+    {
+      public:
+        virtual ~Output()
+        {
+        }
+
+        // called on a worker thread. PollForExit() on the returned sink must not throw.
+        virtual SpiDecoderSink* BeginChunk( size_t chunk ) = 0;
+        // called on the thread that called Run(), once per chunk, in capture order.
+        virtual void EndChunk( size_t chunk, SpiDecoderSink* sink ) = 0;
+    };
+
+    SpiParallelDecoder();
+    ~SpiParallelDecoder();
+
+    void Setup( const SpiDecoderSettings& settings, const SpiCaptureChannel& clock, const SpiCaptureChannel& mosi,
+                const SpiCaptureChannel& miso, const SpiCaptureChannel& enable, uint64_t last_sample );
+    // dual and quad I/O, as SpiDecoder::SetupWideLanes(). Call after Setup().
+    void SetupWideLanes( const SpiCaptureChannel& io2, const SpiCaptureChannel& io3 );
+    // several chip selects, as SpiChipSelectMux: the enable line of each slave, used instead of the enable channel given to Setup().
+    // Call after Setup().
+    void SetupChipSelects( const SpiCaptureChannel* chip_selects, uint32_t count );
+    // decode from the last active-going enable edge at or before first_sample, up to the first one after last_sample, instead of the
+    // whole capture. Needs an enable channel. Call after Setup().
+    void SetupRange( uint64_t first_sample, uint64_t last_sample );
+
+    // min_chunk_clock_edges keeps chunks big enough to be worth handing to a thread. Returns the number of chunks.
+    size_t Run( uint32_t thread_count, uint64_t min_chunk_clock_edges, Output* output );
+
+  protected:
+    void PlanChunks( uint32_t thread_count, uint64_t min_chunk_clock_edges );
+    // where the enable line (or any chip select, with several) goes active
+    void FindActiveEnableEdges( std::vector<uint64_t>& active_edges );
+    void DecodeChunk( size_t chunk, SpiDecoderSink* sink );
+
+    SpiDecoderSettings mSettings;
+    SpiCaptureChannel mClock;
+    SpiCaptureChannel mMosi;
+    SpiCaptureChannel mMiso;
+    SpiCaptureChannel mEnable;
+    SpiCaptureChannel mIo2;
+    SpiCaptureChannel mIo3;
+    std::vector<SpiCaptureChannel> mChipSelects;
+    uint64_t mLastSample;
+    bool mRangeSet;
+    uint64_t mRangeFirstSample;
+    uint64_t mRangeLastSample;
+
+    // the active-going enable edge each chunk starts at; 0 for a chunk at the start of the capture
+    std::vector<uint64_t> mChunkStarts;
+    // where the last chunk ends
+    uint64_t mStopSample;
+};
+
+#endif // SPI_PARALLEL_DECODER_H
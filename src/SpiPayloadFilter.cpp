@@ -0,0 +1,307 @@
+#include "SpiPayloadFilter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    // a hex digit's value, -1 for a wildcard and -2 for anything else
+    int NibbleValue( char c )
+    {
+        if( c >= '0' && c <= '9' )
+            return c - '0';
+        if( c >= 'a' && c <= 'f' )
+            return c - 'a' + 10;
+        if( c >= 'A' && c <= 'F' )
+            return c - 'A' + 10;
+        if( c == 'x' || c == 'X' || c == '?' )
+            return -1;
+        return -2;
+    }
+
+    // two hex digits; with mask, either may be a wildcard
+    bool ParseByte( const std::string& text, uint8_t& value, uint8_t* mask )
+    {
+        if( text.size() != 2 )
+            return false;
+
+        value = 0;
+        if( mask != NULL )
+            *mask = 0;
+        for( size_t i = 0; i < 2; i++ )
+        {
+            const int nibble = NibbleValue( text[ i ] );
+            if( nibble == -2 || ( nibble == -1 && mask == NULL ) )
+                return false;
+            value = uint8_t( value << 4 );
+            if( mask != NULL )
+                *mask = uint8_t( *mask << 4 );
+            if( nibble >= 0 )
+            {
+                value |= uint8_t( nibble );
+                if( mask != NULL )
+                    *mask |= 0xF;
+            }
+        }
+        return true;
+    }
+
+    bool ParsePattern( std::string text, SpiPayloadFilter::Pattern& pattern )
+    {
+        pattern.mMiso = false;
+        pattern.mValues.clear();
+        pattern.mMasks.clear();
+
+        const size_t first = text.find_first_not_of( " \t" );
+        if( first != std::string::npos && text.size() - first >= 5 && text[ first + 4 ] == ':' )
+        {
+            std::string channel = text.substr( first, 4 );
+            std::transform( channel.begin(), channel.end(), channel.begin(), ::tolower );
+            if( channel != "mosi" && channel != "miso" )
+                return false;
+            pattern.mMiso = channel == "miso";
+            text = text.substr( first + 5 );
+        }
+
+        std::istringstream tokens( text );
+        std::string token;
+        while( tokens >> token )
+        {
+            if( token.size() > 2 && token[ 0 ] == '0' && ( token[ 1 ] == 'x' || token[ 1 ] == 'X' ) )
+                token = token.substr( 2 );
+
+            uint8_t value;
+            uint8_t mask;
+            const size_t slash = token.find( '/' );
+            if( slash == std::string::npos )
+            {
+                if( ParseByte( token, value, &mask ) == false )
+                    return false;
+            }
+            else if( ParseByte( token.substr( 0, slash ), value, NULL ) == false ||
+                     ParseByte( token.substr( slash + 1 ), mask, NULL ) == false )
+            {
+                return false;
+            }
+
+            pattern.mValues.push_back( uint8_t( value & mask ) );
+            pattern.mMasks.push_back( mask );
+        }
+
+        return pattern.mValues.empty() == false && pattern.mValues.size() <= SpiPayloadFilter::kMaxPatternBytes;
+    }
+}
+
+const size_t SpiPayloadFilter::kMaxPatternBytes;
+
+bool SpiPayloadFilter::ParsePatterns( const char* text, std::vector<Pattern>& patterns )
+{
+    patterns.clear();
+
+    const std::string list( text );
+    if( list.find_first_not_of( " \t" ) == std::string::npos )
+        return true;
+
+    size_t start = 0;
+    for( ;; )
+    {
+        const size_t end = list.find( ',', start );
+        Pattern pattern;
+        if( ParsePattern( list.substr( start, end == std::string::npos ? std::string::npos : end - start ), pattern ) == false )
+        {
+            patterns.clear();
+            return false;
+        }
+        patterns.push_back( pattern );
+
+        if( end == std::string::npos )
+            return true;
+        start = end + 1;
+    }
+}
+
+SpiPayloadFilter::SpiPayloadFilter()
+    : mSink( NULL ),
+      mBytesPerWord( 1 ),
+      mDecisionBytes( 0 ),
+      mHolding( false ),
+      mDropping( false ),
+      mWindowStart( 0 ),
+      mWindowSlave( 0 ),
+      mPassedCount( 0 ),
+      mDroppedCount( 0 ),
+      mProgressHeld( false ),
+      mProgressSample( 0 )
+{
+}
+
+SpiPayloadFilter::~SpiPayloadFilter()
+{
+}
+
+void SpiPayloadFilter::Setup( const std::vector<Pattern>& patterns, uint32_t bits_per_transfer, SpiDecoderSink* sink )
+{
+    mSink = sink;
+    mPatterns = patterns;
+    mBytesPerWord = ( bits_per_transfer + 7 ) / 8;
+    mDecisionBytes = 0;
+    for( size_t i = 0; i < mPatterns.size(); i++ )
+        mDecisionBytes = std::max( mDecisionBytes, mPatterns[ i ].mValues.size() );
+
+    mHolding = false;
+    mDropping = false;
+    mWindowWords.clear();
+    mWindowArrows.clear();
+    mMosiBytes.clear();
+    mMisoBytes.clear();
+    mPassedCount = 0;
+    mDroppedCount = 0;
+    mProgressHeld = false;
+}
+
+void SpiPayloadFilter::Finish()
+{
+    if( mHolding )
+        Decide();
+    ReleaseProgress();
+}
+
+uint64_t SpiPayloadFilter::GetPassedCount() const
+{
+    return mPassedCount;
+}
+
+uint64_t SpiPayloadFilter::GetDroppedCount() const
+{
+    return mDroppedCount;
+}
+
+void SpiPayloadFilter::OnPacketBoundary()
+{
+    mSink->OnPacketBoundary();
+}
+
+void SpiPayloadFilter::OnEnable( uint64_t sample, uint32_t slave )
+{
+    mHolding = true;
+    mDropping = false;
+    mWindowStart = sample;
+    mWindowSlave = slave;
+    mWindowWords.clear();
+    mWindowArrows.clear();
+    mMosiBytes.clear();
+    mMisoBytes.clear();
+}
+
+void SpiPayloadFilter::OnDisable( uint64_t sample, uint32_t slave )
+{
+    // a window too short for some of the patterns is checked against the rest
+    if( mHolding )
+        Decide();
+
+    if( mDropping == false )
+        mSink->OnDisable( sample, slave );
+    mDropping = false;
+    ReleaseProgress();
+}
+
+void SpiPayloadFilter::OnClockPolarityError( uint64_t sample )
+{
+    mSink->OnClockPolarityError( sample );
+}
+
+void SpiPayloadFilter::OnErrorFrame( uint64_t starting_sample, uint64_t ending_sample, uint32_t slave )
+{
+    mSink->OnErrorFrame( starting_sample, ending_sample, slave );
+}
+
+void SpiPayloadFilter::OnWord( const SpiWord& word )
+{
+    if( mDropping )
+        return;
+
+    if( mHolding == false )
+    {
+        mSink->OnWord( word );
+        return;
+    }
+
+    mWindowWords.push_back( word );
+    mWindowWords.back().mArrowLocations = NULL;
+    mWindowArrows.insert( mWindowArrows.end(), word.mArrowLocations, word.mArrowLocations + word.mArrowCount );
+    mMosiBytes.insert( mMosiBytes.end(), word.mMosiBytes, word.mMosiBytes + mBytesPerWord );
+    mMisoBytes.insert( mMisoBytes.end(), word.mMisoBytes, word.mMisoBytes + mBytesPerWord );
+
+    if( mMosiBytes.size() >= mDecisionBytes )
+    {
+        Decide();
+        ReleaseProgress();
+    }
+}
+
+void SpiPayloadFilter::OnChipSelectOverlap( uint64_t sample, uint32_t slave )
+{
+    mSink->OnChipSelectOverlap( sample, slave );
+}
+
+void SpiPayloadFilter::OnProgress( uint64_t sample )
+{
+    mProgressSample = sample;
+    mProgressHeld = true;
+    ReleaseProgress();
+}
+
+void SpiPayloadFilter::PollForExit()
+{
+    mSink->PollForExit();
+}
+
+bool SpiPayloadFilter::Matches() const
+{
+    for( size_t i = 0; i < mPatterns.size(); i++ )
+    {
+        const Pattern& pattern = mPatterns[ i ];
+        const std::vector<uint8_t>& bytes = pattern.mMiso ? mMisoBytes : mMosiBytes;
+        if( bytes.size() < pattern.mValues.size() )
+            continue;
+
+        size_t j = 0;
+        while( j < pattern.mValues.size() && ( bytes[ j ] & pattern.mMasks[ j ] ) == pattern.mValues[ j ] )
+            j++;
+        if( j == pattern.mValues.size() )
+            return true;
+    }
+    return false;
+}
+
+void SpiPayloadFilter::Decide()
+{
+    mHolding = false;
+    mDropping = Matches() == false;
+    if( mDropping )
+    {
+        mDroppedCount++;
+        return;
+    }
+
+    mPassedCount++;
+    mSink->OnEnable( mWindowStart, mWindowSlave );
+    const uint64_t* arrows = mWindowArrows.data();
+    for( size_t i = 0; i < mWindowWords.size(); i++ )
+    {
+        mWindowWords[ i ].mArrowLocations = arrows;
+        mSink->OnWord( mWindowWords[ i ] );
+        arrows += mWindowWords[ i ].mArrowCount;
+    }
+}
+
+void SpiPayloadFilter::ReleaseProgress()
+{
+    // progress can't pass a window that may still be passed on
+    if( mProgressHeld == false || mHolding )
+        return;
+    mSink->OnProgress( mProgressSample );
+    mProgressHeld = false;
+}
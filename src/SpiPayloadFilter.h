@@ -0,0 +1,82 @@
+#ifndef SPI_PAYLOAD_FILTER_H
+#define SPI_PAYLOAD_FILTER_H
+
+#include "SpiDecoder.h"
+
+#include <cstddef>
+#include <vector>
+
+// Sits between SpiDecoder and its sink, and only passes on the enable windows whose first bytes match one of a list of patterns;
+// the rest are decoded, but never reach the sink. Everything outside enable windows (errors, overlaps) is passed on as it comes.
+//
+// A window's events are held until enough of its bytes are in to tell, then passed on or dropped along with the rest of the window.
+class SpiPayloadFilter : public SpiDecoderSink
+{
+  public:
+    // the first bytes of MOSI or MISO, each compared under its mask. In dual and quad I/O the data is on MOSI.
+    struct Pattern
+    {
+        bool mMiso;
+        std::vector<uint8_t> mValues;
+        std::vector<uint8_t> mMasks;
+    };
+
+    static const size_t kMaxPatternBytes = 64;
+
+    // patterns are separated by commas, each an optional "mosi:" or "miso:" (MOSI by default) followed by bytes separated by spaces:
+    // two hex digits, either of which may be X for any nibble, or HH/MM for HH under the mask MM. "mosi: 20, mosi: D8, miso: 9F 1X"
+    // keeps transactions starting with a 0x20 or 0xD8 command, or answering 0x9F and then 0x10 to 0x1F. Returns false if text isn't
+    // a valid list; an empty text is an empty list.
+    static bool ParsePatterns( const char* text, std::vector<Pattern>& patterns );
+
+    SpiPayloadFilter();
+    ~SpiPayloadFilter();
+
+    void Setup( const std::vector<Pattern>& patterns, uint32_t bits_per_transfer, SpiDecoderSink* sink );
+    // at the end of the capture: decides on a window cut short before enough of its bytes were in.
+    void Finish();
+
+    uint64_t GetPassedCount() const;
+    uint64_t GetDroppedCount() const;
+
+    // SpiDecoderSink
+    virtual void OnPacketBoundary();
+    virtual void OnEnable( uint64_t sample, uint32_t slave );
+    virtual void OnDisable( uint64_t sample, uint32_t slave );
+    virtual void OnClockPolarityError( uint64_t sample );
+    virtual void OnErrorFrame( uint64_t starting_sample, uint64_t ending_sample, uint32_t slave );
+    virtual void OnWord( const SpiWord& word );
+    virtual void OnChipSelectOverlap( uint64_t sample, uint32_t slave );
+    virtual void OnProgress( uint64_t sample );
+    virtual void PollForExit();
+
+  protected:
+    bool Matches() const;
+    // passes on or drops the window being held
+    void Decide();
+    void ReleaseProgress();
+
+    SpiDecoderSink* mSink;
+    std::vector<Pattern> mPatterns;
+    uint32_t mBytesPerWord;
+    // bytes a window needs before every pattern can be checked
+    size_t mDecisionBytes;
+
+    bool mHolding;
+    bool mDropping;
+    uint64_t mWindowStart;
+    uint32_t mWindowSlave;
+    std::vector<SpiWord> mWindowWords;
+    // the held words' arrows, in order
+    std::vector<uint64_t> mWindowArrows;
+    std::vector<uint8_t> mMosiBytes;
+    std::vector<uint8_t> mMisoBytes;
+
+    uint64_t mPassedCount;
+    uint64_t mDroppedCount;
+
+    bool mProgressHeld;
+    uint64_t mProgressSample;
+};
+
+#endif // SPI_PAYLOAD_FILTER_H
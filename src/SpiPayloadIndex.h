@@ -0,0 +1,355 @@
+#ifndef SPI_PAYLOAD_INDEX_H
+#define SPI_PAYLOAD_INDEX_H
+
+// The payload search index: a sidecar to a binary frame file (SpiFrameFile.h), kept next to it as <frame file>.idx, that finds where a
+// byte sequence was sent without reading every frame. Like the frame file it is little-endian, its sections start on 8 byte
+// boundaries, and it can be memory-mapped and used in place.
+//
+// The bytes of each channel, most significant byte of each word first, make one stream per run of data frames: consecutive frames
+// that are neither errors nor repeats, in the same packet and for the same slave. Dual and quad I/O words are on MOSI only. Every 4
+// consecutive bytes of a stream (a gram) are hashed into one of 2^b buckets, and each bucket lists where its grams start.
+//
+//   offset  size  field
+//        0     8  magic, "SPIINDEX"
+//        8     4  version, 2
+//       12     4  header size in bytes, 64
+//       16     8  frame count, N: the same as the frame file's
+//       24     8  posting count, P
+//       32     4  bucket bits, b
+//       36     4  gram length, 4
+//       40     4  the frame file's bits per transfer
+//       44     4  the frame file's channels
+//       48     8  fingerprint of the frame file (SpiPayloadIndexFingerprint), so an index isn't used with another export
+//       56     8  reserved, zero
+//
+// followed by:
+//
+//   bucket starts  (2^b + 1) x u64  the postings of bucket i are [ start i, start i + 1 )
+//   postings       P x u64          frame << 4 | byte within the word << 1 | 1 for MISO, 0 for MOSI; increasing within a bucket
+//
+// A gram goes in bucket ( g * 0x9E3779B1 mod 2^32 ) >> ( 32 - b ), g being its bytes read as a big-endian u32.
+//
+// This header has no dependencies beyond SpiFrameFile.h, so readers outside the analyzer can include it.
+
+#include "SpiFrameFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct SpiPayloadIndexHeader
+{
+    char mMagic[ 8 ];
+    uint32_t mVersion;
+    uint32_t mHeaderSize;
+    uint64_t mFrameCount;
+    uint64_t mPostingCount;
+    uint32_t mBucketBits;
+    uint32_t mGramLength;
+    uint32_t mBitsPerTransfer;
+    uint32_t mChannels;
+    uint64_t mFingerprint;
+    uint8_t mReserved[ 8 ];
+};
+
+static_assert( sizeof( SpiPayloadIndexHeader ) == 64, "SpiPayloadIndexHeader must match the file layout" );
+
+const char kSpiPayloadIndexMagic[ 8 ] = { 'S', 'P', 'I', 'I', 'N', 'D', 'E', 'X' };
+const uint32_t kSpiPayloadIndexVersion = 2;
+const uint32_t kSpiPayloadIndexGramLength = 4;
+const uint32_t kSpiPayloadIndexMaxBucketBits = 30;
+const uint32_t kSpiPayloadIndexHashMultiplier = 0x9E3779B1;
+// channels to search
+const uint32_t kSpiPayloadIndexMosi = 1 << 0;
+const uint32_t kSpiPayloadIndexMiso = 1 << 1;
+
+inline uint64_t SpiPayloadIndexPosting( uint64_t frame_index, uint32_t byte, bool miso )
+{
+    return frame_index << 4 | uint64_t( byte ) << 1 | ( miso ? 1 : 0 );
+}
+
+// Identifies a frame file by up to kSampledFrames of its frames, spread evenly from the first to the last, without reading all of it.
+// Add() the start sample, mosi, miso and flags of each Frame() in turn.
+class SpiPayloadIndexFingerprint
+{
+  public:
+    static const uint64_t kSampledFrames = 4096;
+
+    SpiPayloadIndexFingerprint() : mHash( 0 )
+    {
+    }
+
+    static uint64_t SampledFrameCount( uint64_t frame_count )
+    {
+        return frame_count < kSampledFrames ? frame_count : kSampledFrames;
+    }
+
+    // the i-th frame sampled
+    static uint64_t Frame( uint64_t frame_count, uint64_t i )
+    {
+        const uint64_t sampled = SampledFrameCount( frame_count );
+        return sampled > 1 ? i * ( frame_count - 1 ) / ( sampled - 1 ) : 0;
+    }
+
+    void Add( uint64_t start_sample, uint64_t mosi, uint64_t miso, uint8_t flags )
+    {
+        Mix( start_sample );
+        Mix( mosi );
+        Mix( miso );
+        Mix( flags );
+    }
+
+    uint64_t Get() const
+    {
+        return mHash;
+    }
+
+    static uint64_t Of( const SpiFrameFileView& frames )
+    {
+        SpiPayloadIndexFingerprint fingerprint;
+        for( uint64_t i = 0; i < SampledFrameCount( frames.FrameCount() ); i++ )
+        {
+            const uint64_t frame = Frame( frames.FrameCount(), i );
+            fingerprint.Add( frames.StartSamples()[ frame ], frames.Mosi()[ frame ], frames.Miso()[ frame ], frames.Flags()[ frame ] );
+        }
+        return fingerprint.Get();
+    }
+
+  protected:
+    void Mix( uint64_t value )
+    {
+        mHash = ( mHash ^ value ) * 0x9E3779B97F4A7C15ull;
+        mHash ^= mHash >> 29;
+    }
+
+    uint64_t mHash;
+};
+
+// where a byte sequence starts
+struct SpiPayloadMatch
+{
+    uint64_t mFrameIndex;
+    // the byte within the word, 0 for the most significant
+    uint32_t mByte;
+    bool mMiso;
+};
+
+// Finds the sections of a payload index that is already in memory (read or memory-mapped), and searches it. The data must be 8 byte
+// aligned, as mappings and heap blocks are.
+class SpiPayloadIndexView
+{
+  public:
+    SpiPayloadIndexView() : mHeader( NULL ), mBucketStarts( NULL ), mPostings( NULL )
+    {
+    }
+
+    // returns false if the data isn't a complete index of a version this header knows.
+    bool Open( const void* data, size_t size )
+    {
+        if( size < sizeof( SpiPayloadIndexHeader ) )
+            return false;
+
+        const SpiPayloadIndexHeader* header = static_cast<const SpiPayloadIndexHeader*>( data );
+        if( memcmp( header->mMagic, kSpiPayloadIndexMagic, sizeof( kSpiPayloadIndexMagic ) ) != 0 ||
+            header->mVersion != kSpiPayloadIndexVersion || header->mHeaderSize != sizeof( SpiPayloadIndexHeader ) ||
+            header->mGramLength != kSpiPayloadIndexGramLength || header->mBucketBits == 0 ||
+            header->mBucketBits > kSpiPayloadIndexMaxBucketBits )
+            return false;
+
+        const uint64_t words = ( size - sizeof( SpiPayloadIndexHeader ) ) / sizeof( uint64_t );
+        const uint64_t bucket_starts = ( uint64_t( 1 ) << header->mBucketBits ) + 1;
+        if( bucket_starts > words || header->mPostingCount > words - bucket_starts )
+            return false;
+
+        mHeader = header;
+        mBucketStarts = reinterpret_cast<const uint64_t*>( header + 1 );
+        mPostings = mBucketStarts + bucket_starts;
+        return mBucketStarts[ bucket_starts - 1 ] == header->mPostingCount;
+    }
+
+    const SpiPayloadIndexHeader& Header() const
+    {
+        return *mHeader;
+    }
+
+    // whether the index was made for frames: the same frame count, word size and channels, and fingerprint
+    bool IsFor( const SpiFrameFileView& frames ) const
+    {
+        return mHeader->mFrameCount == frames.FrameCount() && mHeader->mBitsPerTransfer == frames.Header().mBitsPerTransfer &&
+               mHeader->mChannels == frames.Header().mChannels && mHeader->mFingerprint == SpiPayloadIndexFingerprint::Of( frames );
+    }
+
+    static uint32_t Bucket( uint32_t gram, uint32_t bucket_bits )
+    {
+        return uint32_t( gram * kSpiPayloadIndexHashMultiplier ) >> ( 32 - bucket_bits );
+    }
+
+    // every place pattern was sent on the channels given (kSpiPayloadIndexMosi, kSpiPayloadIndexMiso), in frame order. frames must
+    // be the frame file the index was made for. Returns false if it isn't, or if the pattern is shorter than a gram; candidates, if
+    // given, is set to the number of postings checked.
+    bool Find( const SpiFrameFileView& frames, const uint8_t* pattern, size_t length, uint32_t channels,
+               std::vector<SpiPayloadMatch>& matches, uint64_t* candidates = NULL ) const
+    {
+        matches.clear();
+        if( candidates != NULL )
+            *candidates = 0;
+        if( length < kSpiPayloadIndexGramLength || IsFor( frames ) == false )
+            return false;
+
+        // the gram of the pattern with the fewest postings; every match has exactly one posting there
+        size_t best_offset = 0;
+        uint32_t best_bucket = 0;
+        uint64_t best_size = ~uint64_t( 0 );
+        for( size_t offset = 0; offset + kSpiPayloadIndexGramLength <= length; offset++ )
+        {
+            const uint32_t gram = uint32_t( pattern[ offset ] ) << 24 | uint32_t( pattern[ offset + 1 ] ) << 16 |
+                                  uint32_t( pattern[ offset + 2 ] ) << 8 | uint32_t( pattern[ offset + 3 ] );
+            const uint32_t bucket = Bucket( gram, mHeader->mBucketBits );
+            const uint64_t size = mBucketStarts[ bucket + 1 ] - mBucketStarts[ bucket ];
+            if( size < best_size )
+            {
+                best_offset = offset;
+                best_bucket = bucket;
+                best_size = size;
+            }
+        }
+
+        const uint32_t bytes_per_word = ( frames.Header().mBitsPerTransfer + 7 ) / 8;
+        for( uint64_t i = mBucketStarts[ best_bucket ]; i < mBucketStarts[ best_bucket + 1 ]; i++ )
+        {
+            const uint64_t posting = mPostings[ i ];
+            const bool miso = ( posting & 1 ) != 0;
+            if( ( channels & ( miso ? kSpiPayloadIndexMiso : kSpiPayloadIndexMosi ) ) == 0 )
+                continue;
+            if( candidates != NULL )
+                ( *candidates )++;
+
+            Cursor cursor( frames, bytes_per_word, miso, posting >> 4, uint32_t( posting >> 1 ) & 7 );
+            if( cursor.Valid() == false || cursor.Compare( pattern + best_offset, length - best_offset ) == false )
+                continue;
+
+            cursor.Seek( posting >> 4, uint32_t( posting >> 1 ) & 7 );
+            bool matched = true;
+            for( size_t back = 0; back < best_offset && matched; back++ )
+                matched = cursor.Previous() && cursor.Byte() == pattern[ best_offset - 1 - back ];
+            if( matched == false )
+                continue;
+
+            SpiPayloadMatch match;
+            match.mFrameIndex = cursor.Frame();
+            match.mByte = cursor.ByteInWord();
+            match.mMiso = miso;
+            matches.push_back( match );
+        }
+        return true;
+    }
+
+  protected:
+    // a byte of one channel's stream in the frame file
+    class Cursor
+    {
+      public:
+        Cursor( const SpiFrameFileView& frames, uint32_t bytes_per_word, bool miso, uint64_t frame, uint32_t byte )
+            : mFrames( frames ), mBytesPerWord( bytes_per_word ), mMiso( miso ), mFrame( frame ), mByte( byte )
+        {
+        }
+
+        bool Valid() const
+        {
+            return mFrame < mFrames.FrameCount() && mByte < mBytesPerWord && IsData( mFrame );
+        }
+
+        void Seek( uint64_t frame, uint32_t byte )
+        {
+            mFrame = frame;
+            mByte = byte;
+        }
+
+        uint64_t Frame() const
+        {
+            return mFrame;
+        }
+
+        uint32_t ByteInWord() const
+        {
+            return mByte;
+        }
+
+        uint8_t Byte() const
+        {
+            const uint64_t value = mMiso ? mFrames.Miso()[ mFrame ] : mFrames.Mosi()[ mFrame ];
+            return uint8_t( value >> ( 8 * ( mBytesPerWord - 1 - mByte ) ) );
+        }
+
+        // compares bytes from here on, leaving the cursor on the last one
+        bool Compare( const uint8_t* bytes, size_t length )
+        {
+            for( size_t i = 0; i < length; i++ )
+            {
+                if( ( i > 0 && Next() == false ) || Byte() != bytes[ i ] )
+                    return false;
+            }
+            return true;
+        }
+
+        bool Next()
+        {
+            if( mByte + 1 < mBytesPerWord )
+            {
+                mByte++;
+                return true;
+            }
+            if( mFrame + 1 >= mFrames.FrameCount() || Continues( mFrame, mFrame + 1 ) == false )
+                return false;
+            mFrame++;
+            mByte = 0;
+            return true;
+        }
+
+        bool Previous()
+        {
+            if( mByte > 0 )
+            {
+                mByte--;
+                return true;
+            }
+            if( mFrame == 0 || Continues( mFrame - 1, mFrame ) == false )
+                return false;
+            mFrame--;
+            mByte = mBytesPerWord - 1;
+            return true;
+        }
+
+      protected:
+        bool IsData( uint64_t frame ) const
+        {
+            const uint8_t flags = mFrames.Flags()[ frame ];
+            if( ( flags & ( kSpiFrameFileErrorFlag | kSpiFrameFileRepeatFlag ) ) != 0 )
+                return false;
+            // the same words the index was built from: dual and quad I/O words only on MOSI, and only the channels decoded
+            const bool wide = ( flags & kSpiFrameFileWideWordFlag ) != 0;
+            if( mMiso )
+                return wide == false && ( mFrames.Header().mChannels & kSpiFrameFileMisoUsed ) != 0;
+            return wide || ( mFrames.Header().mChannels & kSpiFrameFileMosiUsed ) != 0;
+        }
+
+        bool Continues( uint64_t frame, uint64_t next ) const
+        {
+            return IsData( frame ) && IsData( next ) && mFrames.PacketIds()[ frame ] == mFrames.PacketIds()[ next ] &&
+                   ( mFrames.Flags()[ frame ] & kSpiFrameFileSlaveMask ) == ( mFrames.Flags()[ next ] & kSpiFrameFileSlaveMask );
+        }
+
+        const SpiFrameFileView& mFrames;
+        uint32_t mBytesPerWord;
+        bool mMiso;
+        uint64_t mFrame;
+        uint32_t mByte;
+    };
+
+    const SpiPayloadIndexHeader* mHeader;
+    const uint64_t* mBucketStarts;
+    const uint64_t* mPostings;
+};
+
+#endif // SPI_PAYLOAD_INDEX_H
@@ -0,0 +1,146 @@
+#include "SpiPayloadIndexBuilder.h"
+
+#include "SpiWordAccumulator.h"
+
+namespace
+{
+    // a few postings per bucket, and never more buckets than fit a reasonable sidecar
+    const uint32_t kMinBucketBits = 8;
+    const uint32_t kMaxBucketBits = 24;
+    const uint64_t kPostingsPerBucket = 4;
+}
+
+SpiPayloadIndexBuilder::SpiPayloadIndexBuilder() : mBitsPerTransfer( 8 ), mBytesPerWord( 1 )
+{
+    EndStreams();
+}
+
+SpiPayloadIndexBuilder::~SpiPayloadIndexBuilder()
+{
+}
+
+void SpiPayloadIndexBuilder::Setup( uint32_t bits_per_transfer )
+{
+    mBitsPerTransfer = bits_per_transfer;
+    mBytesPerWord = ( bits_per_transfer + 7 ) / 8;
+    mHashes.clear();
+    mPostings.clear();
+    EndStreams();
+}
+
+void SpiPayloadIndexBuilder::AddWord( uint64_t frame_index, const uint8_t* mosi_bytes, const uint8_t* miso_bytes )
+{
+    const uint8_t* bytes[ 2 ] = { mosi_bytes, miso_bytes };
+    for( uint32_t channel = 0; channel < 2; channel++ )
+    {
+        if( bytes[ channel ] == NULL )
+            mStreams[ channel ].mLength = 0;
+    }
+
+    // byte by byte, MOSI before MISO, so the postings come out in order
+    for( uint32_t i = 0; i < mBytesPerWord; i++ )
+    {
+        for( uint32_t channel = 0; channel < 2; channel++ )
+        {
+            if( bytes[ channel ] != NULL )
+                AddByte( mStreams[ channel ], bytes[ channel ][ i ], SpiPayloadIndexPosting( frame_index, i, channel == 1 ) );
+        }
+    }
+}
+
+void SpiPayloadIndexBuilder::EndStreams()
+{
+    mStreams[ 0 ].mLength = 0;
+    mStreams[ 1 ].mLength = 0;
+}
+
+void SpiPayloadIndexBuilder::AddFrameFile( const SpiFrameFileView& frames )
+{
+    const SpiFrameFileHeader& header = frames.Header();
+    const bool has_mosi = ( header.mChannels & kSpiFrameFileMosiUsed ) != 0;
+    const bool has_miso = ( header.mChannels & kSpiFrameFileMisoUsed ) != 0;
+
+    EndStreams();
+    for( uint64_t i = 0; i < frames.FrameCount(); i++ )
+    {
+        const uint8_t flags = frames.Flags()[ i ];
+        if( ( flags & ( kSpiFrameFileErrorFlag | kSpiFrameFileRepeatFlag ) ) != 0 )
+        {
+            EndStreams();
+            continue;
+        }
+        if( i > 0 && ( frames.PacketIds()[ i ] != frames.PacketIds()[ i - 1 ] ||
+                       ( flags & kSpiFrameFileSlaveMask ) != ( frames.Flags()[ i - 1 ] & kSpiFrameFileSlaveMask ) ) )
+            EndStreams();
+
+        uint8_t mosi_bytes[ 8 ];
+        uint8_t miso_bytes[ 8 ];
+        SpiPackWordBytes( frames.Mosi()[ i ], mBytesPerWord, mosi_bytes );
+        SpiPackWordBytes( frames.Miso()[ i ], mBytesPerWord, miso_bytes );
+        const bool wide = ( flags & kSpiFrameFileWideWordFlag ) != 0;
+        AddWord( i, has_mosi || wide ? mosi_bytes : NULL, has_miso && wide == false ? miso_bytes : NULL );
+    }
+    EndStreams();
+}
+
+uint64_t SpiPayloadIndexBuilder::GetGramCount() const
+{
+    return mPostings.size();
+}
+
+void SpiPayloadIndexBuilder::Build( uint64_t frame_count, uint32_t channels, uint64_t fingerprint, SpiPayloadIndexHeader& header,
+                                    std::vector<uint64_t>& bucket_starts, std::vector<uint64_t>& postings ) const
+{
+    // grams are added as their last byte comes in, so the ones that fit are a prefix
+    size_t count = mPostings.size();
+    while( count > 0 )
+    {
+        const uint64_t posting = mPostings[ count - 1 ];
+        const uint64_t last_frame = ( posting >> 4 ) + ( ( ( posting >> 1 ) & 7 ) + kSpiPayloadIndexGramLength - 1 ) / mBytesPerWord;
+        if( last_frame < frame_count )
+            break;
+        count--;
+    }
+
+    uint32_t bucket_bits = kMinBucketBits;
+    while( bucket_bits < kMaxBucketBits && ( uint64_t( 1 ) << bucket_bits ) * kPostingsPerBucket < count )
+        bucket_bits++;
+    const uint32_t bucket_count = uint32_t( 1 ) << bucket_bits;
+
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.mMagic, kSpiPayloadIndexMagic, sizeof( header.mMagic ) );
+    header.mVersion = kSpiPayloadIndexVersion;
+    header.mHeaderSize = sizeof( header );
+    header.mFrameCount = frame_count;
+    header.mPostingCount = count;
+    header.mBucketBits = bucket_bits;
+    header.mGramLength = kSpiPayloadIndexGramLength;
+    header.mBitsPerTransfer = mBitsPerTransfer;
+    header.mChannels = channels;
+    header.mFingerprint = fingerprint;
+
+    // a counting sort, which keeps each bucket's postings in the order they were added
+    bucket_starts.assign( bucket_count + 1, 0 );
+    for( size_t i = 0; i < count; i++ )
+        bucket_starts[ ( mHashes[ i ] >> ( 32 - bucket_bits ) ) + 1 ]++;
+    for( uint32_t i = 0; i < bucket_count; i++ )
+        bucket_starts[ i + 1 ] += bucket_starts[ i ];
+
+    std::vector<uint64_t> next( bucket_starts.begin(), bucket_starts.end() - 1 );
+    postings.resize( count );
+    for( size_t i = 0; i < count; i++ )
+        postings[ next[ mHashes[ i ] >> ( 32 - bucket_bits ) ]++ ] = mPostings[ i ];
+}
+
+void SpiPayloadIndexBuilder::AddByte( Stream& stream, uint8_t byte, uint64_t posting )
+{
+    stream.mGram = stream.mGram << 8 | byte;
+    stream.mPositions[ stream.mLength % kSpiPayloadIndexGramLength ] = posting;
+    stream.mLength++;
+    if( stream.mLength < kSpiPayloadIndexGramLength )
+        return;
+
+    // the gram starts at the oldest of the last four bytes, which shares its slot with the next one
+    mHashes.push_back( stream.mGram * kSpiPayloadIndexHashMultiplier );
+    mPostings.push_back( stream.mPositions[ stream.mLength % kSpiPayloadIndexGramLength ] );
+}
@@ -0,0 +1,56 @@
+#ifndef SPI_PAYLOAD_INDEX_BUILDER_H
+#define SPI_PAYLOAD_INDEX_BUILDER_H
+
+#include "SpiPayloadIndex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Collects the grams of a frame file's payload search index (SpiPayloadIndex.h), a word at a time as the frames are added or all at
+// once from a frame file, and lays them out in buckets when the index is written.
+class SpiPayloadIndexBuilder
+{
+  public:
+    SpiPayloadIndexBuilder();
+    ~SpiPayloadIndexBuilder();
+
+    void Setup( uint32_t bits_per_transfer );
+
+    // a data frame's words, as (bits + 7) / 8 bytes each, most significant first; NULL for a channel that isn't indexed. A frame
+    // continues the streams of the word added before it unless EndStreams() was called in between.
+    void AddWord( uint64_t frame_index, const uint8_t* mosi_bytes, const uint8_t* miso_bytes );
+    // at the start of every enable window, and at every frame that isn't a word
+    void EndStreams();
+
+    // every data frame of a frame file, for an index of a frame file exported without one
+    void AddFrameFile( const SpiFrameFileView& frames );
+
+    uint64_t GetGramCount() const;
+
+    // the index of the first frame_count frames, for the frame file with those frames, channels (kSpiFrameFileMosiUsed and
+    // kSpiFrameFileMisoUsed) and fingerprint; grams reaching past them are left out.
+    void Build( uint64_t frame_count, uint32_t channels, uint64_t fingerprint, SpiPayloadIndexHeader& header,
+                std::vector<uint64_t>& bucket_starts, std::vector<uint64_t>& postings ) const;
+
+  protected:
+    // the last bytes of one channel's stream, and where each of them is, by byte count mod 4
+    struct Stream
+    {
+        uint32_t mGram;
+        uint64_t mLength;
+        uint64_t mPositions[ kSpiPayloadIndexGramLength ];
+    };
+
+    void AddByte( Stream& stream, uint8_t byte, uint64_t posting );
+
+    uint32_t mBitsPerTransfer;
+    uint32_t mBytesPerWord;
+    Stream mStreams[ 2 ];
+
+    // a gram's hash, from which its bucket is taken, and its posting, in the order they were added
+    std::vector<uint32_t> mHashes;
+    std::vector<uint64_t> mPostings;
+};
+
+#endif // SPI_PAYLOAD_INDEX_BUILDER_H
@@ -0,0 +1,243 @@
+#include "SpiRepeatCollapser.h"
+
+namespace
+{
+    bool SameData( const SpiWord& a, const SpiWord& b )
+    {
+        return a.mMosi == b.mMosi && a.mMiso == b.mMiso && a.mDataLanes == b.mDataLanes;
+    }
+}
+
+const size_t SpiRepeatCollapser::kMaxWindowWords;
+const uint64_t SpiRepeatCollapser::kMaxRunLength;
+
+SpiRepeatCollapser::SpiRepeatCollapser()
+    : mSink( NULL ),
+      mHasPrevious( false ),
+      mPreviousSlave( 0 ),
+      mInWindow( false ),
+      mHolding( false ),
+      mWindowTooLong( false ),
+      mWindowStart( 0 ),
+      mWindowSlave( 0 ),
+      mRunCount( 0 ),
+      mRunFirstSample( 0 ),
+      mRunLastSample( 0 ),
+      mRunSlave( 0 ),
+      mRunBoundary( false ),
+      mPendingBoundaries( 0 ),
+      mProgressHeld( false ),
+      mProgressSample( 0 )
+{
+}
+
+SpiRepeatCollapser::~SpiRepeatCollapser()
+{
+}
+
+void SpiRepeatCollapser::Setup( RepeatSink* sink )
+{
+    mSink = sink;
+    mHasPrevious = false;
+    mPreviousWords.clear();
+    mInWindow = false;
+    mHolding = false;
+    mWindowTooLong = false;
+    mWindowWords.clear();
+    mWindowArrows.clear();
+    mRunCount = 0;
+    mRunBoundary = false;
+    mPendingBoundaries = 0;
+    mProgressHeld = false;
+
+    mPreviousWords.reserve( kMaxWindowWords );
+    mWindowWords.reserve( kMaxWindowWords );
+}
+
+void SpiRepeatCollapser::Flush()
+{
+    EndRun();
+    if( mHolding == false )
+        BeginOutput();
+    ReleaseProgress();
+}
+
+void SpiRepeatCollapser::Finish()
+{
+    if( mHolding )
+        StopHolding();
+    Flush();
+}
+
+void SpiRepeatCollapser::OnPacketBoundary()
+{
+    // between two copies of a run; passed on after the run, if the run ends before the next window does.
+    if( mRunCount > 0 )
+        mRunBoundary = true;
+    else
+        mPendingBoundaries++;
+}
+
+void SpiRepeatCollapser::OnEnable( uint64_t sample, uint32_t slave )
+{
+    mInWindow = true;
+    mWindowTooLong = false;
+    mWindowStart = sample;
+    mWindowSlave = slave;
+    mWindowWords.clear();
+    mWindowArrows.clear();
+
+    if( mHasPrevious && mPreviousSlave == slave )
+    {
+        mHolding = true;
+        return;
+    }
+
+    EndRun();
+    BeginOutput();
+    mSink->OnEnable( sample, slave );
+}
+
+void SpiRepeatCollapser::OnDisable( uint64_t sample, uint32_t slave )
+{
+    mInWindow = false;
+
+    if( mHolding && mWindowWords.size() == mPreviousWords.size() )
+    {
+        mHolding = false;
+        if( mRunCount == 0 )
+        {
+            mRunFirstSample = mWindowStart;
+            mRunSlave = slave;
+        }
+        mRunCount++;
+        mRunLastSample = sample;
+        mRunBoundary = false;
+        if( mRunCount >= kMaxRunLength )
+            EndRun();
+        ReleaseProgress();
+        return;
+    }
+
+    if( mHolding )
+        StopHolding();
+    mSink->OnDisable( sample, slave );
+
+    mHasPrevious = mWindowWords.empty() == false && mWindowTooLong == false;
+    if( mHasPrevious )
+    {
+        mPreviousSlave = slave;
+        mPreviousWords.swap( mWindowWords );
+        for( size_t i = 0; i < mPreviousWords.size(); i++ )
+            mPreviousWords[ i ].mArrowCount = 0;
+    }
+    ReleaseProgress();
+}
+
+void SpiRepeatCollapser::OnClockPolarityError( uint64_t sample )
+{
+    EndRun();
+    BeginOutput();
+    mHasPrevious = false;
+    mSink->OnClockPolarityError( sample );
+}
+
+void SpiRepeatCollapser::OnErrorFrame( uint64_t starting_sample, uint64_t ending_sample, uint32_t slave )
+{
+    EndRun();
+    BeginOutput();
+    mHasPrevious = false;
+    mSink->OnErrorFrame( starting_sample, ending_sample, slave );
+    ReleaseProgress();
+}
+
+void SpiRepeatCollapser::OnWord( const SpiWord& word )
+{
+    if( mHolding )
+    {
+        const size_t index = mWindowWords.size();
+        if( index < mPreviousWords.size() && SameData( word, mPreviousWords[ index ] ) )
+        {
+            mWindowWords.push_back( word );
+            mWindowWords.back().mArrowLocations = NULL;
+            mWindowArrows.insert( mWindowArrows.end(), word.mArrowLocations, word.mArrowLocations + word.mArrowCount );
+            return;
+        }
+        StopHolding();
+    }
+
+    if( mInWindow && mWindowWords.size() < kMaxWindowWords )
+    {
+        mWindowWords.push_back( word );
+        mWindowWords.back().mArrowLocations = NULL;
+    }
+    else if( mInWindow )
+    {
+        mWindowTooLong = true;
+    }
+    mSink->OnWord( word );
+}
+
+void SpiRepeatCollapser::OnChipSelectOverlap( uint64_t sample, uint32_t slave )
+{
+    mSink->OnChipSelectOverlap( sample, slave );
+}
+
+void SpiRepeatCollapser::OnProgress( uint64_t sample )
+{
+    mProgressSample = sample;
+    mProgressHeld = true;
+    ReleaseProgress();
+}
+
+void SpiRepeatCollapser::PollForExit()
+{
+    mSink->PollForExit();
+}
+
+void SpiRepeatCollapser::StopHolding()
+{
+    mHolding = false;
+    EndRun();
+    BeginOutput();
+    mSink->OnEnable( mWindowStart, mWindowSlave );
+
+    const uint64_t* arrows = mWindowArrows.data();
+    for( size_t i = 0; i < mWindowWords.size(); i++ )
+    {
+        mWindowWords[ i ].mArrowLocations = arrows;
+        mSink->OnWord( mWindowWords[ i ] );
+        mWindowWords[ i ].mArrowLocations = NULL;
+        arrows += mWindowWords[ i ].mArrowCount;
+    }
+}
+
+void SpiRepeatCollapser::EndRun()
+{
+    if( mRunCount == 0 )
+        return;
+
+    BeginOutput();
+    mSink->OnRepeat( mRunFirstSample, mRunLastSample, mRunCount, mRunSlave, mPreviousWords.data(), mPreviousWords.size() );
+    mRunCount = 0;
+    if( mRunBoundary )
+    {
+        mPendingBoundaries++;
+        mRunBoundary = false;
+    }
+}
+
+void SpiRepeatCollapser::BeginOutput()
+{
+    for( ; mPendingBoundaries > 0; mPendingBoundaries-- )
+        mSink->OnPacketBoundary();
+}
+
+void SpiRepeatCollapser::ReleaseProgress()
+{
+    // progress can't pass results that are still held back
+    if( mProgressHeld == false || mHolding || mRunCount > 0 )
+        return;
+    mSink->OnProgress( mProgressSample );
+    mProgressHeld = false;
+}
@@ -0,0 +1,92 @@
+#ifndef SPI_REPEAT_COLLAPSER_H
+#define SPI_REPEAT_COLLAPSER_H
+
+#include "SpiDecoder.h"
+
+#include <cstddef>
+#include <vector>
+
+// Sits between SpiDecoder and its sink, and folds enable windows that carry exactly the same words as the one before them, for the
+// same slave, into a single OnRepeat() for the whole run. The first window of a run is passed on as usual; only the copies after it
+// are collapsed, and windows without words never are. Everything else is passed on unchanged and in order, so a capture without
+// repeats comes out exactly as it went in.
+//
+// A window is only known to be a repeat when it ends, so its events are held until then, and replayed if a word turns out to differ.
+class SpiRepeatCollapser : public SpiDecoderSink
+{
+  public:
+    class RepeatSink : public SpiDecoderSink
+    {
+      public:
+        // count copies of the previous window, from the first one's enable edge to the last one's disable edge. words are the words of
+        // each copy, without arrows.
+        virtual void OnRepeat( uint64_t first_sample, uint64_t last_sample, uint64_t count, uint32_t slave, const SpiWord* words,
+                               size_t word_count ) = 0;
+    };
+
+    // windows with more words than this are never collapsed
+    static const size_t kMaxWindowWords = 256;
+    // a run is reported once it is this long, and a new one started, so a repeat frame never spans too much of the capture
+    static const uint64_t kMaxRunLength = 4096;
+
+    SpiRepeatCollapser();
+    ~SpiRepeatCollapser();
+
+    void Setup( RepeatSink* sink );
+    // passes on the run being collapsed, if any, and whatever else can be passed on before the current window ends.
+    void Flush();
+    // at the end of the capture, or before waiting for more of it: passes on everything, including a window cut short while it still
+    // looked like a repeat. Such a window is passed on as it came, and the rest of it follows as usual.
+    void Finish();
+
+    // SpiDecoderSink
+    virtual void OnPacketBoundary();
+    virtual void OnEnable( uint64_t sample, uint32_t slave );
+    virtual void OnDisable( uint64_t sample, uint32_t slave );
+    virtual void OnClockPolarityError( uint64_t sample );
+    virtual void OnErrorFrame( uint64_t starting_sample, uint64_t ending_sample, uint32_t slave );
+    virtual void OnWord( const SpiWord& word );
+    virtual void OnChipSelectOverlap( uint64_t sample, uint32_t slave );
+    virtual void OnProgress( uint64_t sample );
+    virtual void PollForExit();
+
+  protected:
+    // the window being held turned out not to be a repeat: pass it on as it came
+    void StopHolding();
+    void EndRun();
+    // before passing anything on
+    void BeginOutput();
+    void ReleaseProgress();
+
+    RepeatSink* mSink;
+
+    // the last window passed on or collapsed, without arrows
+    bool mHasPrevious;
+    uint32_t mPreviousSlave;
+    std::vector<SpiWord> mPreviousWords;
+
+    // the window in progress
+    bool mInWindow;
+    bool mHolding;
+    bool mWindowTooLong;
+    uint64_t mWindowStart;
+    uint32_t mWindowSlave;
+    std::vector<SpiWord> mWindowWords;
+    // the held words' arrows, in order
+    std::vector<uint64_t> mWindowArrows;
+
+    // the run of copies not reported yet
+    uint64_t mRunCount;
+    uint64_t mRunFirstSample;
+    uint64_t mRunLastSample;
+    uint32_t mRunSlave;
+
+    // the boundary after the run's last copy, passed on once the run has been
+    bool mRunBoundary;
+    // boundaries are passed on when something comes after them, so a run's copies end up in one packet
+    uint32_t mPendingBoundaries;
+    bool mProgressHeld;
+    uint64_t mProgressSample;
+};
+
+#endif // SPI_REPEAT_COLLAPSER_H
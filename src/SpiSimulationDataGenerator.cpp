@@ -1,6 +1,8 @@
 #include "SpiSimulationDataGenerator.h"
 #include "SpiAnalyzerSettings.h"
 
+#include <algorithm>
+
 SpiSimulationDataGenerator::SpiSimulationDataGenerator()
 {
 }
@@ -14,26 +16,56 @@ void SpiSimulationDataGenerator::Initialize( U32 simulation_sample_rate, SpiAnal
     mSimulationSampleRateHz = simulation_sample_rate;
     mSettings = settings;
 
-    mClockGenerator.Init( simulation_sample_rate / 10, simulation_sample_rate );
+    mClockPeriod = double( std::max( settings->mSimulationClockDivider, 2u ) );
+    mTime = 0.0;
+    mRandomState = settings->mSimulationSeed;
+    mTransactionCount = 0;
+    mFlashAddress = 0;
+
+    // the lines are handed out as pointers, so the vector mustn't grow past this
+    mLines.clear();
+    mLines.reserve( 6 + kSpiMaxChipSelects - 1 );
 
     if( settings->mMisoChannel != UNDEFINED_CHANNEL )
-        mMiso = mSpiSimulationChannels.Add( settings->mMisoChannel, mSimulationSampleRateHz, BIT_LOW );
+        mMiso = AddLine( settings->mMisoChannel, BIT_LOW );
     else
         mMiso = NULL;
 
     if( settings->mMosiChannel != UNDEFINED_CHANNEL )
-        mMosi = mSpiSimulationChannels.Add( settings->mMosiChannel, mSimulationSampleRateHz, BIT_LOW );
+        mMosi = AddLine( settings->mMosiChannel, BIT_LOW );
     else
         mMosi = NULL;
 
-    mClock = mSpiSimulationChannels.Add( settings->mClockChannel, mSimulationSampleRateHz, mSettings->mClockInactiveState );
+    mClock = AddLine( settings->mClockChannel, mSettings->mClockInactiveState );
 
     if( settings->mEnableChannel != UNDEFINED_CHANNEL )
-        mEnable = mSpiSimulationChannels.Add( settings->mEnableChannel, mSimulationSampleRateHz, Invert( mSettings->mEnableActiveState ) );
+        mEnable = AddLine( settings->mEnableChannel, Invert( mSettings->mEnableActiveState ) );
     else
         mEnable = NULL;
 
-    mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( 10.0 ) ); // insert 10 bit-periods of idle
+    mChipSelects.clear();
+    mNextChipSelect = 0;
+    std::vector<Channel> chip_selects = settings->GetChipSelectChannels();
+    for( size_t i = 0; i < chip_selects.size(); i++ )
+    {
+        if( i == 0 )
+            mChipSelects.push_back( mEnable );
+        else if( chip_selects[ i ] != UNDEFINED_CHANNEL )
+            mChipSelects.push_back( AddLine( chip_selects[ i ], Invert( mSettings->mEnableActiveState ) ) );
+    }
+
+    if( settings->mDataLanes == 4 )
+    {
+        mIo2 = AddLine( settings->mIo2Channel, BIT_LOW );
+        mIo3 = AddLine( settings->mIo3Channel, BIT_LOW );
+    }
+    else
+    {
+        mIo2 = NULL;
+        mIo3 = NULL;
+    }
+
+    mTime += 10.0 * mClockPeriod; // insert 10 bit-periods of idle
 
     mValue = 0;
 }
@@ -44,114 +76,298 @@ U32 SpiSimulationDataGenerator::GenerateSimulationData( U64 largest_sample_reque
     U64 adjusted_largest_sample_requested =
         AnalyzerHelpers::AdjustSimulationTargetSample( largest_sample_requested, sample_rate, mSimulationSampleRateHz );
 
-    while( mClock->GetCurrentSampleNumber() < adjusted_largest_sample_requested )
-    {
+    while( SampleAt( 0.0 ) < adjusted_largest_sample_requested )
         CreateSpiTransaction();
-
-        mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( 10.0 ) ); // insert 10 bit-periods of idle
-    }
+    WriteStagedEdges();
 
     *simulation_channels = mSpiSimulationChannels.GetArray();
     return mSpiSimulationChannels.GetCount();
 }
 
-void SpiSimulationDataGenerator::CreateSpiTransaction()
+SpiSimulationDataGenerator::SimulationLine* SpiSimulationDataGenerator::AddLine( Channel& channel, BitState initial_bit_state )
 {
-    if( mEnable != NULL )
-        mEnable->Transition();
+    SimulationLine line;
+    line.mDescriptor = mSpiSimulationChannels.Add( channel, mSimulationSampleRateHz, initial_bit_state );
+    line.mBitState = initial_bit_state;
+    line.mWrittenSample = 0;
+    mLines.push_back( line );
+    return &mLines.back();
+}
 
-    mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( 2.0 ) );
+U64 SpiSimulationDataGenerator::SampleAt( double clocks ) const
+{
+    return U64( mTime + clocks * mClockPeriod + 0.5 );
+}
 
-    if( mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge )
-    {
-        OutputWord_CPHA0( mValue, mValue + 1 );
-        mValue++;
+void SpiSimulationDataGenerator::AddEdge( SimulationLine* line, U64 sample )
+{
+    line->mEdges.push_back( sample );
+    line->mBitState = Invert( line->mBitState );
+}
 
-        OutputWord_CPHA0( mValue, mValue + 1 );
-        mValue++;
+void SpiSimulationDataGenerator::SetBit( SimulationLine* line, BitState bit_state, U64 sample )
+{
+    if( line != NULL && line->mBitState != bit_state )
+        AddEdge( line, sample );
+}
 
-        OutputWord_CPHA0( mValue, mValue + 1 );
-        mValue++;
+U64 SpiSimulationDataGenerator::NextRandom()
+{
+    // SplitMix64
+    mRandomState += 0x9E3779B97F4A7C15ull;
+    U64 x = mRandomState;
+    x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+    x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBull;
+    return x ^ ( x >> 31 );
+}
 
-        if( mEnable != NULL )
-            mEnable->Transition();
+void SpiSimulationDataGenerator::WriteStagedEdges()
+{
+    const U64 sample = SampleAt( 0.0 );
+    for( size_t i = 0; i < mLines.size(); i++ )
+    {
+        SimulationLine& line = mLines[ i ];
+        for( size_t e = 0; e < line.mEdges.size(); e++ )
+        {
+            line.mDescriptor->Advance( U32( line.mEdges[ e ] - line.mWrittenSample ) );
+            line.mDescriptor->Transition();
+            line.mWrittenSample = line.mEdges[ e ];
+        }
+        line.mEdges.clear();
+
+        line.mDescriptor->Advance( U32( sample - line.mWrittenSample ) );
+        line.mWrittenSample = sample;
+    }
+}
 
-        OutputWord_CPHA0( mValue, mValue + 1 );
-        mValue++;
+void SpiSimulationDataGenerator::CreateSpiTransaction()
+{
+    if( mChipSelects.empty() == false )
+    {
+        mEnable = mChipSelects[ mNextChipSelect ];
+        mNextChipSelect = ( mNextChipSelect + 1 ) % U32( mChipSelects.size() );
     }
-    else
+
+    // the clock idles at the wrong level from just before the enable window until just after it
+    const U32 polarity_error_interval = mSettings->mSimulationPolarityErrorInterval;
+    const bool polarity_error = polarity_error_interval != 0 && mTransactionCount % polarity_error_interval == polarity_error_interval - 1;
+    mTransactionCount++;
+    if( polarity_error )
+    {
+        AddEdge( mClock, SampleAt( 0.0 ) );
+        mTime += mClockPeriod;
+    }
+
+    if( mEnable != NULL )
+        AddEdge( mEnable, SampleAt( 0.0 ) );
+
+    bool window_open = true;
+    double idle_clocks = 10.0;
+    switch( mSettings->mSimulationProfile )
     {
-        OutputWord_CPHA1( mValue, mValue + 1 );
-        mValue++;
+    case SpiSimulationFlashRead:
+        mTime += 2.0 * mClockPeriod;
+        OutputFlashRead();
+        break;
+    case SpiSimulationRegisterPoll:
+        // as close together as they can be
+        mTime += mClockPeriod;
+        OutputRegisterPoll();
+        idle_clocks = 1.0;
+        break;
+    case SpiSimulationRandom:
+        mTime += 2.0 * mClockPeriod;
+        OutputRandomWords();
+        idle_clocks = double( 1 + NextRandom() % 20 );
+        break;
+    default:
+        mTime += 2.0 * mClockPeriod;
+        OutputDemoWords();
+        window_open = false;
+        break;
+    }
 
-        OutputWord_CPHA1( mValue, mValue + 1 );
-        mValue++;
+    if( window_open && mEnable != NULL )
+        AddEdge( mEnable, SampleAt( 0.0 ) );
 
-        OutputWord_CPHA1( mValue, mValue + 1 );
-        mValue++;
+    if( polarity_error )
+    {
+        mTime += mClockPeriod;
+        AddEdge( mClock, SampleAt( 0.0 ) );
+    }
+
+    mTime += idle_clocks * mClockPeriod;
+}
 
+void SpiSimulationDataGenerator::OutputDemoWords()
+{
+    if( mSettings->mDataLanes > 1 )
+    {
+        // a command sent one bit per clock, as the decoder expects after each active enable edge, then data on every lane
         if( mEnable != NULL )
-            mEnable->Transition();
+        {
+            for( U32 i = 0; i < mSettings->mSingleBitWords; i++ )
+            {
+                OutputWord( mValue, 0 );
+                mValue++;
+            }
+        }
+
+        for( U32 i = 0; i < 3; i++ )
+        {
+            OutputWideWord( mValue );
+            mValue++;
+        }
 
-        OutputWord_CPHA1( mValue, mValue + 1 );
-        mValue++;
+        if( mEnable != NULL )
+            AddEdge( mEnable, SampleAt( 0.0 ) );
+        return;
     }
+
+    OutputWord( mValue, mValue + 1 );
+    mValue++;
+
+    OutputWord( mValue, mValue + 1 );
+    mValue++;
+
+    OutputWord( mValue, mValue + 1 );
+    mValue++;
+
+    if( mEnable != NULL )
+        AddEdge( mEnable, SampleAt( 0.0 ) );
+
+    OutputWord( mValue, mValue + 1 );
+    mValue++;
 }
 
-void SpiSimulationDataGenerator::OutputWord_CPHA0( U64 mosi_data, U64 miso_data )
+void SpiSimulationDataGenerator::OutputFlashRead()
 {
-    BitExtractor mosi_bits( mosi_data, mSettings->mShiftOrder, mSettings->mBitsPerTransfer );
-    BitExtractor miso_bits( miso_data, mSettings->mShiftOrder, mSettings->mBitsPerTransfer );
+    // READ and a 24-bit address on MOSI, then the data on MISO, or on every lane with dual and quad I/O
+    const U64 header[ 4 ] = { 0x03, ( mFlashAddress >> 16 ) & 0xFF, ( mFlashAddress >> 8 ) & 0xFF, mFlashAddress & 0xFF };
+    const U32 burst_bytes = mSettings->mSimulationBurstKB * 1024;
+    const U32 words = std::max( burst_bytes * 8 / mSettings->mBitsPerTransfer, 1u );
+    mFlashAddress = ( mFlashAddress + burst_bytes ) & 0xFFFFFF;
 
-    U32 count = mSettings->mBitsPerTransfer;
-    for( U32 i = 0; i < count; i++ )
+    if( mSettings->mDataLanes > 1 )
     {
-        if( mMosi != NULL )
-            mMosi->TransitionIfNeeded( mosi_bits.GetNextBit() );
+        OutputSingleBitWords( header, 4 );
+        for( U32 i = 0; i < words; i++ )
+            OutputWideWord( NextRandom() );
+        return;
+    }
 
-        if( mMiso != NULL )
-            mMiso->TransitionIfNeeded( miso_bits.GetNextBit() );
+    for( U32 i = 0; i < 4; i++ )
+        OutputWord( header[ i ], 0 );
+    for( U32 i = 0; i < words; i++ )
+        OutputWord( 0, NextRandom() );
+}
 
-        mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( .5 ) );
-        mClock->Transition(); // data valid
+void SpiSimulationDataGenerator::OutputRegisterPoll()
+{
+    // a read of a status register, busy most of the time
+    const U64 header[ 1 ] = { 0x85 };
+    const U64 status = NextRandom() % 16 == 0 ? 0x00 : 0x01;
 
-        mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( .5 ) );
-        mClock->Transition(); // data invalid
+    if( mSettings->mDataLanes > 1 )
+    {
+        OutputSingleBitWords( header, 1 );
+        OutputWideWord( status );
+        return;
     }
 
-    if( mMosi != NULL )
-        mMosi->TransitionIfNeeded( BIT_LOW );
+    OutputWord( header[ 0 ], 0 );
+    OutputWord( 0, status );
+}
+
+void SpiSimulationDataGenerator::OutputRandomWords()
+{
+    const U32 words = U32( 1 + NextRandom() % 16 );
 
-    if( mMiso != NULL )
-        mMiso->TransitionIfNeeded( BIT_LOW );
+    if( mSettings->mDataLanes > 1 )
+    {
+        OutputSingleBitWords( NULL, 0 );
+        for( U32 i = 0; i < words; i++ )
+            OutputWideWord( NextRandom() );
+        return;
+    }
 
-    mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( 2.0 ) );
+    for( U32 i = 0; i < words; i++ )
+    {
+        const U64 mosi_data = NextRandom();
+        OutputWord( mosi_data, NextRandom() );
+    }
 }
 
-void SpiSimulationDataGenerator::OutputWord_CPHA1( U64 mosi_data, U64 miso_data )
+void SpiSimulationDataGenerator::OutputSingleBitWords( const U64* header, U32 header_count )
 {
-    BitExtractor mosi_bits( mosi_data, mSettings->mShiftOrder, mSettings->mBitsPerTransfer );
-    BitExtractor miso_bits( miso_data, mSettings->mShiftOrder, mSettings->mBitsPerTransfer );
+    // the decoder only expects them after an active enable edge
+    if( mEnable == NULL )
+        return;
+
+    for( U32 i = 0; i < mSettings->mSingleBitWords; i++ )
+        OutputWord( i < header_count ? header[ i ] : NextRandom(), 0 );
+}
 
-    U32 count = mSettings->mBitsPerTransfer;
+void SpiSimulationDataGenerator::OutputWord( U64 mosi_data, U64 miso_data )
+{
+    // MOSI is lane 0 and MISO lane 1, as in dual I/O
+    U8 bits[ 64 ];
+    const U32 count = mSettings->mBitsPerTransfer;
+    const bool lsb_first = mSettings->mShiftOrder == AnalyzerEnums::LsbFirst;
     for( U32 i = 0; i < count; i++ )
     {
-        mClock->Transition(); // data invalid
-        if( mMosi != NULL )
-            mMosi->TransitionIfNeeded( mosi_bits.GetNextBit() );
-        if( mMiso != NULL )
-            mMiso->TransitionIfNeeded( miso_bits.GetNextBit() );
+        U32 shift = lsb_first ? i : count - 1 - i;
+        bits[ i ] = U8( ( ( mosi_data >> shift ) & 1 ) | ( ( ( miso_data >> shift ) & 1 ) << 1 ) );
+    }
 
-        mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( .5 ) );
-        mClock->Transition(); // data valid
+    OutputBits( bits, count, 2 );
+}
 
-        mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( .5 ) );
+void SpiSimulationDataGenerator::OutputWideWord( U64 data )
+{
+    U8 bits[ 64 ];
+    const U32 lane_count = mSettings->mDataLanes;
+    const U32 clocks = mSettings->mBitsPerTransfer / lane_count;
+    const bool lsb_first = mSettings->mShiftOrder == AnalyzerEnums::LsbFirst;
+    const U64 group_mask = ( 1ull << lane_count ) - 1;
+    for( U32 i = 0; i < clocks; i++ )
+    {
+        // each clock carries a group of lane_count bits, IO0 the least significant; the first group is the most significant for MSB
+        // first, the least for LSB first.
+        U32 group_index = lsb_first ? i : clocks - 1 - i;
+        bits[ i ] = U8( ( data >> ( group_index * lane_count ) ) & group_mask );
     }
 
-    if( mMosi != NULL )
-        mMosi->TransitionIfNeeded( BIT_LOW );
-    if( mMiso != NULL )
-        mMiso->TransitionIfNeeded( BIT_LOW );
+    OutputBits( bits, clocks, lane_count );
+}
+
+void SpiSimulationDataGenerator::OutputBits( const U8* bits, U32 bit_count, U32 bit_width )
+{
+    SimulationLine* lanes[ 4 ] = { mMosi, mMiso, mIo2, mIo3 };
+    const bool leading_edge = mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge;
+
+    // each bit takes a clock period: the data changes as it starts, and the clock toggles halfway through and (leading edge) at its end
+    for( U32 i = 0; i < bit_count; i++ )
+    {
+        const U64 bit_start = SampleAt( i );
+        if( leading_edge == false )
+            AddEdge( mClock, bit_start ); // data invalid
+        for( U32 lane = 0; lane < bit_width; lane++ )
+            SetBit( lanes[ lane ], ( ( bits[ i ] >> lane ) & 1 ) != 0 ? BIT_HIGH : BIT_LOW, bit_start );
+
+        AddEdge( mClock, SampleAt( i + 0.5 ) ); // data valid
+
+        if( leading_edge )
+            AddEdge( mClock, SampleAt( i + 1.0 ) ); // data invalid
+    }
+    mTime += bit_count * mClockPeriod;
+
+    const U64 word_end = SampleAt( 0.0 );
+    for( U32 lane = 0; lane < bit_width; lane++ )
+        SetBit( lanes[ lane ], BIT_LOW, word_end );
+
+    mTime += 2.0 * mClockPeriod;
 
-    mSpiSimulationChannels.AdvanceAll( mClockGenerator.AdvanceByHalfPeriod( 2.0 ) );
+    if( mClock->mEdges.size() >= kMaxStagedClockEdges )
+        WriteStagedEdges();
 }
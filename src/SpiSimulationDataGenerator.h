@@ -2,6 +2,7 @@
 #define SPI_SIMULATION_DATA_GENERATOR
 
 #include <AnalyzerHelpers.h>
+#include <vector>
 
 class SpiAnalyzerSettings;
 
@@ -20,17 +21,64 @@ class SpiSimulationDataGenerator
     U64 mValue;
 
   protected: // SPI specific
-    ClockGenerator mClockGenerator;
+    // A simulated channel. Its transitions are worked out a word at a time and kept here, then written to the descriptor in batches,
+    // so the descriptors only see one Advance() and Transition() per edge.
+    struct SimulationLine
+    {
+        SimulationChannelDescriptor* mDescriptor;
+        BitState mBitState;
+        // the descriptor has been advanced this far
+        U64 mWrittenSample;
+        std::vector<U64> mEdges;
+    };
 
+    // written out once the clock has this many edges waiting
+    static const size_t kMaxStagedClockEdges = 1 << 16;
+
+    SimulationLine* AddLine( Channel& channel, BitState initial_bit_state );
+    // the sample clocks clock periods from now
+    U64 SampleAt( double clocks ) const;
+    void AddEdge( SimulationLine* line, U64 sample );
+    void SetBit( SimulationLine* line, BitState bit_state, U64 sample );
+    void WriteStagedEdges();
+
+    U64 NextRandom();
+
+    // a transaction of the selected profile, with the idle time after it
     void CreateSpiTransaction();
-    void OutputWord_CPHA0( U64 mosi_data, U64 miso_data );
-    void OutputWord_CPHA1( U64 mosi_data, U64 miso_data );
+    // the words of each profile, for an enable window already open
+    void OutputDemoWords();
+    void OutputFlashRead();
+    void OutputRegisterPoll();
+    void OutputRandomWords();
+    // dual and quad I/O: the words sent a bit per clock at the start of a transaction, header[ i ] the i-th while there are enough
+    void OutputSingleBitWords( const U64* header, U32 header_count );
+    // a word on MOSI and MISO, one bit per clock
+    void OutputWord( U64 mosi_data, U64 miso_data );
+    // dual and quad I/O: the word spread across the lanes, mDataLanes bits per clock
+    void OutputWideWord( U64 data );
+    // clocks bit_count bits of bit_width lanes each; bits[ i ] holds the lane states of the i-th, IO0 in bit 0.
+    void OutputBits( const U8* bits, U32 bit_count, U32 bit_width );
 
+    // the period of the simulated clock, in samples, and how far the simulation has got, in samples from the start
+    double mClockPeriod;
+    double mTime;
 
+    U64 mRandomState;
+    U64 mTransactionCount;
+    U32 mFlashAddress;
+
+    std::vector<SimulationLine> mLines;
     SimulationChannelDescriptorGroup mSpiSimulationChannels;
-    SimulationChannelDescriptor* mMiso;
-    SimulationChannelDescriptor* mMosi;
-    SimulationChannelDescriptor* mClock;
-    SimulationChannelDescriptor* mEnable;
+    SimulationLine* mMiso;
+    SimulationLine* mMosi;
+    SimulationLine* mClock;
+    SimulationLine* mEnable;
+    SimulationLine* mIo2;
+    SimulationLine* mIo3;
+
+    // several slaves: their enable lines take turns, a transaction each; mEnable is the current one
+    std::vector<SimulationLine*> mChipSelects;
+    U32 mNextChipSelect;
 };
 #endif // SPI_SIMULATION_DATA_GENERATOR
@@ -0,0 +1,81 @@
+#include "SpiTransitionStream.h"
+
+#include <algorithm>
+
+SpiTransitionStream::SpiTransitionStream()
+    : mInitialState( false ), mEdges( NULL ), mEdgeCount( 0 ), mNextEdge( 0 ), mSample( 0 ), mLastSample( 0 )
+{
+}
+
+SpiTransitionStream::~SpiTransitionStream()
+{
+}
+
+void SpiTransitionStream::Setup( bool initial_state, const std::vector<uint64_t>* edges, uint64_t last_sample )
+{
+    mInitialState = initial_state;
+    mEdges = edges->data();
+    mEdgeCount = edges->size();
+    mNextEdge = 0;
+    mSample = 0;
+    mLastSample = last_sample;
+}
+
+void SpiTransitionStream::Seek( uint64_t sample_number )
+{
+    mNextEdge = std::upper_bound( mEdges, mEdges + mEdgeCount, sample_number ) - mEdges;
+    mSample = sample_number;
+}
+
+uint64_t SpiTransitionStream::GetSampleNumber()
+{
+    return mSample;
+}
+
+bool SpiTransitionStream::GetBitState()
+{
+    // every edge passed toggles the line
+    return mInitialState != ( ( mNextEdge & 1 ) != 0 );
+}
+
+void SpiTransitionStream::AdvanceToNextEdge()
+{
+    if( mNextEdge == mEdgeCount )
+        throw SpiEndOfStream();
+
+    mSample = mEdges[ mNextEdge ];
+    mNextEdge++;
+}
+
+void SpiTransitionStream::AdvanceToAbsPosition( uint64_t sample_number )
+{
+    if( sample_number > mLastSample )
+        throw SpiEndOfStream();
+
+    while( mNextEdge < mEdgeCount && mEdges[ mNextEdge ] <= sample_number )
+        mNextEdge++;
+    mSample = sample_number;
+}
+
+uint64_t SpiTransitionStream::GetSampleOfNextEdge()
+{
+    if( mNextEdge == mEdgeCount )
+        throw SpiEndOfStream();
+
+    return mEdges[ mNextEdge ];
+}
+
+bool SpiTransitionStream::WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number )
+{
+    if( mNextEdge < mEdgeCount )
+        return mEdges[ mNextEdge ] <= sample_number;
+
+    if( sample_number > mLastSample )
+        throw SpiEndOfStream();
+    return false;
+}
+
+bool SpiTransitionStream::DoMoreTransitionsExistInCurrentData()
+{
+    return mNextEdge < mEdgeCount;
+}
@@ -0,0 +1,45 @@
+#ifndef SPI_TRANSITION_STREAM_H
+#define SPI_TRANSITION_STREAM_H
+
+#include "SpiEdgeStream.h"
+
+#include <cstddef>
+#include <vector>
+
+// Thrown when the decoder asks for data past the end of an offline capture. This is how SpiDecoder::Run() ends outside of Logic.
+struct SpiEndOfStream
+{
+};
+
+// A channel of a complete capture, held as the list of samples where the line toggles.
+class SpiTransitionStream : public SpiEdgeStream
+{
+  public:
+    SpiTransitionStream();
+    virtual ~SpiTransitionStream();
+
+    // edges must be increasing and greater than zero, and must outlive the stream. last_sample is the final sample of the capture.
+    void Setup( bool initial_state, const std::vector<uint64_t>* edges, uint64_t last_sample );
+    // moves to any sample, forwards or backwards, with a binary search.
+    void Seek( uint64_t sample_number );
+
+    virtual uint64_t GetSampleNumber();
+    virtual bool GetBitState();
+
+    virtual void AdvanceToNextEdge();
+    virtual void AdvanceToAbsPosition( uint64_t sample_number );
+
+    virtual uint64_t GetSampleOfNextEdge();
+    virtual bool WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number );
+    virtual bool DoMoreTransitionsExistInCurrentData();
+
+  protected:
+    bool mInitialState;
+    const uint64_t* mEdges;
+    size_t mEdgeCount;
+    size_t mNextEdge;
+    uint64_t mSample;
+    uint64_t mLastSample;
+};
+
+#endif // SPI_TRANSITION_STREAM_H
@@ -0,0 +1,74 @@
+#ifndef SPI_WORD_ACCUMULATOR_H
+#define SPI_WORD_ACCUMULATOR_H
+
+#include <cstdint>
+#include <cstring>
+#if defined( _MSC_VER )
+#include <stdlib.h>
+#endif
+
+// each byte value with its bits in the opposite order
+extern const uint8_t kSpiReversedBytes[ 256 ];
+
+// the low bits of value in the opposite order, bit 0 trading places with bit bits - 1.
+inline uint64_t SpiReverseBits( uint64_t value, uint32_t bits )
+{
+    uint64_t reversed = 0;
+    for( uint32_t i = 0; i < 8; i++ )
+    {
+        reversed = ( reversed << 8 ) | kSpiReversedBytes[ value & 0xFF ];
+        value >>= 8;
+    }
+    return reversed >> ( 64 - bits );
+}
+
+// the low bytes of value, most significant first, as FrameV2 byte arrays hold a word. Writes all 8 bytes of out.
+inline void SpiPackWordBytes( uint64_t value, uint32_t bytes, uint8_t* out )
+{
+    uint64_t packed = value << ( 64 - 8 * bytes );
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    // already most significant byte first
+#elif defined( _MSC_VER )
+    packed = _byteswap_uint64( packed );
+#else
+    packed = __builtin_bswap64( packed );
+#endif
+    memcpy( out, &packed, sizeof( packed ) );
+}
+
+// Collects the bits of one word in the order they arrive. The first bit ends up most significant, which is the word for MSB first
+// transfers; LSB first words are reversed once, when the word is complete.
+class SpiWordAccumulator
+{
+  public:
+    SpiWordAccumulator() : mBits( 0 )
+    {
+    }
+
+    void Reset()
+    {
+        mBits = 0;
+    }
+
+    void AddBit( bool bit )
+    {
+        mBits = ( mBits << 1 ) | uint64_t( bit );
+    }
+
+    // count bits at once, most significant first, as dual and quad I/O lanes deliver them.
+    void AddBits( uint32_t bits, uint32_t count )
+    {
+        mBits = ( mBits << count ) | uint64_t( bits );
+    }
+
+    // bits is the number of bits added since Reset().
+    uint64_t GetWord( uint32_t bits, bool lsb_first ) const
+    {
+        return lsb_first ? SpiReverseBits( mBits, bits ) : mBits;
+    }
+
+  protected:
+    uint64_t mBits;
+};
+
+#endif // SPI_WORD_ACCUMULATOR_H
@@ -0,0 +1,74 @@
+#include "SpiWorkStealingPool.h"
+
+SpiWorkStealingPool::SpiWorkStealingPool()
+{
+}
+
+SpiWorkStealingPool::~SpiWorkStealingPool()
+{
+    Wait();
+}
+
+void SpiWorkStealingPool::Start( uint32_t thread_count, size_t task_count, const Task& task )
+{
+    Wait();
+
+    if( thread_count == 0 )
+        thread_count = 1;
+
+    mTask = task;
+    for( uint32_t i = 0; i < thread_count; i++ )
+        mQueues.push_back( new Queue() );
+    for( size_t i = 0; i < task_count; i++ )
+        mQueues[ i % thread_count ]->mTasks.push_back( i );
+
+    for( uint32_t i = 0; i < thread_count; i++ )
+        mThreads.push_back( std::thread( &SpiWorkStealingPool::WorkerThread, this, i ) );
+}
+
+void SpiWorkStealingPool::Wait()
+{
+    for( size_t i = 0; i < mThreads.size(); i++ )
+        mThreads[ i ].join();
+    mThreads.clear();
+
+    for( size_t i = 0; i < mQueues.size(); i++ )
+        delete mQueues[ i ];
+    mQueues.clear();
+}
+
+void SpiWorkStealingPool::WorkerThread( uint32_t index )
+{
+    // nothing is added once the pool has started, so a thread is done when every queue is empty.
+    size_t task;
+    while( PopOwn( index, task ) || Steal( index, task ) )
+        mTask( task );
+}
+
+bool SpiWorkStealingPool::PopOwn( uint32_t index, size_t& task )
+{
+    Queue* queue = mQueues[ index ];
+    std::lock_guard<std::mutex> lock( queue->mMutex );
+    if( queue->mTasks.empty() )
+        return false;
+
+    task = queue->mTasks.front();
+    queue->mTasks.pop_front();
+    return true;
+}
+
+bool SpiWorkStealingPool::Steal( uint32_t index, size_t& task )
+{
+    for( size_t i = 1; i < mQueues.size(); i++ )
+    {
+        Queue* queue = mQueues[ ( index + i ) % mQueues.size() ];
+        std::lock_guard<std::mutex> lock( queue->mMutex );
+        if( queue->mTasks.empty() == false )
+        {
+            task = queue->mTasks.back();
+            queue->mTasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,43 @@
+#ifndef SPI_WORK_STEALING_POOL_H
+#define SPI_WORK_STEALING_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a fixed set of numbered tasks on a few threads. Tasks are dealt out round robin; each thread works through its own queue from
+// the front, so low numbers finish first, and a thread that runs dry takes work from the back of the others' queues.
+class SpiWorkStealingPool
+{
+  public:
+    typedef std::function<void( size_t task )> Task;
+
+    SpiWorkStealingPool();
+    ~SpiWorkStealingPool();
+
+    // starts running task( 0 ) .. task( task_count - 1 ) and returns immediately. Tasks must not throw.
+    void Start( uint32_t thread_count, size_t task_count, const Task& task );
+    // waits for every task to finish.
+    void Wait();
+
+  protected:
+    struct Queue
+    {
+        std::mutex mMutex;
+        std::deque<size_t> mTasks;
+    };
+
+    void WorkerThread( uint32_t index );
+    bool PopOwn( uint32_t index, size_t& task );
+    bool Steal( uint32_t index, size_t& task );
+
+    Task mTask;
+    std::vector<Queue*> mQueues;
+    std::vector<std::thread> mThreads;
+};
+
+#endif // SPI_WORK_STEALING_POOL_H
@@ -0,0 +1,1018 @@
+// Offline SPI decoder: runs the same decode state machine as the Logic plugin over transition lists loaded from disk.
+//
+// Each channel file holds whitespace separated numbers: the initial state of the line (0 or 1), then the samples where the line
+// toggles, in increasing order. Anything after a '#' on a line is ignored.
+//
+// With --bitmap, each channel file is instead the raw samples, packed one bit per sample: sample i is bit i % 8 of byte i / 8. All
+// channel files must then be the same size.
+//
+// With --lanes 2 or 4, the data is read across MOSI and MISO (IO0 and IO1), and for quad I/O --io2 and --io3 as well, after the first
+// --single-bit-words words of each enable window. Every word is then written as result,<start>,<end>,<data>,<lanes>.
+//
+// --enable can be given once per slave on a shared bus. The slaves are numbered from 0 in the order of their --enable files, each line
+// ends with the slave it belongs to, and overlap,<sample>,<slave> marks a slave selected while another already was.
+//
+// --from-sample and --to-sample decode just the enable windows around a range of samples, starting from the active-going enable edge
+// before it, as after a change that only affects part of the capture. The lines are those a decode of the whole capture has for them.
+//
+// --live replays the capture as if it were arriving from a logic analyzer at the given sample rate, the way the plugin sees a live
+// capture: an edge can't be read before the capture reaches it. Decoded lines are published (written and flushed) before every wait,
+// and otherwise at least every half --latency-target; --stats then reports how long after its last sample arrived each word was
+// published.
+//
+// --collapse-repeats folds enable windows with exactly the same words as the window before them, for the same slave, into a single
+// repeat,<first>,<last>,<count> line after the first of them, as the analyzer's Repeated Transactions setting does.
+//
+// --filter keeps only the enable windows whose first bytes match one of the patterns given, as the analyzer's Payload Filter setting
+// does; see SpiPayloadFilter::ParsePatterns() for the syntax. The others are decoded, but not written.
+
+#include "SpiBitmapStream.h"
+#include "SpiChipSelectMux.h"
+#include "SpiCommitScheduler.h"
+#include "SpiDecoder.h"
+#include "SpiLatencyHistogram.h"
+#include "SpiParallelDecoder.h"
+#include "SpiPayloadFilter.h"
+#include "SpiRepeatCollapser.h"
+#include "SpiTransitionStream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct ChannelFile
+    {
+        ChannelFile() : mUsed( false ), mInitialState( false ), mSampleCount( 0 )
+        {
+        }
+
+        bool mUsed;
+        bool mInitialState;
+        std::vector<uint64_t> mEdges;
+        // --bitmap only
+        std::vector<uint64_t> mBitmap;
+        uint64_t mSampleCount;
+    };
+
+    bool LoadChannelFile( const char* path, ChannelFile& channel )
+    {
+        FILE* f = fopen( path, "rb" );
+        if( f == NULL )
+        {
+            fprintf( stderr, "spi_decode: can't open %s\n", path );
+            return false;
+        }
+
+        std::string text;
+        char block[ 1 << 16 ];
+        size_t read;
+        while( ( read = fread( block, 1, sizeof( block ), f ) ) > 0 )
+            text.append( block, read );
+        fclose( f );
+
+        bool have_initial_state = false;
+        uint64_t previous = 0;
+        const char* p = text.c_str();
+        for( ;; )
+        {
+            while( *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ',' )
+                p++;
+            if( *p == '#' )
+            {
+                while( *p != '\0' && *p != '\n' )
+                    p++;
+                continue;
+            }
+            if( *p == '\0' )
+                break;
+
+            char* end;
+            uint64_t value = strtoull( p, &end, 10 );
+            if( end == p )
+            {
+                fprintf( stderr, "spi_decode: %s: unexpected character '%c'\n", path, *p );
+                return false;
+            }
+            p = end;
+
+            if( have_initial_state == false )
+            {
+                channel.mInitialState = value != 0;
+                have_initial_state = true;
+                continue;
+            }
+
+            if( value <= previous )
+            {
+                fprintf( stderr, "spi_decode: %s: transitions must be increasing and after sample 0\n", path );
+                return false;
+            }
+            channel.mEdges.push_back( value );
+            previous = value;
+        }
+
+        if( have_initial_state == false )
+        {
+            fprintf( stderr, "spi_decode: %s: missing initial state\n", path );
+            return false;
+        }
+
+        channel.mUsed = true;
+        return true;
+    }
+
+    bool LoadBitmapFile( const char* path, ChannelFile& channel )
+    {
+        FILE* f = fopen( path, "rb" );
+        if( f == NULL )
+        {
+            fprintf( stderr, "spi_decode: can't open %s\n", path );
+            return false;
+        }
+
+        std::vector<uint8_t> bytes;
+        uint8_t block[ 1 << 16 ];
+        size_t read;
+        while( ( read = fread( block, 1, sizeof( block ), f ) ) > 0 )
+            bytes.insert( bytes.end(), block, block + read );
+        fclose( f );
+
+        if( bytes.empty() )
+        {
+            fprintf( stderr, "spi_decode: %s: empty bitmap\n", path );
+            return false;
+        }
+
+        // the bytes are in file order, so this assumes a little-endian host.
+        channel.mBitmap.assign( ( bytes.size() + 7 ) / 8, 0 );
+        memcpy( channel.mBitmap.data(), bytes.data(), bytes.size() );
+        channel.mSampleCount = uint64_t( bytes.size() ) * 8;
+        channel.mUsed = true;
+        return true;
+    }
+
+    // The clock of a capture replayed as if it were being captured live: sample n arrives n / sample_rate seconds after Start().
+    class LiveCapture
+    {
+      public:
+        explicit LiveCapture( double sample_rate ) : mSampleRate( sample_rate ), mHead( 0 )
+        {
+        }
+
+        void Start()
+        {
+            mStart = std::chrono::steady_clock::now();
+            mHead = 0;
+        }
+
+        std::chrono::steady_clock::time_point GetArrivalTime( uint64_t sample ) const
+        {
+            return mStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double>( double( sample ) / mSampleRate ) );
+        }
+
+        // whether the capture has reached sample. The time is only read when sample is past the head last seen.
+        bool HasReached( uint64_t sample )
+        {
+            if( sample <= mHead )
+                return true;
+            mHead = uint64_t( std::chrono::duration<double>( std::chrono::steady_clock::now() - mStart ).count() * mSampleRate );
+            return sample <= mHead;
+        }
+
+        void WaitFor( uint64_t sample )
+        {
+            std::this_thread::sleep_until( GetArrivalTime( sample ) );
+            mHead = std::max( mHead, sample );
+        }
+
+      private:
+        double mSampleRate;
+        std::chrono::steady_clock::time_point mStart;
+        uint64_t mHead;
+    };
+
+    // A channel of a LiveCapture. Like the plugin's channels, it waits for the capture to reach any edge or sample asked about, and
+    // lets the listener publish what has been decoded first.
+    class LiveStream : public SpiEdgeStream
+    {
+      public:
+        LiveStream() : mStream( NULL ), mCapture( NULL ), mIdleListener( NULL )
+        {
+        }
+
+        void Setup( SpiEdgeStream* stream, LiveCapture* capture, SpiChipSelectMux::IdleListener* idle_listener )
+        {
+            mStream = stream;
+            mCapture = capture;
+            mIdleListener = idle_listener;
+        }
+
+        virtual uint64_t GetSampleNumber()
+        {
+            return mStream->GetSampleNumber();
+        }
+
+        virtual bool GetBitState()
+        {
+            return mStream->GetBitState();
+        }
+
+        virtual void AdvanceToNextEdge()
+        {
+            WaitFor( mStream->GetSampleOfNextEdge() );
+            mStream->AdvanceToNextEdge();
+        }
+
+        virtual void AdvanceToAbsPosition( uint64_t sample_number )
+        {
+            WaitFor( sample_number );
+            mStream->AdvanceToAbsPosition( sample_number );
+        }
+
+        virtual uint64_t GetSampleOfNextEdge()
+        {
+            uint64_t edge = mStream->GetSampleOfNextEdge();
+            WaitFor( edge );
+            return edge;
+        }
+
+        virtual bool WouldAdvancingToAbsPositionCauseTransition( uint64_t sample_number )
+        {
+            WaitFor( sample_number );
+            return mStream->WouldAdvancingToAbsPositionCauseTransition( sample_number );
+        }
+
+        virtual bool DoMoreTransitionsExistInCurrentData()
+        {
+            return mStream->DoMoreTransitionsExistInCurrentData() && mCapture->HasReached( mStream->GetSampleOfNextEdge() );
+        }
+
+      private:
+        void WaitFor( uint64_t sample )
+        {
+            if( mCapture->HasReached( sample ) )
+                return;
+            if( mIdleListener != NULL )
+                mIdleListener->OnCaughtUpWithCapture();
+            mCapture->WaitFor( sample );
+        }
+
+        SpiEdgeStream* mStream;
+        LiveCapture* mCapture;
+        SpiChipSelectMux::IdleListener* mIdleListener;
+    };
+
+    // Writes one line per decoded event, named after the FrameV2 types the plugin produces. Without an output file the lines are kept
+    // until WriteTo() is called.
+    class TextSink : public SpiRepeatCollapser::RepeatSink, public SpiChipSelectMux::IdleListener
+    {
+      public:
+        TextSink( FILE* output, uint32_t bits_per_transfer, bool wide_lanes, bool slave_tags, bool quiet )
+            : mOutput( output ),
+              mQuiet( quiet ),
+              mWideLanes( wide_lanes ),
+              mSlaveTags( slave_tags ),
+              mHexDigits( ( bits_per_transfer + 3 ) / 4 ),
+              mWordCount( 0 ),
+              mErrorCount( 0 ),
+              mLive( NULL ),
+              mLatencyTarget( 0 ),
+              mLateWords( 0 ),
+              mRepeats( NULL )
+        {
+            if( mOutput != NULL )
+                mBuffer.reserve( kFlushSize + 256 );
+        }
+
+        ~TextSink()
+        {
+            Flush();
+        }
+
+        // publishes lines in time to meet latency_target_ms behind live, and measures how long each word took.
+        void SetupLive( const LiveCapture* live, uint32_t latency_target_ms )
+        {
+            mLive = live;
+            mLatencyTarget = std::chrono::milliseconds( latency_target_ms );
+            mCommitScheduler.Setup( kLiveBatchWords, latency_target_ms / 2, true );
+        }
+
+        // --collapse-repeats: caught up with a live capture, pass everything on, a window held as a possible copy included.
+        void SetupRepeats( SpiRepeatCollapser* repeats )
+        {
+            mRepeats = repeats;
+        }
+
+        void Flush()
+        {
+            if( mOutput != NULL )
+                WriteTo( mOutput );
+            if( mLive != NULL )
+                Published();
+        }
+
+        // SpiChipSelectMux::IdleListener, and the channels of a live capture
+        virtual void OnCaughtUpWithCapture()
+        {
+            if( mRepeats != NULL )
+                mRepeats->Finish();
+            if( mCommitScheduler.HasPending() )
+                Flush();
+        }
+
+        const SpiLatencyHistogram& GetLatencies() const
+        {
+            return mLatencies;
+        }
+
+        uint64_t GetLateWordCount() const
+        {
+            return mLateWords;
+        }
+
+        void WriteTo( FILE* output )
+        {
+            if( mBuffer.empty() == false )
+                fwrite( mBuffer.data(), 1, mBuffer.size(), output );
+            mBuffer.clear();
+        }
+
+        virtual void OnPacketBoundary()
+        {
+        }
+
+        virtual void OnEnable( uint64_t sample, uint32_t slave )
+        {
+            Append( "enable,%llu", ( unsigned long long )sample );
+            EndLine( slave );
+            mCommitScheduler.AddEvent();
+        }
+
+        virtual void OnDisable( uint64_t sample, uint32_t slave )
+        {
+            Append( "disable,%llu", ( unsigned long long )sample );
+            EndLine( slave );
+            mCommitScheduler.AddEvent();
+        }
+
+        virtual void OnClockPolarityError( uint64_t /*sample*/ )
+        {
+        }
+
+        virtual void OnErrorFrame( uint64_t starting_sample, uint64_t ending_sample, uint32_t slave )
+        {
+            mErrorCount++;
+            Append( "error,%llu,%llu", ( unsigned long long )starting_sample, ( unsigned long long )ending_sample );
+            EndLine( slave );
+            mCommitScheduler.AddEvent();
+        }
+
+        virtual void OnWord( const SpiWord& word )
+        {
+            mWordCount++;
+            if( mWideLanes )
+            {
+                Append( "result,%llu,%llu,0x%0*llX,%u", ( unsigned long long )word.mStartingSample,
+                        ( unsigned long long )word.mEndingSample, mHexDigits, ( unsigned long long )word.mMosi, word.mDataLanes );
+            }
+            else
+            {
+                Append( "result,%llu,%llu,0x%0*llX,0x%0*llX", ( unsigned long long )word.mStartingSample,
+                        ( unsigned long long )word.mEndingSample, mHexDigits, ( unsigned long long )word.mMosi, mHexDigits,
+                        ( unsigned long long )word.mMiso );
+            }
+            EndLine( word.mSlave );
+
+            if( mLive != NULL )
+            {
+                mPendingWordEnds.push_back( word.mEndingSample );
+                if( mCommitScheduler.AddWord() )
+                    Flush();
+            }
+        }
+
+        virtual void OnRepeat( uint64_t first_sample, uint64_t last_sample, uint64_t count, uint32_t slave, const SpiWord* /*words*/,
+                               size_t /*word_count*/ )
+        {
+            Append( "repeat,%llu,%llu,%llu", ( unsigned long long )first_sample, ( unsigned long long )last_sample,
+                    ( unsigned long long )count );
+            EndLine( slave );
+            mCommitScheduler.AddEvent();
+        }
+
+        virtual void OnChipSelectOverlap( uint64_t sample, uint32_t slave )
+        {
+            Append( "overlap,%llu,%u\n", ( unsigned long long )sample, slave );
+            mCommitScheduler.AddEvent();
+        }
+
+        virtual void OnProgress( uint64_t /*sample*/ )
+        {
+        }
+
+        virtual void PollForExit()
+        {
+        }
+
+        uint64_t GetWordCount() const
+        {
+            return mWordCount;
+        }
+
+        uint64_t GetErrorCount() const
+        {
+            return mErrorCount;
+        }
+
+      private:
+        static const size_t kFlushSize = 1 << 20;
+        // live: publishing costs a system call, so words are still batched when they come faster than the target needs.
+        static const uint32_t kLiveBatchWords = 4096;
+
+        void Published()
+        {
+            if( mOutput != NULL )
+                fflush( mOutput );
+
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            for( size_t i = 0; i < mPendingWordEnds.size(); i++ )
+            {
+                std::chrono::steady_clock::duration latency = now - mLive->GetArrivalTime( mPendingWordEnds[ i ] );
+                if( latency > mLatencyTarget )
+                    mLateWords++;
+                mLatencies.Add( uint64_t( std::max<int64_t>(
+                    0, int64_t( std::chrono::duration_cast<std::chrono::microseconds>( latency ).count() ) ) ) );
+            }
+            mPendingWordEnds.clear();
+            mCommitScheduler.Committed();
+        }
+
+        void Append( const char* format, ... )
+        {
+            if( mQuiet )
+                return;
+
+            char line[ 128 ];
+            va_list args;
+            va_start( args, format );
+            int length = vsnprintf( line, sizeof( line ), format, args );
+            va_end( args );
+
+            mBuffer.append( line, length );
+            if( mOutput != NULL && mBuffer.size() >= kFlushSize )
+                Flush();
+        }
+
+        void EndLine( uint32_t slave )
+        {
+            if( mSlaveTags )
+                Append( ",%u\n", slave );
+            else
+                Append( "\n" );
+        }
+
+        FILE* mOutput;
+        bool mQuiet;
+        bool mWideLanes;
+        bool mSlaveTags;
+        int mHexDigits;
+        std::string mBuffer;
+        uint64_t mWordCount;
+        uint64_t mErrorCount;
+
+        // --live
+        const LiveCapture* mLive;
+        std::chrono::steady_clock::duration mLatencyTarget;
+        SpiCommitScheduler mCommitScheduler;
+        std::vector<uint64_t> mPendingWordEnds;
+        SpiLatencyHistogram mLatencies;
+        uint64_t mLateWords;
+
+        SpiRepeatCollapser* mRepeats;
+    };
+
+    // Gives each chunk of a parallel decode its own TextSink, and writes them out in capture order.
+    class ChunkedTextOutput : public SpiParallelDecoder::Output
+    {
+      public:
+        ChunkedTextOutput( FILE* output, uint32_t bits_per_transfer, bool wide_lanes, bool slave_tags )
+            : mOutput( output ),
+              mBitsPerTransfer( bits_per_transfer ),
+              mWideLanes( wide_lanes ),
+              mSlaveTags( slave_tags ),
+              mWordCount( 0 ),
+              mErrorCount( 0 )
+        {
+        }
+
+        virtual SpiDecoderSink* BeginChunk( size_t /*chunk*/ )
+        {
+            return new TextSink( NULL, mBitsPerTransfer, mWideLanes, mSlaveTags, mOutput == NULL );
+        }
+
+        virtual void EndChunk( size_t /*chunk*/, SpiDecoderSink* sink )
+        {
+            TextSink* text_sink = static_cast<TextSink*>( sink );
+            if( mOutput != NULL )
+                text_sink->WriteTo( mOutput );
+            mWordCount += text_sink->GetWordCount();
+            mErrorCount += text_sink->GetErrorCount();
+            delete text_sink;
+        }
+
+        uint64_t GetWordCount() const
+        {
+            return mWordCount;
+        }
+
+        uint64_t GetErrorCount() const
+        {
+            return mErrorCount;
+        }
+
+      private:
+        FILE* mOutput;
+        uint32_t mBitsPerTransfer;
+        bool mWideLanes;
+        bool mSlaveTags;
+        uint64_t mWordCount;
+        uint64_t mErrorCount;
+    };
+
+    void PrintUsage()
+    {
+        fprintf( stderr,
+                 "usage: spi_decode --clock FILE [--mosi FILE] [--miso FILE] [--enable FILE] [options]\n"
+                 "\n"
+                 "  --bits N               bits per transfer, 1-64 (default 8)\n"
+                 "  --lsb-first            least significant bit first (default msb first)\n"
+                 "  --cpol 0|1             clock state when inactive (default 0)\n"
+                 "  --cpha 0|1             0: data valid on leading edge, 1: on trailing edge (default 0)\n"
+                 "  --enable-active-high   enable is active high (default active low)\n"
+                 "  --enable FILE ...      repeat for each slave sharing the bus; all are decoded in one pass over the clock\n"
+                 "  --lanes 1|2|4          data lines per word: 1 for standard SPI, 2 for dual or 4 for quad I/O, where MOSI and MISO\n"
+                 "                         are IO0 and IO1 (default 1)\n"
+                 "  --io2 FILE, --io3 FILE the other two lanes of quad I/O\n"
+                 "  --single-bit-words N   dual and quad I/O: words at the start of each enable window sent one bit per clock on\n"
+                 "                         MOSI, such as a flash command (default 0)\n"
+                 "  --bitmap               channel files are packed samples, one bit each, instead of transition lists\n"
+                 "  --last-sample N        final sample of the capture (default: the last transition of any channel, or the last\n"
+                 "                         sample of the bitmaps)\n"
+                 "  --threads N            decode on N threads, 0 for one per core (default 1). Needs an enable channel to split the\n"
+                 "                         capture; the output is the same as with one thread. Not with --bitmap\n"
+                 "  --chunk-edges N        smallest piece of the capture handed to a thread, in clock edges (default 65536)\n"
+                 "  --from-sample N, --to-sample N\n"
+                 "                         decode only the enable windows that overlap samples N to N, from the active-going enable\n"
+                 "                         edge before the first. Needs an enable channel. Not with --bitmap\n"
+                 "  --live RATE            replay the capture as if it were arriving at RATE samples per second, publishing lines in\n"
+                 "                         time for --latency-target; --stats adds how long after their last sample words appeared\n"
+                 "  --latency-target MS    with --live, the longest a word should take to appear (default 50)\n"
+                 "  --collapse-repeats     write enable windows that repeat the one before as a single repeat line with a count.\n"
+                 "                         Needs an enable channel; decodes on one thread\n"
+                 "  --filter PATTERNS      write only the enable windows whose first bytes match one of the patterns, such as\n"
+                 "                         \"mosi: 20, mosi: D8, miso: 9F 1X\" (X for any nibble, HH/MM for a masked byte). Needs an\n"
+                 "                         enable channel; decodes on one thread\n"
+                 "  --output FILE          write decoded events to FILE instead of stdout\n"
+                 "  --quiet                decode without writing events\n"
+                 "  --stats                print decode throughput to stderr\n" );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    ChannelFile clock, mosi, miso, enable;
+    ChannelFile io2, io3;
+    const char* channel_paths[ 6 ] = { NULL, NULL, NULL, NULL, NULL, NULL };
+    // slaves 1 and up; slave 0 is enable
+    std::vector<const char*> slave_enable_paths;
+    bool bitmap = false;
+    SpiDecoderSettings settings;
+    uint64_t last_sample = 0;
+    const char* output_path = NULL;
+    bool quiet = false;
+    bool stats = false;
+    uint32_t thread_count = 1;
+    uint64_t min_chunk_clock_edges = 1 << 16;
+    bool range = false;
+    uint64_t range_first_sample = 0;
+    uint64_t range_last_sample = UINT64_MAX;
+    double live_sample_rate = 0;
+    uint32_t latency_target_ms = 50;
+    bool collapse_repeats = false;
+    const char* filter_text = NULL;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        const char* arg = argv[ i ];
+        const char* value = i + 1 < argc ? argv[ i + 1 ] : NULL;
+        bool takes_value = true;
+
+        if( strcmp( arg, "--clock" ) == 0 && value != NULL )
+            channel_paths[ 0 ] = value;
+        else if( strcmp( arg, "--mosi" ) == 0 && value != NULL )
+            channel_paths[ 1 ] = value;
+        else if( strcmp( arg, "--miso" ) == 0 && value != NULL )
+            channel_paths[ 2 ] = value;
+        else if( strcmp( arg, "--enable" ) == 0 && value != NULL && channel_paths[ 3 ] == NULL )
+            channel_paths[ 3 ] = value;
+        else if( strcmp( arg, "--enable" ) == 0 && value != NULL )
+            slave_enable_paths.push_back( value );
+        else if( strcmp( arg, "--io2" ) == 0 && value != NULL )
+            channel_paths[ 4 ] = value;
+        else if( strcmp( arg, "--io3" ) == 0 && value != NULL )
+            channel_paths[ 5 ] = value;
+        else if( strcmp( arg, "--lanes" ) == 0 && value != NULL )
+            settings.mDataLanes = uint32_t( atoi( value ) );
+        else if( strcmp( arg, "--single-bit-words" ) == 0 && value != NULL )
+            settings.mSingleBitWords = uint32_t( atoi( value ) );
+        else if( strcmp( arg, "--bits" ) == 0 && value != NULL )
+            settings.mBitsPerTransfer = uint32_t( atoi( value ) );
+        else if( strcmp( arg, "--cpol" ) == 0 && value != NULL )
+            settings.mClockInactiveState = atoi( value ) != 0;
+        else if( strcmp( arg, "--cpha" ) == 0 && value != NULL )
+            settings.mDataValidOnLeadingEdge = atoi( value ) == 0;
+        else if( strcmp( arg, "--last-sample" ) == 0 && value != NULL )
+            last_sample = strtoull( value, NULL, 10 );
+        else if( strcmp( arg, "--threads" ) == 0 && value != NULL )
+            thread_count = uint32_t( atoi( value ) );
+        else if( strcmp( arg, "--chunk-edges" ) == 0 && value != NULL )
+            min_chunk_clock_edges = strtoull( value, NULL, 10 );
+        else if( strcmp( arg, "--live" ) == 0 && value != NULL )
+            live_sample_rate = strtod( value, NULL );
+        else if( strcmp( arg, "--latency-target" ) == 0 && value != NULL )
+            latency_target_ms = uint32_t( atoi( value ) );
+        else if( strcmp( arg, "--from-sample" ) == 0 && value != NULL )
+        {
+            range = true;
+            range_first_sample = strtoull( value, NULL, 10 );
+        }
+        else if( strcmp( arg, "--to-sample" ) == 0 && value != NULL )
+        {
+            range = true;
+            range_last_sample = strtoull( value, NULL, 10 );
+        }
+        else if( strcmp( arg, "--filter" ) == 0 && value != NULL )
+            filter_text = value;
+        else if( strcmp( arg, "--output" ) == 0 && value != NULL )
+            output_path = value;
+        else
+        {
+            takes_value = false;
+            if( strcmp( arg, "--lsb-first" ) == 0 )
+                settings.mLsbFirst = true;
+            else if( strcmp( arg, "--enable-active-high" ) == 0 )
+                settings.mEnableActiveState = true;
+            else if( strcmp( arg, "--bitmap" ) == 0 )
+                bitmap = true;
+            else if( strcmp( arg, "--quiet" ) == 0 )
+                quiet = true;
+            else if( strcmp( arg, "--stats" ) == 0 )
+                stats = true;
+            else if( strcmp( arg, "--collapse-repeats" ) == 0 )
+                collapse_repeats = true;
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+
+        if( takes_value )
+            i++;
+    }
+
+    ChannelFile* channels[] = { &clock, &mosi, &miso, &enable, &io2, &io3 };
+    const size_t channel_count = sizeof( channels ) / sizeof( channels[ 0 ] );
+    std::vector<ChannelFile> slave_enables( slave_enable_paths.size() );
+
+    // every file, for the checks that apply to all of them
+    std::vector<ChannelFile*> all_channels( channels, channels + channel_count );
+    std::vector<const char*> all_paths( channel_paths, channel_paths + channel_count );
+    for( size_t i = 0; i < slave_enables.size(); i++ )
+    {
+        all_channels.push_back( &slave_enables[ i ] );
+        all_paths.push_back( slave_enable_paths[ i ] );
+    }
+
+    for( size_t i = 0; i < all_channels.size(); i++ )
+    {
+        if( all_paths[ i ] == NULL )
+            continue;
+        bool loaded = bitmap ? LoadBitmapFile( all_paths[ i ], *all_channels[ i ] ) : LoadChannelFile( all_paths[ i ], *all_channels[ i ] );
+        if( loaded == false )
+            return 1;
+    }
+
+    // slave 0 and up, with more than one --enable
+    std::vector<ChannelFile*> chip_selects;
+    if( slave_enables.empty() == false )
+    {
+        chip_selects.push_back( &enable );
+        for( size_t i = 0; i < slave_enables.size(); i++ )
+            chip_selects.push_back( &slave_enables[ i ] );
+    }
+    if( chip_selects.size() > SpiChipSelectMux::kMaxChipSelects )
+    {
+        fprintf( stderr, "spi_decode: at most %u --enable files\n", SpiChipSelectMux::kMaxChipSelects );
+        return 1;
+    }
+
+    if( clock.mUsed == false || ( mosi.mUsed == false && miso.mUsed == false ) )
+    {
+        fprintf( stderr, "spi_decode: a clock file and at least one of MOSI or MISO are required\n" );
+        PrintUsage();
+        return 1;
+    }
+
+    if( settings.mBitsPerTransfer < 1 || settings.mBitsPerTransfer > 64 )
+    {
+        fprintf( stderr, "spi_decode: --bits must be between 1 and 64\n" );
+        return 1;
+    }
+
+    const bool wide_lanes = settings.mDataLanes > 1;
+    if( settings.mDataLanes != 1 && settings.mDataLanes != 2 && settings.mDataLanes != 4 )
+    {
+        fprintf( stderr, "spi_decode: --lanes must be 1, 2 or 4\n" );
+        return 1;
+    }
+    if( settings.mBitsPerTransfer % settings.mDataLanes != 0 )
+    {
+        fprintf( stderr, "spi_decode: --bits must be a multiple of --lanes\n" );
+        return 1;
+    }
+    if( ( wide_lanes && ( mosi.mUsed == false || miso.mUsed == false ) ) ||
+        ( settings.mDataLanes == 4 && ( io2.mUsed == false || io3.mUsed == false ) ) )
+    {
+        fprintf( stderr, "spi_decode: dual I/O needs MOSI and MISO files, quad I/O --io2 and --io3 as well\n" );
+        return 1;
+    }
+
+    if( range && ( enable.mUsed == false || bitmap ) )
+    {
+        fprintf( stderr, "spi_decode: --from-sample and --to-sample need an enable file, and don't work with --bitmap\n" );
+        return 1;
+    }
+
+    const bool live = live_sample_rate > 0;
+    if( live && ( thread_count != 1 || range ) )
+    {
+        fprintf( stderr, "spi_decode: --live decodes the whole capture on one thread\n" );
+        return 1;
+    }
+
+    if( collapse_repeats && ( enable.mUsed == false || thread_count != 1 || range ) )
+    {
+        fprintf( stderr, "spi_decode: --collapse-repeats needs an enable file, and decodes the whole capture on one thread\n" );
+        return 1;
+    }
+
+    std::vector<SpiPayloadFilter::Pattern> filter_patterns;
+    if( filter_text != NULL && SpiPayloadFilter::ParsePatterns( filter_text, filter_patterns ) == false )
+    {
+        fprintf( stderr, "spi_decode: --filter takes comma separated patterns of hex bytes, such as \"mosi: 20, miso: 9F 1X\"\n" );
+        return 1;
+    }
+    const bool filter = filter_patterns.empty() == false;
+    if( filter && ( enable.mUsed == false || thread_count != 1 || range ) )
+    {
+        fprintf( stderr, "spi_decode: --filter needs an enable file, and decodes the whole capture on one thread\n" );
+        return 1;
+    }
+
+    uint64_t edge_count = 0;
+    uint64_t sample_count = 0;
+    if( bitmap )
+    {
+        // the decoder steps over the bitmaps in lockstep, so they have to cover the same samples.
+        sample_count = clock.mSampleCount;
+        for( size_t i = 0; i < all_channels.size(); i++ )
+        {
+            if( all_channels[ i ]->mUsed && all_channels[ i ]->mSampleCount != sample_count )
+            {
+                fprintf( stderr, "spi_decode: with --bitmap, every channel file must be the same size\n" );
+                return 1;
+            }
+        }
+        if( thread_count != 1 )
+        {
+            fprintf( stderr, "spi_decode: --bitmap decodes on one thread\n" );
+            return 1;
+        }
+
+        if( last_sample != 0 && last_sample < sample_count )
+            sample_count = last_sample + 1;
+        for( size_t i = 0; i < all_channels.size(); i++ )
+            if( all_channels[ i ]->mUsed )
+                edge_count += SpiCountBitmapEdges( all_channels[ i ]->mBitmap.data(), sample_count );
+    }
+    else
+    {
+        for( size_t i = 0; i < all_channels.size(); i++ )
+        {
+            edge_count += all_channels[ i ]->mEdges.size();
+            if( all_channels[ i ]->mEdges.empty() == false && all_channels[ i ]->mEdges.back() > last_sample )
+                last_sample = all_channels[ i ]->mEdges.back();
+        }
+    }
+    const bool slave_tags = chip_selects.empty() == false;
+
+    if( thread_count == 0 )
+        thread_count = std::max( 1u, std::thread::hardware_concurrency() );
+
+    FILE* output = NULL;
+    if( quiet == false )
+    {
+        output = output_path != NULL ? fopen( output_path, "wb" ) : stdout;
+        if( output == NULL )
+        {
+            fprintf( stderr, "spi_decode: can't create %s\n", output_path );
+            return 1;
+        }
+    }
+
+    uint64_t word_count;
+    uint64_t error_count;
+    size_t chunk_count = 1;
+    LiveCapture live_capture( live_sample_rate );
+    SpiLatencyHistogram latencies;
+    uint64_t late_word_count = 0;
+    uint64_t filter_passed_count = 0;
+    uint64_t filter_dropped_count = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if( thread_count > 1 || range )
+    {
+        SpiCaptureChannel capture_channels[ channel_count ];
+        for( size_t i = 0; i < channel_count; i++ )
+        {
+            capture_channels[ i ].mInitialState = channels[ i ]->mInitialState;
+            capture_channels[ i ].mEdges = channels[ i ]->mUsed ? &channels[ i ]->mEdges : NULL;
+        }
+
+        std::vector<SpiCaptureChannel> chip_select_channels( chip_selects.size() );
+        for( size_t i = 0; i < chip_selects.size(); i++ )
+        {
+            chip_select_channels[ i ].mInitialState = chip_selects[ i ]->mInitialState;
+            chip_select_channels[ i ].mEdges = &chip_selects[ i ]->mEdges;
+        }
+
+        ChunkedTextOutput chunked_output( output, settings.mBitsPerTransfer, wide_lanes, slave_tags );
+        SpiParallelDecoder decoder;
+        decoder.Setup( settings, capture_channels[ 0 ], capture_channels[ 1 ], capture_channels[ 2 ], capture_channels[ 3 ], last_sample );
+        decoder.SetupWideLanes( capture_channels[ 4 ], capture_channels[ 5 ] );
+        if( slave_tags )
+            decoder.SetupChipSelects( chip_select_channels.data(), uint32_t( chip_select_channels.size() ) );
+        if( range )
+            decoder.SetupRange( range_first_sample, range_last_sample );
+        chunk_count = decoder.Run( thread_count, min_chunk_clock_edges, &chunked_output );
+
+        word_count = chunked_output.GetWordCount();
+        error_count = chunked_output.GetErrorCount();
+    }
+    else
+    {
+        SpiTransitionStream transition_streams[ channel_count ];
+        SpiBitmapStream bitmap_streams[ channel_count ];
+        SpiEdgeStream* streams[ channel_count ] = { NULL, NULL, NULL, NULL, NULL, NULL };
+        for( size_t i = 0; i < channel_count; i++ )
+        {
+            if( channels[ i ]->mUsed == false )
+                continue;
+            if( bitmap )
+            {
+                bitmap_streams[ i ].Setup( channels[ i ]->mBitmap.data(), sample_count );
+                streams[ i ] = &bitmap_streams[ i ];
+            }
+            else
+            {
+                transition_streams[ i ].Setup( channels[ i ]->mInitialState, &channels[ i ]->mEdges, last_sample );
+                streams[ i ] = &transition_streams[ i ];
+            }
+        }
+
+        TextSink sink( output, settings.mBitsPerTransfer, wide_lanes, slave_tags, quiet );
+        SpiRepeatCollapser repeats;
+        SpiDecoderSink* decoder_sink = &sink;
+        if( collapse_repeats )
+        {
+            repeats.Setup( &sink );
+            sink.SetupRepeats( &repeats );
+            decoder_sink = &repeats;
+        }
+        SpiPayloadFilter payload_filter;
+        if( filter )
+        {
+            payload_filter.Setup( filter_patterns, settings.mBitsPerTransfer, decoder_sink );
+            decoder_sink = &payload_filter;
+        }
+        LiveStream live_streams[ channel_count ];
+        if( live )
+        {
+            sink.SetupLive( &live_capture, latency_target_ms );
+            for( size_t i = 0; i < channel_count; i++ )
+            {
+                if( streams[ i ] == NULL )
+                    continue;
+                live_streams[ i ].Setup( streams[ i ], &live_capture, &sink );
+                streams[ i ] = &live_streams[ i ];
+            }
+        }
+
+        // slave 0 is the enable stream; the rest come after the fixed channels
+        std::vector<SpiTransitionStream> slave_transition_streams( slave_enables.size() );
+        std::vector<SpiBitmapStream> slave_bitmap_streams( slave_enables.size() );
+        std::vector<SpiEdgeStream*> chip_select_streams;
+        if( slave_tags )
+            chip_select_streams.push_back( streams[ 3 ] );
+        for( size_t i = 0; i < slave_enables.size(); i++ )
+        {
+            if( bitmap )
+            {
+                slave_bitmap_streams[ i ].Setup( slave_enables[ i ].mBitmap.data(), sample_count );
+                chip_select_streams.push_back( &slave_bitmap_streams[ i ] );
+            }
+            else
+            {
+                slave_transition_streams[ i ].Setup( slave_enables[ i ].mInitialState, &slave_enables[ i ].mEdges, last_sample );
+                chip_select_streams.push_back( &slave_transition_streams[ i ] );
+            }
+        }
+        std::vector<LiveStream> live_slave_streams( slave_enables.size() );
+        for( size_t i = 0; live && i < slave_enables.size(); i++ )
+        {
+            live_slave_streams[ i ].Setup( chip_select_streams[ i + 1 ], &live_capture, &sink );
+            chip_select_streams[ i + 1 ] = &live_slave_streams[ i ];
+        }
+
+        SpiChipSelectMux combined;
+        SpiEdgeStream* enable_stream = streams[ 3 ];
+        if( slave_tags )
+        {
+            combined.Setup( chip_select_streams.data(), uint32_t( chip_select_streams.size() ), settings.mEnableActiveState, decoder_sink,
+                            live ? &sink : NULL );
+            enable_stream = &combined;
+        }
+
+        SpiDecoder decoder;
+        decoder.Setup( settings, streams[ 0 ], streams[ 1 ], streams[ 2 ], enable_stream, decoder_sink );
+        decoder.SetupWideLanes( streams[ 4 ], streams[ 5 ] );
+        if( slave_tags )
+            decoder.SetupChipSelects( &combined );
+        live_capture.Start();
+        try
+        {
+            decoder.Run();
+        }
+        catch( SpiEndOfStream& )
+        {
+        }
+        if( filter )
+            payload_filter.Finish();
+        if( collapse_repeats )
+            repeats.Finish();
+        sink.Flush();
+
+        word_count = sink.GetWordCount();
+        error_count = sink.GetErrorCount();
+        latencies = sink.GetLatencies();
+        late_word_count = sink.GetLateWordCount();
+        filter_passed_count = payload_filter.GetPassedCount();
+        filter_dropped_count = payload_filter.GetDroppedCount();
+    }
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    if( output != NULL && output != stdout )
+        fclose( output );
+
+    if( stats && bitmap )
+        fprintf( stderr, "%llu words, %llu errors, %llu edges, %llu samples in %.3f s: %.0f words/s, %.0f samples/s (%s bitmap scan)\n",
+                 ( unsigned long long )word_count, ( unsigned long long )error_count, ( unsigned long long )edge_count,
+                 ( unsigned long long )sample_count, seconds, seconds > 0 ? word_count / seconds : 0.0,
+                 seconds > 0 ? sample_count / seconds : 0.0, SpiBitmapScanName() );
+    else if( stats )
+        fprintf( stderr, "%llu words, %llu errors, %llu edges in %.3f s: %.0f words/s, %.0f edges/s (%u threads, %llu chunks)\n",
+                 ( unsigned long long )word_count, ( unsigned long long )error_count, ( unsigned long long )edge_count, seconds,
+                 seconds > 0 ? word_count / seconds : 0.0, seconds > 0 ? edge_count / seconds : 0.0, thread_count,
+                 ( unsigned long long )chunk_count );
+    if( stats && filter )
+        fprintf( stderr, "%llu of %llu transactions matched the filter\n", ( unsigned long long )filter_passed_count,
+                 ( unsigned long long )( filter_passed_count + filter_dropped_count ) );
+    if( stats && live )
+        fprintf( stderr,
+                 "latency after the last sample: p50 %llu us, p99 %llu us, p99.9 %llu us, max %llu us; %llu of %llu words over the "
+                 "%u ms target\n",
+                 ( unsigned long long )latencies.GetPercentile( 0.5 ), ( unsigned long long )latencies.GetPercentile( 0.99 ),
+                 ( unsigned long long )latencies.GetPercentile( 0.999 ), ( unsigned long long )latencies.GetMax(),
+                 ( unsigned long long )late_word_count, ( unsigned long long )latencies.GetCount(), latency_target_ms );
+
+    return 0;
+}
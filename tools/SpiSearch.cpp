@@ -0,0 +1,283 @@
+// Finds a byte sequence in a binary frame file (src/SpiFrameFile.h) through its payload search index (src/SpiPayloadIndex.h): the
+// <frame file>.idx sidecar the analyzer writes next to a binary frame export with its Payload Search Index setting on. Without one,
+// the index is built from the frame file and saved there first, so later searches only map it.
+//
+// The pattern is the hex bytes given after the frame file, spaces allowed, such as 03 12 34 56 or 0x03123456; it must be at least 4
+// bytes long. Every place it was sent is written as match,<frame>,<start sample>,<mosi|miso>,<byte>, in frame order, where <byte> is
+// the byte of the frame's word the pattern starts at, 0 for the most significant.
+
+#include "SpiFrameFile.h"
+#include "SpiPayloadIndex.h"
+#include "SpiPayloadIndexBuilder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // a whole file, mapped read-only
+    class MappedFile
+    {
+      public:
+        MappedFile() : mData( NULL ), mSize( 0 )
+        {
+#ifdef _WIN32
+            mMapping = NULL;
+#endif
+        }
+
+        ~MappedFile()
+        {
+            Close();
+        }
+
+        // false if the file can't be opened or is empty
+        bool Open( const char* path )
+        {
+            Close();
+#ifdef _WIN32
+            HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+            if( file == INVALID_HANDLE_VALUE )
+                return false;
+            LARGE_INTEGER size;
+            if( GetFileSizeEx( file, &size ) && size.QuadPart > 0 )
+                mMapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+            CloseHandle( file );
+            if( mMapping == NULL )
+                return false;
+            mData = MapViewOfFile( mMapping, FILE_MAP_READ, 0, 0, 0 );
+            mSize = size_t( size.QuadPart );
+#else
+            const int file = open( path, O_RDONLY );
+            if( file < 0 )
+                return false;
+            struct stat status;
+            if( fstat( file, &status ) == 0 && status.st_size > 0 )
+            {
+                void* data = mmap( NULL, size_t( status.st_size ), PROT_READ, MAP_SHARED, file, 0 );
+                if( data != MAP_FAILED )
+                {
+                    mData = data;
+                    mSize = size_t( status.st_size );
+                }
+            }
+            close( file );
+#endif
+            return mData != NULL;
+        }
+
+        void Close()
+        {
+#ifdef _WIN32
+            if( mData != NULL )
+                UnmapViewOfFile( mData );
+            if( mMapping != NULL )
+                CloseHandle( mMapping );
+            mMapping = NULL;
+#else
+            if( mData != NULL )
+                munmap( mData, mSize );
+#endif
+            mData = NULL;
+            mSize = 0;
+        }
+
+        const void* Data() const
+        {
+            return mData;
+        }
+
+        size_t Size() const
+        {
+            return mSize;
+        }
+
+      protected:
+#ifdef _WIN32
+        HANDLE mMapping;
+#endif
+        void* mData;
+        size_t mSize;
+    };
+
+    int HexValue( char c )
+    {
+        if( c >= '0' && c <= '9' )
+            return c - '0';
+        if( c >= 'a' && c <= 'f' )
+            return c - 'a' + 10;
+        if( c >= 'A' && c <= 'F' )
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // appends the bytes of one argument; an argument is an even number of hex digits, optionally after 0x, and may hold spaces
+    bool ParseHexBytes( const char* text, std::vector<uint8_t>& bytes )
+    {
+        std::string digits;
+        for( const char* p = text; *p != '\0'; p++ )
+        {
+            if( *p == ' ' || *p == '\t' )
+                continue;
+            if( p[ 0 ] == '0' && ( p[ 1 ] == 'x' || p[ 1 ] == 'X' ) && HexValue( p[ 2 ] ) >= 0 )
+            {
+                p++;
+                continue;
+            }
+            if( HexValue( *p ) < 0 )
+                return false;
+            digits += *p;
+        }
+
+        if( digits.empty() || ( digits.size() % 2 ) != 0 )
+            return false;
+        for( size_t i = 0; i < digits.size(); i += 2 )
+            bytes.push_back( uint8_t( HexValue( digits[ i ] ) << 4 | HexValue( digits[ i + 1 ] ) ) );
+        return true;
+    }
+
+    bool WriteIndex( const char* path, const SpiFrameFileView& frames )
+    {
+        SpiPayloadIndexBuilder builder;
+        builder.Setup( frames.Header().mBitsPerTransfer );
+        builder.AddFrameFile( frames );
+
+        SpiPayloadIndexHeader header;
+        std::vector<uint64_t> bucket_starts;
+        std::vector<uint64_t> postings;
+        builder.Build( frames.FrameCount(), frames.Header().mChannels, SpiPayloadIndexFingerprint::Of( frames ), header, bucket_starts,
+                       postings );
+
+        FILE* f = fopen( path, "wb" );
+        if( f == NULL )
+            return false;
+        bool written = fwrite( &header, sizeof( header ), 1, f ) == 1 &&
+                       fwrite( bucket_starts.data(), sizeof( uint64_t ), bucket_starts.size(), f ) == bucket_starts.size() &&
+                       fwrite( postings.data(), sizeof( uint64_t ), postings.size(), f ) == postings.size();
+        return fclose( f ) == 0 && written;
+    }
+
+    void PrintUsage()
+    {
+        fprintf( stderr,
+                 "usage: spi_search [options] FRAMES.spif HEX...\n"
+                 "\n"
+                 "  HEX...                 the bytes to find, at least 4, such as 03 12 34 56 or 0x03123456\n"
+                 "  --mosi, --miso         search only MOSI (dual and quad I/O data included) or only MISO (default both)\n"
+                 "  --index FILE           the payload search index (default FRAMES.spif.idx); built from the frame file and\n"
+                 "                         saved there if missing or made for another frame file\n"
+                 "  --rebuild              build the index again even if there is one\n"
+                 "  --stats                print how many index entries were checked, and how long it took, to stderr\n" );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    const char* frames_path = NULL;
+    std::string index_path;
+    uint32_t channels = 0;
+    bool rebuild = false;
+    bool stats = false;
+    std::vector<uint8_t> pattern;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        const char* arg = argv[ i ];
+        if( strcmp( arg, "--index" ) == 0 && i + 1 < argc )
+            index_path = argv[ ++i ];
+        else if( strcmp( arg, "--mosi" ) == 0 )
+            channels |= kSpiPayloadIndexMosi;
+        else if( strcmp( arg, "--miso" ) == 0 )
+            channels |= kSpiPayloadIndexMiso;
+        else if( strcmp( arg, "--rebuild" ) == 0 )
+            rebuild = true;
+        else if( strcmp( arg, "--stats" ) == 0 )
+            stats = true;
+        else if( strncmp( arg, "--", 2 ) == 0 )
+        {
+            PrintUsage();
+            return 1;
+        }
+        else if( frames_path == NULL )
+            frames_path = arg;
+        else if( ParseHexBytes( arg, pattern ) == false )
+        {
+            fprintf( stderr, "spi_search: \"%s\" isn't hex bytes\n", arg );
+            return 1;
+        }
+    }
+
+    if( frames_path == NULL || pattern.empty() )
+    {
+        PrintUsage();
+        return 1;
+    }
+    if( pattern.size() < kSpiPayloadIndexGramLength )
+    {
+        fprintf( stderr, "spi_search: the pattern must be at least %u bytes long\n", kSpiPayloadIndexGramLength );
+        return 1;
+    }
+    if( channels == 0 )
+        channels = kSpiPayloadIndexMosi | kSpiPayloadIndexMiso;
+    if( index_path.empty() )
+        index_path = std::string( frames_path ) + ".idx";
+
+    MappedFile frames_file;
+    SpiFrameFileView frames;
+    if( frames_file.Open( frames_path ) == false || frames.Open( frames_file.Data(), frames_file.Size() ) == false )
+    {
+        fprintf( stderr, "spi_search: %s isn't a binary frame file\n", frames_path );
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    MappedFile index_file;
+    SpiPayloadIndexView index;
+    if( rebuild || index_file.Open( index_path.c_str() ) == false || index.Open( index_file.Data(), index_file.Size() ) == false ||
+        index.IsFor( frames ) == false )
+    {
+        index_file.Close();
+        fprintf( stderr, "spi_search: indexing %s into %s\n", frames_path, index_path.c_str() );
+        if( WriteIndex( index_path.c_str(), frames ) == false || index_file.Open( index_path.c_str() ) == false ||
+            index.Open( index_file.Data(), index_file.Size() ) == false )
+        {
+            fprintf( stderr, "spi_search: can't write %s\n", index_path.c_str() );
+            return 1;
+        }
+    }
+
+    std::chrono::steady_clock::time_point search_start = std::chrono::steady_clock::now();
+    std::vector<SpiPayloadMatch> matches;
+    uint64_t candidates = 0;
+    index.Find( frames, pattern.data(), pattern.size(), channels, matches, &candidates );
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    for( size_t i = 0; i < matches.size(); i++ )
+        printf( "match,%llu,%llu,%s,%u\n", ( unsigned long long )matches[ i ].mFrameIndex,
+                ( unsigned long long )frames.StartSamples()[ matches[ i ].mFrameIndex ], matches[ i ].mMiso ? "miso" : "mosi",
+                matches[ i ].mByte );
+
+    if( stats )
+        fprintf( stderr, "%llu matches, %llu of %llu index entries checked, for %llu frames; search %.3f ms, total %.3f ms\n",
+                 ( unsigned long long )matches.size(), ( unsigned long long )candidates,
+                 ( unsigned long long )index.Header().mPostingCount, ( unsigned long long )frames.FrameCount(),
+                 std::chrono::duration<double, std::milli>( end - search_start ).count(),
+                 std::chrono::duration<double, std::milli>( end - start ).count() );
+
+    return 0;
+}